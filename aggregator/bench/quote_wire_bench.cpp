@@ -0,0 +1,242 @@
+// Host benchmark: how long a tracker spends turning a response into quotes,
+// for the binary frame from /quotes.bin against the Yahoo chart JSON.
+//
+//   quote_wire_bench [symbols] [iterations] [chart points]
+//
+// The JSON side is timed with ArduinoJson when it is available (the same
+// parser and document size as yahoo_api.cpp), and always with the key scan
+// the aggregator uses, which is a lower bound for any JSON parser. Times are
+// host times; the ESP32 is roughly 20-50x slower, the ratios hold.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "quote_wire.h"
+#include "upstream.h"
+#ifdef HAVE_ARDUINOJSON
+#include <ArduinoJson.h>
+#endif
+
+struct Quote {
+  float price;
+  float prev_close;
+  uint32_t volume;
+};
+
+static const char* SYMBOLS[] = {
+  "AAPL", "MSFT", "GOOGL", "AMZN", "NVDA", "META", "TSLA", "BRK-A",
+  "JPM", "V", "^GSPC", "BTC-USD", "EURUSD=X", "XOM", "WMT", "PG",
+};
+#define SYMBOL_COUNT (int)(sizeof(SYMBOLS) / sizeof(SYMBOLS[0]))
+
+static double price_for(int i) {
+  return i == 7 ? 712345.67 : 12.3456 + i * 37.21;
+}
+
+// A chart response shaped like Yahoo's: everything the firmware ignores is
+// there too, because the parser has to get through it
+static std::string chart_json(const char* symbol, int i, int points) {
+  double price = price_for(i), prev_close = price * 0.99;
+  char meta[2048];
+  snprintf(meta, sizeof(meta),
+    "{\"chart\":{\"result\":[{\"meta\":{\"currency\":\"USD\",\"symbol\":\"%s\","
+    "\"exchangeName\":\"NMS\",\"fullExchangeName\":\"NasdaqGS\",\"instrumentType\":\"EQUITY\","
+    "\"firstTradeDate\":345479400,\"regularMarketTime\":1760731201,\"hasPrePostMarketData\":true,"
+    "\"gmtoffset\":-14400,\"timezone\":\"EDT\",\"exchangeTimezoneName\":\"America/New_York\","
+    "\"regularMarketPrice\":%.4f,\"fiftyTwoWeekHigh\":%.2f,\"fiftyTwoWeekLow\":%.2f,"
+    "\"regularMarketDayHigh\":%.2f,\"regularMarketDayLow\":%.2f,\"regularMarketVolume\":%u,"
+    "\"longName\":\"%s Incorporated\",\"shortName\":\"%s Inc.\",\"chartPreviousClose\":%.4f,"
+    "\"previousClose\":%.4f,\"scale\":3,\"priceHint\":2,\"currentTradingPeriod\":{"
+    "\"pre\":{\"timezone\":\"EDT\",\"start\":1760688000,\"end\":1760707800,\"gmtoffset\":-14400},"
+    "\"regular\":{\"timezone\":\"EDT\",\"start\":1760707800,\"end\":1760731200,\"gmtoffset\":-14400},"
+    "\"post\":{\"timezone\":\"EDT\",\"start\":1760731200,\"end\":1760745600,\"gmtoffset\":-14400}},"
+    "\"tradingPeriods\":[[{\"timezone\":\"EDT\",\"start\":1760707800,\"end\":1760731200,"
+    "\"gmtoffset\":-14400}]],\"dataGranularity\":\"1m\",\"range\":\"1d\",\"validRanges\":[\"1d\","
+    "\"5d\",\"1mo\",\"3mo\",\"6mo\",\"1y\",\"2y\",\"5y\",\"10y\",\"ytd\",\"max\"]},",
+    symbol, price, price * 1.3, price * 0.7, price * 1.01, price * 0.98, 1000000u + i * 7919u,
+    symbol, symbol, prev_close, prev_close);
+
+  std::string body = meta;
+  std::string timestamps, open, high, low, close, volume;
+  char n[32];
+  for (int k = 0; k < points; k++) {
+    const char* sep = k ? "," : "";
+    double p = price * (1 + 0.0001 * (k % 17));
+    snprintf(n, sizeof(n), "%s%d", sep, 1760707800 + k * 60);
+    timestamps += n;
+    snprintf(n, sizeof(n), "%s%.4f", sep, p);
+    open += n;
+    close += n;
+    snprintf(n, sizeof(n), "%s%.4f", sep, p * 1.0005);
+    high += n;
+    snprintf(n, sizeof(n), "%s%.4f", sep, p * 0.9995);
+    low += n;
+    snprintf(n, sizeof(n), "%s%d", sep, 1000 + k * 13);
+    volume += n;
+  }
+  body += "\"timestamp\":[" + timestamps + "],\"indicators\":{\"quote\":[{\"open\":[" + open +
+          "],\"high\":[" + high + "],\"low\":[" + low + "],\"close\":[" + close +
+          "],\"volume\":[" + volume + "]}]}}],\"error\":null}}";
+  return body;
+}
+
+// What /quotes.bin sends for the batch
+static std::vector<uint8_t> binary_frame(int count) {
+  std::vector<uint8_t> frame(QUOTE_WIRE_FRAME_SIZE(count));
+  for (int i = 0; i < count; i++) {
+    QuoteWireRecord r = {};
+    r.symbol_id = quote_wire_symbol_id(SYMBOLS[i]);
+    quote_wire_scale(price_for(i), price_for(i) * 0.99, &r);
+    r.volume = 1000000u + i * 7919u;
+    r.market_time = 1760731201;
+    r.flags = QUOTE_WIRE_VALID;
+    // Reverse order, so the decoder really has to match ids
+    quote_wire_put_record(frame.data(), count - 1 - i, r);
+  }
+  quote_wire_finish(frame.data(), (uint16_t)count, 1);
+  return frame;
+}
+
+// The tracker's decoder: check the frame, then match each record to the
+// symbol it asked for by id. No allocation.
+static int decode_binary(const uint8_t* frame, size_t len, const uint32_t* ids, int count,
+                         Quote* quotes, bool* ok) {
+  uint16_t records;
+  if (quote_wire_check(frame, len, &records) != QUOTE_WIRE_OK) return -1;
+
+  int received = 0;
+  for (int r = 0; r < records; r++) {
+    QuoteWireRecord rec;
+    quote_wire_get_record(frame, r, &rec);
+    if (!(rec.flags & QUOTE_WIRE_VALID)) continue;
+    for (int i = 0; i < count; i++) {
+      if (ids[i] == rec.symbol_id && !ok[i]) {
+        quotes[i].price = quote_wire_value(rec.price, rec.decimals);
+        quotes[i].prev_close = quote_wire_value(rec.prev_close, rec.decimals);
+        quotes[i].volume = rec.volume;
+        ok[i] = true;
+        received++;
+        break;
+      }
+    }
+  }
+  return received;
+}
+
+static bool decode_key_scan(const std::string& body, Quote* quote) {
+  double price, prev_close, volume = 0;
+  if (!json_number(body, "regularMarketPrice", &price)) return false;
+  if (!json_number(body, "previousClose", &prev_close)) return false;
+  json_number(body, "regularMarketVolume", &volume);
+  quote->price = (float)price;
+  quote->prev_close = (float)prev_close;
+  quote->volume = (uint32_t)volume;
+  return true;
+}
+
+#ifdef HAVE_ARDUINOJSON
+// As in yahoo_fetch_quote()
+static bool decode_arduinojson(const std::string& body, Quote* quote) {
+  DynamicJsonDocument doc(40 * 1024);
+  if (deserializeJson(doc, body)) return false;
+  JsonObject meta = doc["chart"]["result"][0]["meta"];
+  if (meta.isNull()) return false;
+  quote->price = meta["regularMarketPrice"];
+  quote->prev_close = meta["previousClose"];
+  quote->volume = meta["regularMarketVolume"];
+  return quote->price > 0 && quote->prev_close > 0;
+}
+#endif
+
+template <typename F>
+static double time_ns(int iterations, F body) {
+  auto start = std::chrono::steady_clock::now();
+  for (int it = 0; it < iterations; it++) body();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static void report(const char* name, double batch_ns, size_t bytes, int count, double baseline_ns) {
+  printf("%-24s %9.0f ns/symbol %8zu bytes/symbol %8.1fx\n", name, batch_ns / count,
+         bytes / count, baseline_ns / batch_ns);
+}
+
+static volatile float sink;
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? atoi(argv[1]) : SYMBOL_COUNT;
+  int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+  int points = argc > 3 ? atoi(argv[3]) : 1;
+  if (count < 1 || count > SYMBOL_COUNT || iterations < 1 || points < 0) {
+    fprintf(stderr, "usage: %s [symbols 1-%d] [iterations] [chart points]\n", argv[0], SYMBOL_COUNT);
+    return 2;
+  }
+
+  std::vector<std::string> bodies;
+  size_t json_bytes = 0;
+  uint32_t ids[SYMBOL_COUNT];
+  for (int i = 0; i < count; i++) {
+    bodies.push_back(chart_json(SYMBOLS[i], i, points));
+    json_bytes += bodies.back().size();
+    ids[i] = quote_wire_symbol_id(SYMBOLS[i]);
+  }
+  std::vector<uint8_t> frame = binary_frame(count);
+
+  // Both paths have to agree before any timing means anything
+  Quote json_quotes[SYMBOL_COUNT], bin_quotes[SYMBOL_COUNT];
+  bool ok[SYMBOL_COUNT] = {};
+  if (decode_binary(frame.data(), frame.size(), ids, count, bin_quotes, ok) != count) {
+    fprintf(stderr, "binary frame did not decode\n");
+    return 1;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!decode_key_scan(bodies[i], &json_quotes[i]) ||
+        fabsf(json_quotes[i].price - bin_quotes[i].price) > json_quotes[i].price * 1e-6f ||
+        json_quotes[i].volume != bin_quotes[i].volume) {
+      fprintf(stderr, "%s: JSON and binary quotes differ\n", SYMBOLS[i]);
+      return 1;
+    }
+  }
+  frame[QUOTE_WIRE_HEADER_SIZE + 5] ^= 0x40;
+  if (decode_binary(frame.data(), frame.size(), ids, count, bin_quotes, ok) != -1) {
+    fprintf(stderr, "corrupted frame was not rejected\n");
+    return 1;
+  }
+  frame[QUOTE_WIRE_HEADER_SIZE + 5] ^= 0x40;
+
+  printf("%d symbols, %d chart points per JSON response, %d iterations\n\n", count, points, iterations);
+
+  double key_scan = time_ns(iterations, [&] {
+    for (int i = 0; i < count; i++) {
+      decode_key_scan(bodies[i], &json_quotes[i]);
+      sink = json_quotes[i].price;
+    }
+  });
+  double binary = time_ns(iterations, [&] {
+    bool got[SYMBOL_COUNT] = {};
+    decode_binary(frame.data(), frame.size(), ids, count, bin_quotes, got);
+    sink = bin_quotes[0].price;
+  });
+
+#ifdef HAVE_ARDUINOJSON
+  double arduinojson = time_ns(iterations, [&] {
+    for (int i = 0; i < count; i++) {
+      decode_arduinojson(bodies[i], &json_quotes[i]);
+      sink = json_quotes[i].price;
+    }
+  });
+  report("JSON, ArduinoJson", arduinojson, json_bytes, count, arduinojson);
+  report("JSON, key scan", key_scan, json_bytes, count, arduinojson);
+  report("binary frame", binary, frame.size(), count, arduinojson);
+#else
+  report("JSON, key scan", key_scan, json_bytes, count, key_scan);
+  report("binary frame", binary, frame.size(), count, key_scan);
+  printf("\nArduinoJson not found; build the firmware with PlatformIO first, or pass\n"
+         "-DARDUINOJSON_INCLUDE_DIR=<ArduinoJson/src> to cmake, to time the device's parser.\n");
+#endif
+  return 0;
+}
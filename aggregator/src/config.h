@@ -0,0 +1,50 @@
+// Quote Aggregator Configuration
+// Defaults; the settings marked (env) can be overridden with environment
+// variables of the same name, see docker-compose.yml
+
+#ifndef AGGREGATOR_CONFIG_H
+#define AGGREGATOR_CONFIG_H
+
+// Upstream quote source (env UPSTREAM_URL). The symbol is appended.
+#define DEFAULT_UPSTREAM_URL "https://query1.finance.yahoo.com/v8/finance/chart/"
+
+// Port the trackers connect to (env PORT)
+#define DEFAULT_PORT 8080
+
+// Port for push subscriptions (env PUSH_PORT)
+#define DEFAULT_PUSH_PORT 8081
+
+// Each requested symbol is fetched upstream once per poll (env POLL_SECONDS)
+#define DEFAULT_POLL_SECONDS 30
+
+// Symbols nobody asked for in this long are dropped (env SYMBOL_TTL_SECONDS)
+#define DEFAULT_SYMBOL_TTL_SECONDS 600
+
+// Gap between upstream requests, keeps well under the rate limit
+#define UPSTREAM_SPACING_MS 250
+#define UPSTREAM_TIMEOUT_SECONDS 15
+#define UPSTREAM_MAX_BODY (512 * 1024)
+#define UPSTREAM_USER_AGENT "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36"
+
+// Limits on what devices can ask for
+#define AGGREGATOR_MAX_SYMBOLS 256       // Symbols polled at once, across all devices
+#define AGGREGATOR_MAX_PER_REQUEST 64
+#define AGGREGATOR_SYMBOL_MAX_LEN 15
+
+// A request for a symbol that is not cached yet waits this long for the
+// first upstream fetch
+#define FIRST_FETCH_WAIT_MS 3000
+
+// Device connections
+#define CLIENT_TIMEOUT_SECONDS 5
+#define CLIENT_MAX_CONNECTIONS 64
+#define REQUEST_MAX_BYTES 4096
+
+// Push subscriptions. Subscribers are checked for changes on every upstream
+// fetch and at least this often, for commands from the client.
+#define PUSH_WAKE_MS 250
+#define PUSH_HEARTBEAT_SECONDS 15     // Empty frame when nothing changed
+#define PUSH_MAX_SUBSCRIBERS 64
+#define PUSH_MAX_BACKLOG_BYTES 8192   // Unsent data before deltas are dropped
+
+#endif
@@ -0,0 +1,251 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "http_server.h"
+#include "quote_cache.h"
+#include "quote_frames.h"
+#include "config.h"
+
+static std::atomic<uint64_t> request_count{0};
+static std::atomic<uint64_t> symbols_served{0};
+static std::atomic<uint64_t> error_count{0};
+static std::atomic<int> open_connections{0};
+static std::atomic<uint32_t> frame_sequence{0};
+
+bool valid_symbol(const std::string& s) {
+  if (s.empty() || s.size() > AGGREGATOR_SYMBOL_MAX_LEN) return false;
+  for (char c : s) {
+    bool ok = (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '.' || c == '-' || c == '^' || c == '=';
+    if (!ok) return false;
+  }
+  return true;
+}
+
+std::vector<std::string> parse_symbols(const std::string& query) {
+  std::vector<std::string> symbols;
+  size_t at = query.find("symbols=");
+  if (at == std::string::npos) return symbols;
+
+  size_t end = query.find('&', at);
+  std::string list = query.substr(at + 8, end == std::string::npos ? std::string::npos : end - at - 8);
+
+  size_t start = 0;
+  while (start <= list.size() && symbols.size() < AGGREGATOR_MAX_PER_REQUEST) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string::npos) comma = list.size();
+    std::string s = list.substr(start, comma - start);
+    for (char& c : s) {
+      if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    }
+    if (!s.empty()) symbols.push_back(s);
+    start = comma + 1;
+  }
+  return symbols;
+}
+
+// Register everything first, so all new symbols are fetched in one go
+static void request_symbols(const std::vector<std::string>& symbols) {
+  for (const std::string& s : symbols) {
+    if (valid_symbol(s)) cache_request(s);
+  }
+}
+
+// Look up a requested symbol. One that has never been tried upstream waits
+// briefly for its first fetch. Returns false if there is no quote.
+static bool lookup(const std::string& s, CachedQuote* q) {
+  bool known = valid_symbol(s) && cache_get(s, q);
+  if (known && !q->valid && q->last_status == 0) {
+    cache_wait_attempted(s, FIRST_FETCH_WAIT_MS);
+    cache_get(s, q);
+  }
+  return known && q->valid;
+}
+
+static int quotes(const std::string& query, std::string* body) {
+  std::vector<std::string> symbols = parse_symbols(query);
+  if (symbols.empty()) {
+    *body = "expected ?symbols=AAPL,MSFT\n";
+    return 400;
+  }
+
+  request_symbols(symbols);
+  time_t now = time(nullptr);
+  char line[128];
+  for (const std::string& s : symbols) {
+    CachedQuote q;
+    if (lookup(s, &q)) {
+      snprintf(line, sizeof(line), "%s,%.4f,%.4f,%llu,%ld\n", s.c_str(), q.price, q.prev_close,
+               (unsigned long long)q.volume, (long)(now - q.updated));
+      symbols_served++;
+    } else {
+      snprintf(line, sizeof(line), "%.*s,,,,\n", AGGREGATOR_SYMBOL_MAX_LEN, s.c_str());
+    }
+    body->append(line);
+  }
+  return 200;
+}
+
+// Same lookup as quotes(), answered with one binary frame (quote_wire.h)
+// that the tracker can decode without parsing any text
+static int quotes_binary(const std::string& query, std::string* body) {
+  std::vector<std::string> symbols = parse_symbols(query);
+  if (symbols.empty()) {
+    *body = "expected ?symbols=AAPL,MSFT\n";
+    return 400;
+  }
+
+  request_symbols(symbols);
+  uint8_t frame[QUOTE_WIRE_FRAME_SIZE(AGGREGATOR_MAX_PER_REQUEST)];
+  for (size_t i = 0; i < symbols.size(); i++) {
+    CachedQuote q;
+    bool known = lookup(symbols[i], &q);
+    if (known) symbols_served++;
+    quote_wire_put_record(frame, (int)i, quote_record(symbols[i], known ? &q : nullptr));
+  }
+  quote_wire_finish(frame, (uint16_t)symbols.size(), frame_sequence++);
+  body->assign((const char*)frame, QUOTE_WIRE_FRAME_SIZE(symbols.size()));
+  return 200;
+}
+
+static int route(const std::string& method, const std::string& target, std::string* body,
+                 const char** content_type) {
+  if (method != "GET") {
+    *body = "method not allowed\n";
+    return 405;
+  }
+
+  size_t q = target.find('?');
+  std::string path = target.substr(0, q);
+  std::string query = q == std::string::npos ? "" : target.substr(q + 1);
+
+  if (path == "/quotes") return quotes(query, body);
+  if (path == "/quotes.bin") {
+    int status = quotes_binary(query, body);
+    if (status == 200) *content_type = "application/octet-stream";
+    return status;
+  }
+
+  if (path == "/health") {
+    char text[160];
+    snprintf(text, sizeof(text), "ok symbols=%zu requests=%llu served=%llu errors=%llu\n",
+             cache_size(), (unsigned long long)request_count.load(),
+             (unsigned long long)symbols_served.load(), (unsigned long long)error_count.load());
+    *body = text;
+    return 200;
+  }
+
+  *body = "not found, try /quotes?symbols=AAPL or /quotes.bin?symbols=AAPL\n";
+  return 404;
+}
+
+static const char* status_text(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    default: return "Error";
+  }
+}
+
+static void send_all(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+static void serve_client(int fd) {
+  // Read up to the end of the headers; the body (if any) is ignored
+  std::string request;
+  char buf[512];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < REQUEST_MAX_BYTES) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) break;
+    request.append(buf, n);
+  }
+
+  size_t line_end = request.find("\r\n");
+  size_t sp1 = request.find(' ');
+  size_t sp2 = sp1 == std::string::npos ? sp1 : request.find(' ', sp1 + 1);
+
+  std::string body;
+  const char* content_type = "text/plain";
+  int status;
+  if (line_end == std::string::npos || sp2 == std::string::npos || sp2 > line_end) {
+    body = "bad request\n";
+    status = 400;
+  } else {
+    request_count++;
+    status = route(request.substr(0, sp1), request.substr(sp1 + 1, sp2 - sp1 - 1), &body,
+                   &content_type);
+  }
+  if (status != 200) error_count++;
+
+  char header[192];
+  snprintf(header, sizeof(header),
+           "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+           status, status_text(status), content_type, body.size());
+  send_all(fd, header + body);
+
+  shutdown(fd, SHUT_WR);
+  close(fd);
+  open_connections--;
+}
+
+int http_server_run(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return 1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 32) < 0) {
+    perror("bind/listen");
+    close(fd);
+    return 1;
+  }
+  printf("Serving trackers on port %u\n", (unsigned)port);
+
+  for (;;) {
+    int client = accept(fd, nullptr, nullptr);
+    if (client < 0) continue;
+
+    if (open_connections >= CLIENT_MAX_CONNECTIONS) {
+      close(client);
+      error_count++;
+      continue;
+    }
+
+    timeval timeout = {CLIENT_TIMEOUT_SECONDS, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    open_connections++;
+    std::thread(serve_client, client).detach();
+  }
+}
+
+void http_server_stats(ServerStats* stats) {
+  stats->requests = request_count;
+  stats->symbols_served = symbols_served;
+  stats->errors = error_count;
+}
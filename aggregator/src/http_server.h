@@ -0,0 +1,42 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Plain HTTP for the trackers on the LAN, one short-lived thread per
+// connection.
+//
+//   GET /quotes?symbols=AAPL,MSFT
+//     One line per requested symbol, in order:
+//     symbol,price,prev_close,volume,age_seconds
+//     Fields after the symbol are empty if there is no quote yet.
+//
+//   GET /quotes.bin?symbols=AAPL,MSFT
+//     The same as one binary frame (include/quote_wire.h), one record per
+//     requested symbol, in order
+//
+//   GET /health
+//     "ok" plus a few counters
+
+struct ServerStats {
+  uint64_t requests;
+  uint64_t symbols_served;
+  uint64_t errors;
+};
+
+// Bind and serve forever. Returns only if the socket cannot be opened.
+int http_server_run(uint16_t port);
+
+void http_server_stats(ServerStats* stats);
+
+// "AAPL,MSFT" from a query string ("symbols=AAPL,MSFT&..."). Case is
+// normalised, since Yahoo symbols are upper case. Also used by the push
+// server.
+std::vector<std::string> parse_symbols(const std::string& query);
+
+// Only symbols that look like Yahoo's are registered with the cache
+bool valid_symbol(const std::string& s);
+
+#endif
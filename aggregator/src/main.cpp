@@ -0,0 +1,92 @@
+// Quote aggregator for a fleet of stock trackers.
+//
+// Every tracker asks this service for its watchlist over plain HTTP on the
+// LAN instead of fetching each symbol from Yahoo over HTTPS. The service
+// polls the upstream once per interval for the union of all watchlists and
+// caches the results, so the upstream request rate depends on the number of
+// distinct symbols, not on the number of trackers.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "config.h"
+#include "http_server.h"
+#include "push_server.h"
+#include "quote_cache.h"
+#include "upstream.h"
+
+struct Settings {
+  std::string upstream_url;
+  int port;
+  int push_port;
+  int poll_seconds;
+  int ttl_seconds;
+};
+
+static int env_int(const char* name, int fallback) {
+  const char* value = getenv(name);
+  return (value && *value) ? atoi(value) : fallback;
+}
+
+static std::string env_string(const char* name, const char* fallback) {
+  const char* value = getenv(name);
+  return (value && *value) ? value : fallback;
+}
+
+// Refresh every symbol that is due, one request at a time
+static void poll_upstream(Settings settings) {
+  uint64_t requests = 0, failures = 0;
+  for (;;) {
+    std::vector<std::string> due = cache_due_symbols(settings.poll_seconds, settings.ttl_seconds, 1000);
+
+    for (const std::string& symbol : due) {
+      CachedQuote quote = {};
+      int status = 0;
+      bool ok = upstream_fetch(symbol, &quote, &status);
+      cache_store(symbol, ok, quote, status);
+
+      requests++;
+      if (!ok) failures++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(UPSTREAM_SPACING_MS));
+    }
+
+    if (!due.empty()) {
+      ServerStats stats;
+      PushStats push;
+      http_server_stats(&stats);
+      push_server_stats(&push);
+      printf("Polled %zu symbols (%zu cached). Upstream: %llu requests, %llu failed. "
+             "Trackers: %llu requests, %d subscribed (%llu frames, %llu dropped)\n",
+             due.size(), cache_size(), (unsigned long long)requests,
+             (unsigned long long)failures, (unsigned long long)stats.requests,
+             push.subscribers, (unsigned long long)push.frames_sent,
+             (unsigned long long)push.frames_dropped);
+      fflush(stdout);
+    }
+  }
+}
+
+int main() {
+  Settings settings;
+  settings.upstream_url = env_string("UPSTREAM_URL", DEFAULT_UPSTREAM_URL);
+  settings.port = env_int("PORT", DEFAULT_PORT);
+  settings.push_port = env_int("PUSH_PORT", DEFAULT_PUSH_PORT);
+  settings.poll_seconds = env_int("POLL_SECONDS", DEFAULT_POLL_SECONDS);
+  settings.ttl_seconds = env_int("SYMBOL_TTL_SECONDS", DEFAULT_SYMBOL_TTL_SECONDS);
+
+  // Unbuffered-ish output so docker logs show progress
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("Quote aggregator: upstream %s, poll every %d s\n",
+         settings.upstream_url.c_str(), settings.poll_seconds);
+
+  upstream_begin(settings.upstream_url);
+  std::thread(poll_upstream, settings).detach();
+  std::thread(push_server_run, (uint16_t)settings.push_port).detach();
+
+  return http_server_run((uint16_t)settings.port);
+}
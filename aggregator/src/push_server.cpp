@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "push_server.h"
+#include "http_server.h"
+#include "quote_frames.h"
+#include "config.h"
+
+static std::atomic<int> subscriber_count{0};
+static std::atomic<uint64_t> frames_sent{0};
+static std::atomic<uint64_t> frames_dropped{0};
+
+struct Subscriber {
+  int fd;
+  std::string input;                   // Received, not yet a whole line
+  std::vector<std::string> symbols;
+  std::vector<QuoteWireRecord> sent;   // What the client has, by symbol
+  uint32_t sequence;
+  bool snapshot_due;
+  time_t last_frame;
+  time_t last_request;                 // Symbols re-registered with the cache
+};
+
+static void subscribe(Subscriber* sub, const std::string& query) {
+  sub->symbols.clear();
+  for (const std::string& s : parse_symbols(query)) {
+    if (valid_symbol(s) && cache_request(s)) sub->symbols.push_back(s);
+  }
+  sub->sent.assign(sub->symbols.size(), QuoteWireRecord());
+  sub->last_request = time(nullptr);
+  sub->snapshot_due = true;
+}
+
+// Handle whatever the client sent. With wait set, blocks (up to the socket
+// timeout) until something arrives. Returns false once the connection
+// should close.
+static bool read_commands(Subscriber* sub, bool wait) {
+  char buf[512];
+  ssize_t n = recv(sub->fd, buf, sizeof(buf), wait ? 0 : MSG_DONTWAIT);
+  if (n == 0) return false;
+  if (n < 0) return !wait && (errno == EAGAIN || errno == EWOULDBLOCK);
+
+  sub->input.append(buf, n);
+  size_t end;
+  while ((end = sub->input.find('\n')) != std::string::npos) {
+    std::string line = sub->input.substr(0, end);
+    sub->input.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    if (line.compare(0, 10, "SUBSCRIBE ") == 0) {
+      subscribe(sub, line.substr(10));
+    } else if (line == "RESYNC") {
+      sub->snapshot_due = true;
+    } else if (!line.empty()) {
+      return false;
+    }
+  }
+  return sub->input.size() < REQUEST_MAX_BYTES;
+}
+
+static bool send_frame(Subscriber* sub, const QuoteWireRecord* records, int count, uint16_t flags) {
+  uint8_t frame[QUOTE_WIRE_FRAME_SIZE(AGGREGATOR_MAX_PER_REQUEST)];
+  for (int i = 0; i < count; i++) {
+    quote_wire_put_record(frame, i, records[i]);
+  }
+  quote_wire_finish(frame, (uint16_t)count, sub->sequence++, flags);
+
+  size_t len = QUOTE_WIRE_FRAME_SIZE(count), sent = 0;
+  while (sent < len) {
+    ssize_t n = send(sub->fd, frame + sent, len - sent, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += n;
+  }
+  sub->last_frame = time(nullptr);
+  frames_sent++;
+  return true;
+}
+
+// Snapshot if one is due, otherwise whatever changed since the last frame
+static bool send_updates(Subscriber* sub) {
+  QuoteWireRecord records[AGGREGATOR_MAX_PER_REQUEST];
+  size_t slot[AGGREGATOR_MAX_PER_REQUEST];
+  int count = 0;
+  bool snapshot = sub->snapshot_due;
+
+  for (size_t i = 0; i < sub->symbols.size(); i++) {
+    CachedQuote q;
+    bool known = cache_get(sub->symbols[i], &q) && q.valid;
+    QuoteWireRecord r = quote_record(sub->symbols[i], known ? &q : nullptr);
+    if (snapshot || quote_record_changed(sub->sent[i], r)) {
+      slot[count] = i;
+      records[count++] = r;
+    }
+  }
+
+  time_t now = time(nullptr);
+  bool heartbeat_due = now - sub->last_frame >= PUSH_HEARTBEAT_SECONDS;
+  if (count == 0 && !snapshot && !heartbeat_due) return true;
+
+  // A client that is not keeping up misses this delta. The sequence still
+  // moves, so it sees the gap and resyncs once it has caught up.
+  int queued = 0;
+  if (!snapshot && ioctl(sub->fd, SIOCOUTQ, &queued) == 0 && queued > PUSH_MAX_BACKLOG_BYTES) {
+    sub->sequence++;
+    frames_dropped++;
+    return true;
+  }
+
+  if (!send_frame(sub, records, count, snapshot ? QUOTE_WIRE_SNAPSHOT : 0)) return false;
+
+  // Record what the client has now
+  for (int n = 0; n < count; n++) {
+    sub->sent[slot[n]] = records[n];
+  }
+  sub->snapshot_due = false;
+  return true;
+}
+
+static void serve_subscriber(int fd) {
+  Subscriber sub = {};
+  sub.fd = fd;
+  sub.last_frame = time(nullptr);
+
+  // Nothing is sent until the client has said what it wants
+  bool open = true;
+  while (open && sub.symbols.empty()) {
+    open = read_commands(&sub, true);
+  }
+
+  uint64_t seen = 0;
+  while (open) {
+    open = send_updates(&sub) && read_commands(&sub, false);
+    if (!open) break;
+
+    seen = cache_wait_update(seen, PUSH_WAKE_MS);
+
+    // Keep the symbols polled for as long as the client stays connected
+    if (time(nullptr) - sub.last_request >= PUSH_HEARTBEAT_SECONDS) {
+      for (const std::string& s : sub.symbols) cache_request(s);
+      sub.last_request = time(nullptr);
+    }
+  }
+
+  close(fd);
+  subscriber_count--;
+}
+
+int push_server_run(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("push socket");
+    return 1;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 32) < 0) {
+    perror("push bind/listen");
+    close(fd);
+    return 1;
+  }
+  printf("Pushing quotes to subscribers on port %u\n", (unsigned)port);
+
+  for (;;) {
+    int client = accept(fd, nullptr, nullptr);
+    if (client < 0) continue;
+
+    if (subscriber_count >= PUSH_MAX_SUBSCRIBERS) {
+      close(client);
+      continue;
+    }
+
+    // The receive timeout only applies while waiting for SUBSCRIBE; after
+    // that the socket is read without blocking
+    timeval timeout = {CLIENT_TIMEOUT_SECONDS, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    subscriber_count++;
+    std::thread(serve_subscriber, client).detach();
+  }
+}
+
+void push_server_stats(PushStats* stats) {
+  stats->subscribers = subscriber_count;
+  stats->frames_sent = frames_sent;
+  stats->frames_dropped = frames_dropped;
+}
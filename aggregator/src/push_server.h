@@ -0,0 +1,38 @@
+#ifndef PUSH_SERVER_H
+#define PUSH_SERVER_H
+
+#include <stdint.h>
+
+// Push subscriptions: a tracker keeps one TCP connection open and is sent
+// only the quotes that changed, as soon as the poller has them, instead of
+// asking for its whole watchlist every interval.
+//
+// The tracker sends text lines, the server answers with binary frames
+// (include/quote_wire.h) back to back on the same connection:
+//
+//   SUBSCRIBE symbols=AAPL,MSFT   Register the watchlist (again, to change
+//                                 it). Answered with a snapshot frame.
+//   RESYNC                        Ask for a snapshot, after a sequence gap
+//
+// A snapshot has one record per subscribed symbol, in order. Invalid symbols
+// and those past AGGREGATOR_MAX_PER_REQUEST are left out, so the client can
+// tell from the snapshot which ones it still has to poll itself. After that,
+// delta frames carry only the records that changed. A delta with no records
+// is sent as a heartbeat when nothing changed for a while. Frame sequence
+// numbers count up by one per connection; when a slow client has too much
+// unsent data queued, deltas are skipped (the sequence still counts them)
+// and the gap tells the client to resync.
+
+struct PushStats {
+  int subscribers;
+  uint64_t frames_sent;
+  uint64_t frames_dropped;
+};
+
+// Bind and serve forever, one thread per subscriber. Returns only if the
+// socket cannot be opened.
+int push_server_run(uint16_t port);
+
+void push_server_stats(PushStats* stats);
+
+#endif
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include "quote_cache.h"
+#include "config.h"
+
+struct Entry {
+  CachedQuote quote;
+  time_t last_requested;
+  time_t last_attempt; // 0 = never tried
+};
+
+static std::mutex lock;
+static std::condition_variable changed; // New symbol requested, or a fetch finished
+static std::map<std::string, Entry> entries;
+static uint64_t updates = 0;
+
+bool cache_request(const std::string& symbol) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = entries.find(symbol);
+  if (it == entries.end()) {
+    if (entries.size() >= AGGREGATOR_MAX_SYMBOLS) return false;
+    Entry e = {};
+    it = entries.emplace(symbol, e).first;
+    changed.notify_all(); // Wake the poller for the new symbol
+  }
+  it->second.last_requested = time(nullptr);
+  return true;
+}
+
+bool cache_get(const std::string& symbol, CachedQuote* quote) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = entries.find(symbol);
+  if (it == entries.end()) return false;
+  *quote = it->second.quote;
+  return true;
+}
+
+void cache_wait_attempted(const std::string& symbol, int timeout_ms) {
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait_for(guard, std::chrono::milliseconds(timeout_ms), [&] {
+    auto it = entries.find(symbol);
+    return it == entries.end() || it->second.last_attempt != 0;
+  });
+}
+
+std::vector<std::string> cache_due_symbols(int poll_seconds, int ttl_seconds, int wait_ms) {
+  std::unique_lock<std::mutex> guard(lock);
+  std::vector<std::string> due;
+
+  auto collect = [&] {
+    time_t now = time(nullptr);
+    due.clear();
+    for (auto it = entries.begin(); it != entries.end();) {
+      Entry& e = it->second;
+      if (now - e.last_requested > ttl_seconds) {
+        // Nobody has shown this symbol for a while, stop polling it
+        it = entries.erase(it);
+        continue;
+      }
+      if (e.last_attempt == 0 || now - e.last_attempt >= poll_seconds) {
+        due.push_back(it->first);
+      }
+      ++it;
+    }
+    return !due.empty();
+  };
+
+  changed.wait_for(guard, std::chrono::milliseconds(wait_ms), collect);
+  return due;
+}
+
+void cache_store(const std::string& symbol, bool ok, const CachedQuote& quote, int status) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = entries.find(symbol);
+  if (it == entries.end()) return;
+
+  Entry& e = it->second;
+  e.last_attempt = time(nullptr);
+  e.quote.last_status = status;
+  if (ok) {
+    // Keep the last good quote if a refresh fails
+    e.quote.valid = true;
+    e.quote.price = quote.price;
+    e.quote.prev_close = quote.prev_close;
+    e.quote.volume = quote.volume;
+    e.quote.market_time = quote.market_time;
+    e.quote.updated = e.last_attempt;
+    updates++;
+  }
+  changed.notify_all();
+}
+
+uint64_t cache_wait_update(uint64_t seen, int timeout_ms) {
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait_for(guard, std::chrono::milliseconds(timeout_ms), [&] { return updates != seen; });
+  return updates;
+}
+
+size_t cache_size() {
+  std::lock_guard<std::mutex> guard(lock);
+  return entries.size();
+}
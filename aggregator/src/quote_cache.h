@@ -0,0 +1,48 @@
+#ifndef QUOTE_CACHE_H
+#define QUOTE_CACHE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+// Shared quote cache. Devices register the symbols they ask for; the poller
+// refreshes every symbol that was asked for recently, once per poll interval,
+// however many devices show it. All functions are thread-safe.
+
+struct CachedQuote {
+  bool valid;        // A quote has been fetched at least once
+  double price;
+  double prev_close;
+  uint64_t volume;
+  time_t updated;    // When the quote was fetched
+  time_t market_time; // Exchange time of the quote, if upstream gave one
+  int last_status;   // HTTP status of the last attempt (negative: transport error)
+};
+
+// A device asked for this symbol. Returns false if the symbol table is full.
+bool cache_request(const std::string& symbol);
+
+// Copy the cached quote. Returns false if the symbol is unknown.
+bool cache_get(const std::string& symbol, CachedQuote* quote);
+
+// Wait until the symbol has been tried upstream at least once, or until
+// timeout_ms passes. Lets the first request for a new symbol be answered
+// with data instead of a blank line.
+void cache_wait_attempted(const std::string& symbol, int timeout_ms);
+
+// Symbols that were requested within ttl_seconds and not refreshed for
+// poll_seconds (or never tried). Blocks up to wait_ms while there are none.
+std::vector<std::string> cache_due_symbols(int poll_seconds, int ttl_seconds, int wait_ms);
+
+// Record the result of an upstream fetch
+void cache_store(const std::string& symbol, bool ok, const CachedQuote& quote, int status);
+
+// The update counter goes up with every successful fetch. Blocks up to
+// timeout_ms while it is still at seen, and returns its current value, so
+// push subscribers wake as soon as there is something to send.
+uint64_t cache_wait_update(uint64_t seen, int timeout_ms);
+
+size_t cache_size();
+
+#endif
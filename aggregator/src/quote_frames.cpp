@@ -0,0 +1,21 @@
+#include <stdint.h>
+#include "quote_frames.h"
+
+QuoteWireRecord quote_record(const std::string& symbol, const CachedQuote* quote) {
+  QuoteWireRecord r = {};
+  r.symbol_id = quote_wire_symbol_id(symbol.c_str());
+  if (quote) {
+    quote_wire_scale(quote->price, quote->prev_close, &r);
+    r.volume = quote->volume > UINT32_MAX ? UINT32_MAX : (uint32_t)quote->volume;
+    r.market_time = (uint32_t)(quote->market_time ? quote->market_time : quote->updated);
+    r.flags = QUOTE_WIRE_VALID;
+  }
+  return r;
+}
+
+// The exchange time alone does not count, it moves on every poll even when
+// nothing traded
+bool quote_record_changed(const QuoteWireRecord& a, const QuoteWireRecord& b) {
+  return a.flags != b.flags || a.decimals != b.decimals || a.price != b.price ||
+         a.prev_close != b.prev_close || a.volume != b.volume;
+}
@@ -0,0 +1,18 @@
+#ifndef QUOTE_FRAMES_H
+#define QUOTE_FRAMES_H
+
+#include <string>
+#include "quote_cache.h"
+#include "quote_wire.h"
+
+// Binary records (quote_wire.h) built from the cache, for /quotes.bin and
+// the push subscriptions
+
+// The record for a symbol. With quote null (no quote yet) only the symbol
+// id is filled in and the record is not flagged valid.
+QuoteWireRecord quote_record(const std::string& symbol, const CachedQuote* quote);
+
+// True if a subscriber that was sent a needs to be sent b
+bool quote_record_changed(const QuoteWireRecord& a, const QuoteWireRecord& b);
+
+#endif
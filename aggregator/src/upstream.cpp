@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+#include "upstream.h"
+#include "config.h"
+
+static std::string base;
+static CURL* curl = nullptr; // Reused so the TLS session and connection are kept
+
+static size_t on_body(char* data, size_t size, size_t count, void* user) {
+  std::string* body = (std::string*)user;
+  size_t len = size * count;
+  if (body->size() + len > UPSTREAM_MAX_BODY) return 0; // Aborts the transfer
+  body->append(data, len);
+  return len;
+}
+
+void upstream_begin(const std::string& base_url) {
+  base = base_url;
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  curl = curl_easy_init();
+}
+
+bool json_number(const std::string& body, const char* key, double* value) {
+  std::string pattern = std::string("\"") + key + "\":";
+  size_t at = body.find(pattern);
+  if (at == std::string::npos) return false;
+
+  const char* start = body.c_str() + at + pattern.size();
+  char* end = nullptr;
+  double v = strtod(start, &end);
+  if (end == start) return false; // null or a string
+  *value = v;
+  return true;
+}
+
+bool upstream_fetch(const std::string& symbol, CachedQuote* quote, int* status) {
+  std::string url = base + symbol;
+  std::string body;
+
+  curl_easy_reset(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, UPSTREAM_USER_AGENT);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)UPSTREAM_TIMEOUT_SECONDS);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // Any encoding curl supports
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, on_body);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+  CURLcode rc = curl_easy_perform(curl);
+  if (rc != CURLE_OK) {
+    fprintf(stderr, "upstream: %s: %s\n", symbol.c_str(), curl_easy_strerror(rc));
+    *status = -(int)rc;
+    return false;
+  }
+
+  long code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+  *status = (int)code;
+  if (code != 200) {
+    fprintf(stderr, "upstream: %s: HTTP %ld\n", symbol.c_str(), code);
+    return false;
+  }
+
+  double price = 0, prev_close = 0, volume = 0, market_time = 0;
+  if (!json_number(body, "regularMarketPrice", &price)) {
+    fprintf(stderr, "upstream: %s: no price in response\n", symbol.c_str());
+    return false;
+  }
+  // Same fallback as the firmware's detail view
+  if (!json_number(body, "previousClose", &prev_close)) {
+    json_number(body, "chartPreviousClose", &prev_close);
+  }
+  json_number(body, "regularMarketVolume", &volume);
+  json_number(body, "regularMarketTime", &market_time);
+
+  if (price <= 0 || prev_close <= 0) {
+    fprintf(stderr, "upstream: %s: invalid price data\n", symbol.c_str());
+    return false;
+  }
+
+  quote->price = price;
+  quote->prev_close = prev_close;
+  quote->volume = (uint64_t)volume;
+  quote->market_time = (time_t)market_time;
+  return true;
+}
@@ -0,0 +1,20 @@
+#ifndef UPSTREAM_H
+#define UPSTREAM_H
+
+#include <string>
+#include "quote_cache.h"
+
+// Upstream quote source: a Yahoo Finance v8 chart endpoint (or anything that
+// answers in the same shape, such as the stand-in in upstream_stub/).
+
+void upstream_begin(const std::string& base_url);
+
+// Fetch one symbol. Returns true with the quote filled in on success. status
+// is the HTTP status, or a negative curl error code.
+bool upstream_fetch(const std::string& symbol, CachedQuote* quote, int* status);
+
+// Pull a number out of a JSON body by key, without a full parser. The chart
+// response has each key we need exactly once, inside "meta".
+bool json_number(const std::string& body, const char* key, double* value);
+
+#endif
@@ -0,0 +1,86 @@
+"""Subscribe to the aggregator's push port and print every frame, checking
+checksums and sequence numbers the way the tracker does.
+
+    python3 push_client.py [host] [port] AAPL,MSFT,NVDA
+
+--resync sends RESYNC every few frames, to exercise the snapshot path.
+"""
+
+import socket
+import struct
+import sys
+import time
+import zlib
+
+HEADER = struct.Struct("<HBBHHII")
+RECORD = struct.Struct("<IiiIIBBH")
+SNAPSHOT = 0x0001
+VALID = 0x01
+
+
+def symbol_id(symbol):
+    h = 2166136261
+    for c in symbol.upper().encode():
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def read_exact(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("closed by the server")
+        data += chunk
+    return data
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    resync = "--resync" in sys.argv
+    host = args[0] if len(args) > 2 else "localhost"
+    port = int(args[1]) if len(args) > 2 else 8081
+    symbols = (args[-1] if args else "AAPL,MSFT").upper().split(",")
+    names = {symbol_id(s): s for s in symbols}
+
+    sock = socket.create_connection((host, port))
+    sock.sendall(f"SUBSCRIBE symbols={','.join(symbols)}\n".encode())
+
+    expected = None
+    frames = 0
+    total_bytes = 0
+    while True:
+        header = read_exact(sock, HEADER.size)
+        magic, version, record_size, count, flags, seq, crc = HEADER.unpack(header)
+        if magic != 0x5751 or version != 1 or record_size != RECORD.size:
+            sys.exit(f"bad header {header.hex()}")
+        body = read_exact(sock, count * RECORD.size)
+        if zlib.crc32(header[:12] + b"\0" * 4 + body) != crc:
+            sys.exit("checksum mismatch")
+        frames += 1
+        total_bytes += len(header) + len(body)
+
+        kind = "snapshot" if flags & SNAPSHOT else ("heartbeat" if count == 0 else "delta")
+        gap = expected is not None and seq != expected and not flags & SNAPSHOT
+        expected = seq + 1
+        print(f"{time.strftime('%H:%M:%S')} #{seq} {kind}, {count} records, "
+              f"{total_bytes} bytes so far{'  GAP' if gap else ''}")
+        for i in range(count):
+            sid, price, prev, volume, mtime, rflags, decimals, _ = \
+                RECORD.unpack_from(body, i * RECORD.size)
+            name = names.get(sid, hex(sid))
+            if rflags & VALID:
+                scale = 10 ** decimals
+                print(f"    {name:10} {price / scale:12.4f} {prev / scale:12.4f} {volume:>12}")
+            else:
+                print(f"    {name:10} (no quote yet)")
+
+        if gap or (resync and frames % 5 == 0):
+            sock.sendall(b"RESYNC\n")
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
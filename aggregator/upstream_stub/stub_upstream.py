@@ -0,0 +1,177 @@
+"""Stand-in for the quote APIs, for testing the aggregator and the
+tracker's quote providers without touching the real upstreams.
+
+Serves, with prices doing a slow random walk:
+
+    GET /v8/finance/chart/<SYMBOL>           Yahoo chart (one symbol)
+    GET /v7/finance/quote?symbols=A,B        Yahoo multi-quote
+    GET /q/l/?s=a.us,b.us&f=...&h&e=csv      Stooq CSV
+
+Symbols starting with "ERR" answer 500 on the chart and are left out of the
+batch answers, and "BAD" ones come without a price, to exercise the error
+paths. Every request is counted; GET /stats shows the counts.
+
+Whole providers can be made slow or failing, to watch the tracker fail
+over: GET /faults?stooq=503&quote_delay_ms=1500 sets a status or a delay
+per provider (chart, quote, stooq), /faults?reset clears them and /faults
+alone shows them.
+"""
+
+import json
+import random
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs
+
+PORT = int(sys.argv[1]) if len(sys.argv) > 1 else 8090
+
+prices = {}
+requests = {}
+faults = {}
+PROVIDERS = ("chart", "quote", "stooq")
+
+
+def quote(symbol):
+    if symbol not in prices:
+        base = 20 + (sum(map(ord, symbol)) % 400)
+        prices[symbol] = [float(base), float(base)]  # price, previous close
+    p = prices[symbol]
+    p[0] = round(max(1.0, p[0] * (1 + random.uniform(-0.002, 0.002))), 2)
+    return p[0], p[1]
+
+
+def volume():
+    return random.randint(1_000_000, 90_000_000)
+
+
+class Handler(BaseHTTPRequestHandler):
+    def do_GET(self):
+        path, _, query = self.path.partition("?")
+        args = parse_qs(query, keep_blank_values=True)
+
+        if path == "/stats":
+            self.reply(200, json.dumps(requests, indent=1))
+            return
+        if path == "/faults":
+            self.set_faults(args)
+            return
+
+        if path.startswith("/v8/finance/chart/"):
+            self.chart(path[len("/v8/finance/chart/"):].upper())
+        elif path == "/v7/finance/quote":
+            self.multi_quote(args.get("symbols", [""])[0].upper().split(","))
+        elif path == "/q/l/":
+            self.stooq(args.get("s", [""])[0].upper().split(","))
+        else:
+            self.reply(404, "not found")
+
+    def count(self, key):
+        requests[key] = requests.get(key, 0) + 1
+
+    def injected(self, provider):
+        """Apply the provider's injected delay; True if it should fail."""
+        self.count("provider:" + provider)
+        time.sleep(faults.get(provider + "_delay_ms", 0) / 1000)
+        status = faults.get(provider, 0)
+        if status:
+            self.reply(status, "injected failure")
+        return bool(status)
+
+    def set_faults(self, args):
+        if "reset" in args:
+            faults.clear()
+        for key, values in args.items():
+            name = key[:-len("_delay_ms")] if key.endswith("_delay_ms") else key
+            if name in PROVIDERS:
+                faults[key] = int(values[0] or 0)
+        self.reply(200, json.dumps(faults, indent=1))
+
+    def chart(self, symbol):
+        self.count(symbol)
+        if self.injected("chart"):
+            return
+        if symbol.startswith("ERR"):
+            self.reply(500, "upstream error")
+            return
+
+        price, prev_close = quote(symbol)
+        meta = {
+            "currency": "USD",
+            "symbol": symbol,
+            "regularMarketTime": int(time.time()),
+            "regularMarketPrice": price,
+            "regularMarketDayHigh": round(max(price, prev_close) * 1.01, 2),
+            "regularMarketDayLow": round(min(price, prev_close) * 0.99, 2),
+            "regularMarketVolume": volume(),
+            "chartPreviousClose": prev_close,
+            "previousClose": prev_close,
+        }
+        if symbol.startswith("BAD"):
+            del meta["regularMarketPrice"]
+
+        body = {"chart": {"result": [{"meta": meta, "timestamp": [],
+                                      "indicators": {"quote": [{"close": []}]}}],
+                          "error": None}}
+        self.reply(200, json.dumps(body), "application/json")
+
+    def multi_quote(self, symbols):
+        if self.injected("quote"):
+            return
+        result = []
+        for symbol in filter(None, symbols):
+            self.count(symbol)
+            if symbol.startswith("ERR"):
+                continue
+            price, prev_close = quote(symbol)
+            q = {
+                "language": "en-US", "region": "US", "quoteType": "EQUITY",
+                "currency": "USD", "marketState": "REGULAR", "exchange": "NMS",
+                "shortName": symbol + " Inc.",
+                "regularMarketChange": round(price - prev_close, 2),
+                "regularMarketChangePercent": (price - prev_close) / prev_close * 100,
+                "regularMarketTime": int(time.time()),
+                "regularMarketPrice": price,
+                "regularMarketPreviousClose": prev_close,
+                "regularMarketVolume": volume(),
+                "symbol": symbol,
+            }
+            if symbol.startswith("BAD"):
+                del q["regularMarketPrice"]
+            result.append(q)
+        body = {"quoteResponse": {"result": result, "error": None}}
+        self.reply(200, json.dumps(body), "application/json")
+
+    def stooq(self, symbols):
+        if self.injected("stooq"):
+            return
+        now = time.gmtime()
+        lines = ["Symbol,Date,Time,Open,High,Low,Close,Volume,Prev"]
+        for stooq_symbol in filter(None, symbols):
+            symbol = stooq_symbol.split(".")[0]
+            self.count(symbol)
+            if symbol.startswith("ERR") or symbol.startswith("BAD"):
+                # How Stooq answers for a symbol it does not know
+                lines.append(stooq_symbol + ",N/D" * 8)
+                continue
+            price, prev_close = quote(symbol)
+            lines.append("%s,%s,%s,%.2f,%.2f,%.2f,%.2f,%d,%.2f" % (
+                stooq_symbol, time.strftime("%Y-%m-%d", now), time.strftime("%H:%M:%S", now),
+                prev_close, max(price, prev_close), min(price, prev_close), price, volume(), prev_close))
+        self.reply(200, "\r\n".join(lines) + "\r\n", "text/csv")
+
+    def reply(self, status, text, content_type="text/plain"):
+        data = text.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, fmt, *args):
+        sys.stderr.write("stub: " + (fmt % args) + "\n")
+
+
+if __name__ == "__main__":
+    print(f"Stand-in upstream on port {PORT}", flush=True)
+    ThreadingHTTPServer(("", PORT), Handler).serve_forever()
@@ -0,0 +1,220 @@
+// Host benchmark and check of the detail view's chart reader
+// (src/chart_stream.cpp) on chart responses from files.
+//
+//   chart_stream_bench [--check] [iterations] response.json...
+//
+// Each response is fed in 512 byte chunks, as detail_fetch() does, and also
+// one byte at a time and in odd sizes; every way has to pick the same
+// points, and the same points as a plain LTTB over the whole series. With
+// --check it stops there, for ctest. Otherwise it times the 512 byte path.
+// Times are host times; the ESP32 is roughly 20-50x slower.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "chart_stream.h"
+
+#define PLOT_WIDTH 220 // DETAIL_CHART_WIDTH
+#define DEVICE_CHUNK 512
+
+static const size_t CHUNK_SIZES[] = {DEVICE_CHUNK, 1, 7, 333, 4096};
+
+static ChartStream cs; // Static on the device as well
+static volatile float sink;
+
+static bool read_file(const char* path, std::string* out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static int run(const std::string& body, size_t chunk, ChartPoint* out) {
+  chart_stream_begin(&cs, out, PLOT_WIDTH);
+  for (size_t at = 0; at < body.size(); at += chunk) {
+    size_t n = body.size() - at < chunk ? body.size() - at : chunk;
+    chart_stream_feed(&cs, body.data() + at, n);
+  }
+  return chart_stream_finish(&cs);
+}
+
+// Elements of the first array under "key", nulls as NAN
+static std::vector<double> json_array(const std::string& body, const char* key) {
+  std::vector<double> values;
+  size_t at = body.find(std::string("\"") + key + "\":[");
+  if (at == std::string::npos) return values;
+  const char* p = body.c_str() + body.find('[', at) + 1;
+  while (*p && *p != ']') {
+    if (strncmp(p, "null", 4) == 0) {
+      values.push_back(NAN);
+      p += 4;
+    } else {
+      char* end;
+      values.push_back(strtod(p, &end));
+      p = end;
+    }
+    if (*p == ',') p++;
+  }
+  return values;
+}
+
+// Textbook LTTB over the whole series, with the bucket layout the stream
+// uses: positions 1 .. n-2 in PLOT_WIDTH - 2 buckets of `every` positions,
+// the last position on its own, and missing minutes simply absent
+static std::vector<ChartPoint> reference_lttb(const std::vector<double>& close, int n) {
+  std::vector<ChartPoint> points, selected;
+  for (size_t i = 0; i < close.size(); i++) {
+    if (!isnan(close[i])) points.push_back({(uint16_t)i, (float)close[i]});
+  }
+  if (points.empty()) return selected;
+
+  int w = PLOT_WIDTH, final_bucket = w - 2;
+  double every = (double)(n - 2) / (w - 2);
+  auto bucket_of = [&](int index) {
+    if (index >= n - 1) return final_bucket;
+    int b = 0;
+    while (b < final_bucket - 1 && (int)floor((b + 1) * every) + 1 <= index) b++;
+    return b;
+  };
+
+  struct Group {
+    int bucket;
+    std::vector<ChartPoint> candidates;
+    double sum_x = 0, sum_y = 0;
+    int seen = 0;
+  };
+  std::vector<Group> groups;
+  for (size_t i = 1; i < points.size(); i++) {
+    int b = bucket_of(points[i].index);
+    if (groups.empty() || groups.back().bucket != b) groups.push_back({b, {}});
+    Group& g = groups.back();
+    g.sum_x += points[i].index;
+    g.sum_y += points[i].value;
+    g.seen++;
+    if (i + 1 < points.size()) g.candidates.push_back(points[i]); // The last point is kept as-is
+  }
+
+  ChartPoint anchor = points.front(), last = points.back();
+  selected.push_back(anchor);
+  auto select = [&](const Group& g, double cx, double cy) {
+    if (g.candidates.empty()) return;
+    size_t best = 0;
+    double best_area = -1;
+    for (size_t i = 0; i < g.candidates.size(); i++) {
+      const ChartPoint& p = g.candidates[i];
+      double area = fabs((anchor.index - cx) * (p.value - anchor.value) -
+                         (anchor.index - p.index) * (cy - anchor.value));
+      if (area > best_area) {
+        best_area = area;
+        best = i;
+      }
+    }
+    anchor = g.candidates[best];
+    selected.push_back(anchor);
+  };
+  for (size_t g = 0; g < groups.size(); g++) {
+    if (g + 1 < groups.size()) {
+      select(groups[g], groups[g + 1].sum_x / groups[g + 1].seen, groups[g + 1].sum_y / groups[g + 1].seen);
+    } else if (groups[g].bucket != final_bucket) {
+      select(groups[g], last.index, last.value);
+    }
+  }
+  if (last.index != anchor.index) selected.push_back(last);
+  return selected;
+}
+
+static bool same_points(const ChartPoint* a, int count, const std::vector<ChartPoint>& b) {
+  if (count != (int)b.size()) return false;
+  for (int i = 0; i < count; i++) {
+    if (a[i].index != b[i].index || a[i].value != b[i].value) return false;
+  }
+  return true;
+}
+
+static bool check(const char* path, const std::string& body) {
+  static ChartPoint out[PLOT_WIDTH];
+  std::vector<double> timestamps = json_array(body, "timestamp");
+  std::vector<double> close = json_array(body, "close");
+  int n = (int)timestamps.size();
+  if (n < 3 || close.size() != timestamps.size()) {
+    fprintf(stderr, "%s: no timestamp/close series\n", path);
+    return false;
+  }
+  if ((double)(n - 2) / (PLOT_WIDTH - 2) >= CHART_BUCKET_CAPACITY) {
+    fprintf(stderr, "%s: %d points thin the buckets, no reference for that\n", path, n);
+    return false;
+  }
+  std::vector<ChartPoint> expected = reference_lttb(close, n);
+
+  for (size_t chunk : CHUNK_SIZES) {
+    int count = run(body, chunk, out);
+    if (!same_points(out, count, expected)) {
+      fprintf(stderr, "%s: %zu byte chunks picked %d points, the reference %zu or others\n",
+              path, chunk, count, expected.size());
+      return false;
+    }
+    if (cs.series_length != n || cs.day_high <= 0 || cs.day_low <= 0 || cs.previous_close <= 0 ||
+        cs.volume == 0) {
+      fprintf(stderr, "%s: meta not read with %zu byte chunks\n", path, chunk);
+      return false;
+    }
+  }
+
+  int nulls = 0;
+  for (double v : close) nulls += isnan(v);
+  printf("%s: %d points (%d null) -> %zu, identical for every chunk size\n",
+         path, n, nulls, expected.size());
+  return true;
+}
+
+static double time_ns(int iterations, const std::string& body) {
+  static ChartPoint out[PLOT_WIDTH];
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    run(body, DEVICE_CHUNK, out);
+    sink = out[0].value;
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+  int arg = 1;
+  bool check_only = arg < argc && strcmp(argv[arg], "--check") == 0;
+  if (check_only) arg++;
+  int iterations = 2000;
+  if (arg < argc && argv[arg][0] >= '0' && argv[arg][0] <= '9') iterations = atoi(argv[arg++]);
+  if (arg >= argc || iterations < 1) {
+    fprintf(stderr, "usage: %s [--check] [iterations] response.json...\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<std::string> bodies;
+  for (int i = arg; i < argc; i++) {
+    std::string body;
+    if (!read_file(argv[i], &body)) {
+      fprintf(stderr, "%s: cannot read\n", argv[i]);
+      return 1;
+    }
+    if (!check(argv[i], body)) return 1;
+    bodies.push_back(body);
+  }
+  if (check_only) return 0;
+
+  printf("\nchart_stream state %zu bytes, %d byte chunks, %d iterations\n\n",
+         sizeof(ChartStream), DEVICE_CHUNK, iterations);
+  printf("%-40s %9s %12s %10s\n", "response", "bytes", "us/response", "MB/s");
+  for (size_t i = 0; i < bodies.size(); i++) {
+    double ns = time_ns(iterations, bodies[i]);
+    printf("%-40s %9zu %12.1f %10.1f\n", argv[arg + i], bodies[i].size(), ns / 1000,
+           bodies[i].size() / ns * 1000);
+  }
+  return 0;
+}
@@ -7,18 +7,248 @@
 // WiFi Settings - Will be configured via WiFiManager
 // No hardcoded credentials needed
 
+// Fast reconnect - the last access point, channel and DHCP lease are cached
+// and tried first; WiFiManager only runs if that fails
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000
+// 1 = skip DHCP by reusing the last address. It is never renewed with the
+// router, so only use it if the router reserves the address for the tracker.
+#define WIFI_REUSE_LEASE 0
+
+// Reconnecting after a dropout: attempts back off from MIN to MAX
+#define WIFI_RETRY_MIN_MS 1000
+#define WIFI_RETRY_MAX_MS 60000
+#define WIFI_ATTEMPT_TIMEOUT_MS 10000  // Give up on one attempt after this
+
+// Optional fixed address instead of DHCP (used by both connect paths)
+#define WIFI_STATIC_IP 0
+#define WIFI_STATIC_ADDRESS 192, 168, 1, 50
+#define WIFI_STATIC_GATEWAY 192, 168, 1, 1
+#define WIFI_STATIC_SUBNET 255, 255, 255, 0
+#define WIFI_STATIC_DNS 192, 168, 1, 1
+
 // Time Zone Settings (offset from UTC in hours)
 #define TIMEZONE_OFFSET -8  // PST (Pacific Standard Time)
 
 // Stock symbols to track
-const char* STOCK_SYMBOLS[] = {"AAPL", "GOOGL", "NVDA", "TSLA", "META", "AMZN", "MSFT", "AMD"};
-const char* STOCK_NAMES[] = {"AAPL", "GOOGL", "NVDA", "TSLA", "META", "AMZN", "MSFT", "AMD"};
-const int NUM_STOCKS = 8;
+static const char* STOCK_SYMBOLS[] = {"AAPL", "GOOGL", "NVDA", "TSLA", "META", "AMZN", "MSFT", "AMD"};
+static const char* STOCK_NAMES[] = {"AAPL", "GOOGL", "NVDA", "TSLA", "META", "AMZN", "MSFT", "AMD"};
+static const int NUM_STOCKS = sizeof(STOCK_SYMBOLS) / sizeof(STOCK_SYMBOLS[0]);
+
+// Screen layout
+#define LAYOUT_TABLE 0   // Fixed table, rows redrawn when prices change
+#define LAYOUT_TICKER 1  // Whole watchlist scrolls up continuously (ticker tape)
+#define DISPLAY_LAYOUT LAYOUT_TABLE
+
+// Ticker tape settings (LAYOUT_TICKER only)
+#define TICKER_ROW_HEIGHT 24  // Pixel lines per symbol
+#define TICKER_STEP_MS 16     // One line per step, ~60 lines per second
+
+// Watchlist display - the list can be longer than the screen. Only the
+// visible rows are drawn; the rest are paged in and refreshed less often.
+#define WATCHLIST_VISIBLE_ROWS 9          // Rows that fit between header and status line
+#define WATCHLIST_AUTO_SCROLL_SECONDS 10  // Page through long lists (0 = off)
+#define WATCHLIST_OFFSCREEN_FETCHES 4     // Off-screen symbols refreshed per update
+
+// Sparklines - small intraday price line at the end of each table row
+#define SPARKLINES_ENABLED 1
+#define SPARKLINE_POINTS 33   // Samples kept per symbol (one per quote received)
+
+// Last-known quotes are saved so the table can be shown at boot before WiFi
+// is up. Flash is only written when a price changed, at most this often.
+#define SNAPSHOT_SAVE_MINUTES 15
+
+// Extra table column with a streaming indicator for each symbol. Periods
+// count quotes, i.e. updates of UPDATE_INTERVAL_SECONDS.
+#define INDICATOR_NONE 0
+#define INDICATOR_EMA_FAST 1  // EMA(9)
+#define INDICATOR_EMA_SLOW 2  // EMA(21)
+#define INDICATOR_RSI 3       // RSI(14)
+#define INDICATOR_VWAP 4      // Session VWAP
+#define INDICATOR_DAY_HIGH 5
+#define INDICATOR_DAY_LOW 6
+#define INDICATOR_COLUMN INDICATOR_NONE
+
+// Touch screen (XPT2046) - tap a row to open the detail view for that symbol
+#define TOUCH_ENABLED 1
+#define TOUCH_PRESSURE_THRESHOLD 400  // Minimum pressure for a valid touch
+#define TOUCH_DEBOUNCE_MS 15          // Contact must be stable this long
+#define TOUCH_MOVE_TOLERANCE 12       // Pixels of jitter allowed while settling
+// Raw controller range mapped to the screen (adjust if taps land off target)
+#define TOUCH_RAW_X_MIN 200
+#define TOUCH_RAW_X_MAX 3700
+#define TOUCH_RAW_Y_MIN 240
+#define TOUCH_RAW_Y_MAX 3800
+#define TOUCH_SWAP_XY 0
+#define TOUCH_INVERT_X 0
+#define TOUCH_INVERT_Y 0
+
+// Detail view
+#define DETAIL_CACHE_SECONDS 60        // Reuse fetched day range/chart this long
+#define DETAIL_LATENCY_TARGET_MS 100   // Tap-to-first-pixel budget, flagged in the log
 
 // API Settings (Yahoo Finance - no API key needed)
 #define UPDATE_INTERVAL_SECONDS 60
+#define QUOTE_MAX_AGE_SECONDS 900 // Market hours: grey out a quote the exchange priced longer ago
+#define FETCH_SPACING_MS 500  // Gap between quote requests (rate limiting)
+
+// Quote providers for direct fetching (every source but the aggregator).
+// Each cycle goes to the enabled provider with the best rolling latency and
+// error rate; one that fails PROVIDER_FAILOVER_ERRORS requests in a row is
+// benched for a few cycles. Every PROVIDER_PROBE_CYCLES cycles the least
+// recently used one is measured again. Point the URLs at
+// aggregator/upstream_stub to test against fixtures.
+#define PROVIDER_YAHOO_CHART_ENABLED 1
+#define PROVIDER_YAHOO_QUOTE_ENABLED 0 // Needs a cookie and crumb from Yahoo, refused without
+#define PROVIDER_STOOQ_ENABLED 1
+#define YAHOO_CHART_URL "https://query1.finance.yahoo.com/v8/finance/chart/"
+#define YAHOO_QUOTE_URL "https://query1.finance.yahoo.com/v7/finance/quote?symbols="
+#define STOOQ_URL "https://stooq.com/q/l/?f=sd2t2ohlcvp&h&e=csv&s="
+#define STOOQ_SUFFIX ".us"            // Market for symbols without one
+#define PROVIDER_FAILOVER_ERRORS 3
+#define PROVIDER_PROBE_CYCLES 30
+
+// Where quotes come from. With several trackers, run the aggregator service
+// (aggregator/, part of docker-compose.yml) on a machine on the LAN: it
+// fetches each symbol once for all trackers, and the trackers skip TLS.
+#define QUOTE_SOURCE_YAHOO 0       // Each tracker asks Yahoo directly over HTTPS
+#define QUOTE_SOURCE_AGGREGATOR 1  // Ask the aggregator over plain HTTP
+#define QUOTE_SOURCE_MQTT 2        // Subscribe to quotes on an MQTT broker, no polling
+#define QUOTE_SOURCE_STREAM 3      // Yahoo's real-time WebSocket streamer
+#define QUOTE_SOURCE QUOTE_SOURCE_YAHOO
+#define AGGREGATOR_HOST "192.168.1.10"
+#define AGGREGATOR_PORT 8080
+// Fetch fixed-size binary records (/quotes.bin) instead of text lines; 24
+// bytes a symbol, checksummed, decoded without any parsing
+#define AGGREGATOR_BINARY 1
+// Push subscription: keep a connection to the aggregator open and receive
+// only the quotes that changed, within a second of the aggregator fetching
+// them. Polling every UPDATE_INTERVAL_SECONDS takes over while it is down.
+#define AGGREGATOR_PUSH (QUOTE_SOURCE == QUOTE_SOURCE_AGGREGATOR)
+#define AGGREGATOR_PUSH_PORT 8081
+
+// MQTT (QUOTE_SOURCE_MQTT): one topic per symbol, MQTT_TOPIC_PREFIX plus
+// the symbol (quotes/AAPL), with a payload of "price,prev_close[,volume]".
+// Publish retained so a tracker has every quote as soon as it subscribes.
+#define MQTT_HOST "192.168.1.10"
+#define MQTT_PORT 1883
+#define MQTT_USER ""                // Empty for an anonymous broker
+#define MQTT_PASSWORD ""
+#define MQTT_TOPIC_PREFIX "quotes/"
+#define MQTT_QOS 1                  // 0 or 1
+// A long keepalive lets the radio sleep between quotes; the broker drops
+// the session after 1.5x this without traffic
+#define MQTT_KEEPALIVE_SECONDS 120
+
+// Streaming (QUOTE_SOURCE_STREAM): quotes arrive from Yahoo's streamer as
+// trades happen instead of once a minute. The chart endpoint is still
+// fetched once at boot and whenever the stream is down. For offline tests
+// point it at the replay server (stream_replay/) with STREAM_TLS 0.
+#define STREAM_HOST "streamer.finance.yahoo.com"
+#define STREAM_PORT 443
+#define STREAM_PATH "/?version=2"
+#define STREAM_TLS 1
+
+// Over-the-air updates from ota/ota_server.py on the LAN (see README).
+// Updates come as compressed deltas against the running firmware where
+// possible. A new firmware that has not fetched a quote and run for
+// OTA_CONFIRM_SECONDS within OTA_TRIAL_BOOTS boots is rolled back; a boot
+// that has not managed it within OTA_TRIAL_MINUTES restarts and counts.
+#define OTA_ENABLED 0
+#define OTA_URL "http://192.168.1.10:8070/firmware.ota"
+#define OTA_CHECK_MINUTES 60
+#define OTA_TRIAL_BOOTS 3
+#define OTA_CONFIRM_SECONDS 120
+#define OTA_TRIAL_MINUTES 15
+
+// Main loop health - the worst blocking time and timer lateness are logged
+// every EVENT_LOOP_REPORT_SECONDS, with a warning above EVENT_LOOP_BLOCK_WARN_MS
+#define EVENT_LOOP_REPORT_SECONDS 60
+#define EVENT_LOOP_BLOCK_WARN_MS 20
+
+// Logging - lines below LOG_LEVEL are compiled out, the rest are queued and
+// written to Serial by a background task (see src/logging.h). With
+// LOG_SYSLOG_HOST set they are also sent there as UDP syslog.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL LOG_LEVEL_INFO
+#define LOG_BUFFER_LINES 32   // Lines waiting to be written before new ones are dropped
+#define LOG_LINE_MAX 128      // Longer lines are cut
+#define LOG_SYSLOG_HOST ""    // e.g. "192.168.1.10", "" = serial only
+#define LOG_SYSLOG_PORT 514
+
+// Crash and stall telemetry (see src/health.h). A main loop handler or a
+// fetch stuck for WATCHDOG_SECONDS resets the tracker with a core dump; the
+// next boot logs why, with the last heap and stack snapshot.
+#define WATCHDOG_ENABLED 1
+#define WATCHDOG_SECONDS 60          // Well above the slowest fetch (15 s timeout, TLS)
+#define HEALTH_SNAPSHOT_SECONDS 10   // Heap and stack figures kept in RTC memory
+#define HEALTH_STACK_WARN_BYTES 512  // Warn once when a task has less stack left
+
+// Power saving - between fetches the CPU is clocked down and the radio
+// dozes between access point beacons. Full speed returns for fetches,
+// touches and animation.
+#define POWER_SAVING 1
+#define POWER_ACTIVE_MHZ 240
+#define POWER_IDLE_MHZ 80                       // 80, 160 or 240 (lower stops WiFi)
+#define POWER_IDLE_MODEM_SLEEP WIFI_PS_MIN_MODEM // WIFI_PS_MAX_MODEM saves more, slower to answer
+#define POWER_BOOST_MS 500                      // Stay at full speed this long after a tap
+#define POWER_REPORT_SECONDS 300
+// Light sleep between timers while the screen is static (table layout).
+// Off by default: it needs CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE
+// in the sdkconfig (without them only modem sleep is used), and the backlight
+// PWM stops while asleep unless it is at full brightness.
+#define POWER_LIGHT_SLEEP 0
+#define POWER_LIGHT_SLEEP_MIN_MS 20   // Not worth sleeping for less
+#define POWER_LIGHT_SLEEP_MAX_MS 300  // Longest single nap before the timers are checked again
+
+// LAN fan-out - with several trackers on one network, one of them (the
+// leader, elected automatically) fetches every tracker's symbols and
+// multicasts the quotes; the others just display them. Enable on all of them.
+#define LAN_FANOUT 0
+#define LAN_GROUP 239, 255, 83, 84   // Multicast group
+#define LAN_PORT 5384
+#define LAN_HEARTBEAT_MS 5000
+#define LAN_LEADER_TIMEOUT_MS 15000  // Fetch directly again if the leader is silent this long
+#define LAN_FANOUT_MAX_EXTRA 24      // Leader: symbols fetched for others that are not on its own list
+
+// Prometheus metrics at http://<tracker>:METRICS_PORT/metrics
+#define METRICS_ENABLED 1
+#define METRICS_PORT 9100
+#define METRICS_BUFFER_SIZE 2048 // The page goes out through this buffer a piece at a time, bytes
+#define METRICS_SEND_CHUNK 1460                     // Bytes sent per main loop pass
+#define METRICS_CLIENT_TIMEOUT_MS 2000
 
 // Display Settings
-#define LCD_BRIGHTNESS 255
+#define LCD_BRIGHTNESS 255  // Maximum backlight level (0-255)
+
+// Automatic backlight - follows the room light measured by the LDR on the
+// back of the board and fades smoothly between levels
+#define BACKLIGHT_AUTO 1
+#define BACKLIGHT_MIN 16            // Level in a dark room
+#define BACKLIGHT_LDR_DARK 1500     // Raw LDR reading in a dark room
+#define BACKLIGHT_LDR_BRIGHT 0      // Raw LDR reading in bright daylight
+#define BACKLIGHT_CURVE 0.5f        // Below 1 brightens quickly in dim rooms, above 1 slowly
+#define BACKLIGHT_FILTER 0.1f       // Weight of each new LDR sample
+#define BACKLIGHT_SAMPLE_MS 250
+#define BACKLIGHT_HYSTERESIS 8      // Ignore smaller changes in the target level
+#define BACKLIGHT_RAMP_MS 1500      // Time for a fade across the full range
+// Dimmer overnight and outside market hours (255 = no cap). Hours and
+// minutes are local time (TIMEZONE_OFFSET); 9:30-16:00 ET is 6:30-13:00 PST.
+// The market hours also decide when an old quote counts as stale.
+#define BACKLIGHT_NIGHT_START_HOUR 22
+#define BACKLIGHT_NIGHT_END_HOUR 7
+#define BACKLIGHT_NIGHT_MAX 24
+#define BACKLIGHT_CLOSED_MAX 128
+#define MARKET_OPEN_MINUTES (6 * 60 + 30)
+#define MARKET_CLOSE_MINUTES (13 * 60)
+
+// SPI clock calibration - on first boot the display clock is stepped up and
+// checked by reading a test pattern back over MISO. The fastest stable clock
+// is saved to NVS and reused on every later boot.
+#define SPI_AUTO_CALIBRATE 1     // 0 = always use SPI_FREQUENCY from platformio.ini
+#define SPI_CALIBRATE_FORCE 0    // 1 = ignore the saved value and sweep again
 
 #endif 
\ No newline at end of file
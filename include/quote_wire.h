@@ -0,0 +1,200 @@
+#ifndef QUOTE_WIRE_H
+#define QUOTE_WIRE_H
+
+// Binary quote frame sent by the quote aggregator to the trackers, in answer
+// to /quotes.bin and on push subscriptions. Shared by the firmware and
+// aggregator/, so it is plain C++ with no Arduino or standard library
+// containers.
+//
+// A frame is a 16 byte header followed by count fixed-size records, all
+// little-endian:
+//
+//   header  0  u16 magic 'Q' 'W'      record  0  u32 symbol id
+//           2  u8  version                    4  i32 price
+//           3  u8  record size                8  i32 previous close
+//           4  u16 record count              12  u32 volume (saturated)
+//           6  u16 frame flags               16  u32 exchange time (unix)
+//           8  u32 sequence                  20  u8  flags
+//          12  u32 CRC-32                    21  u8  decimals
+//                                            22  u16 reserved
+//
+// Prices are integers scaled by 10^decimals, so a record needs no float
+// parsing. The CRC-32 covers the header (with the CRC field as zero) and all
+// records. The symbol id is an FNV-1a hash of the symbol, so the decoder
+// matches records to the symbols it asked for without any strings.
+//
+// Frames are self-delimiting, so on a push subscription they follow each
+// other on one TCP stream. The sequence then counts up by one per frame; a
+// gap means the server dropped a frame and the client asks for a snapshot.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QUOTE_WIRE_MAGIC 0x5751  // "QW"
+#define QUOTE_WIRE_VERSION 1
+#define QUOTE_WIRE_HEADER_SIZE 16
+#define QUOTE_WIRE_RECORD_SIZE 24
+#define QUOTE_WIRE_MAX_DECIMALS 4
+#define QUOTE_WIRE_FRAME_SIZE(count) (QUOTE_WIRE_HEADER_SIZE + (count) * QUOTE_WIRE_RECORD_SIZE)
+
+// Frame flags
+#define QUOTE_WIRE_SNAPSHOT 0x0001  // Every subscribed symbol, not just changes
+
+// Record flags
+#define QUOTE_WIRE_VALID 0x01  // The aggregator has a quote for the symbol
+
+struct QuoteWireRecord {
+  uint32_t symbol_id;
+  int32_t price;
+  int32_t prev_close;
+  uint32_t volume;
+  uint32_t market_time;
+  uint8_t flags;
+  uint8_t decimals;
+};
+
+enum QuoteWireError {
+  QUOTE_WIRE_OK,
+  QUOTE_WIRE_TRUNCATED,     // Shorter than the header or the records it announces
+  QUOTE_WIRE_BAD_MAGIC,
+  QUOTE_WIRE_BAD_VERSION,   // Newer format, or a different record size
+  QUOTE_WIRE_BAD_CHECKSUM
+};
+
+static inline uint16_t quote_wire_get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t quote_wire_get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void quote_wire_put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void quote_wire_put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// Same hash as the quote snapshot uses; symbols are upper case on both ends
+static inline uint32_t quote_wire_symbol_id(const char* symbol) {
+  uint32_t hash = 2166136261u;
+  for (const char* p = symbol; *p; p++) {
+    char c = *p;
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    hash ^= (uint8_t)c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// CRC-32 (IEEE), a nibble at a time: a 64 byte table instead of 1 KB, and
+// a frame is only a few hundred bytes
+static inline uint32_t quote_wire_crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+static inline uint32_t quote_wire_frame_crc(const uint8_t* frame, size_t len) {
+  static const uint8_t zero[4] = {0, 0, 0, 0};
+  uint32_t crc = quote_wire_crc32(frame, 12);
+  crc = quote_wire_crc32(zero, 4, crc);
+  return quote_wire_crc32(frame + QUOTE_WIRE_HEADER_SIZE, len - QUOTE_WIRE_HEADER_SIZE, crc);
+}
+
+// Validate a received frame. On success *count is the number of records.
+static inline QuoteWireError quote_wire_check(const uint8_t* frame, size_t len, uint16_t* count) {
+  if (len < QUOTE_WIRE_HEADER_SIZE) return QUOTE_WIRE_TRUNCATED;
+  if (quote_wire_get16(frame) != QUOTE_WIRE_MAGIC) return QUOTE_WIRE_BAD_MAGIC;
+  if (frame[2] != QUOTE_WIRE_VERSION || frame[3] != QUOTE_WIRE_RECORD_SIZE) return QUOTE_WIRE_BAD_VERSION;
+
+  uint16_t n = quote_wire_get16(frame + 4);
+  if (len < (size_t)QUOTE_WIRE_FRAME_SIZE(n)) return QUOTE_WIRE_TRUNCATED;
+  if (quote_wire_get32(frame + 12) != quote_wire_frame_crc(frame, QUOTE_WIRE_FRAME_SIZE(n))) {
+    return QUOTE_WIRE_BAD_CHECKSUM;
+  }
+  *count = n;
+  return QUOTE_WIRE_OK;
+}
+
+static inline uint16_t quote_wire_frame_flags(const uint8_t* frame) {
+  return quote_wire_get16(frame + 6);
+}
+
+static inline uint32_t quote_wire_sequence(const uint8_t* frame) {
+  return quote_wire_get32(frame + 8);
+}
+
+// Read record i of a checked frame
+static inline void quote_wire_get_record(const uint8_t* frame, int i, QuoteWireRecord* r) {
+  const uint8_t* p = frame + QUOTE_WIRE_HEADER_SIZE + i * QUOTE_WIRE_RECORD_SIZE;
+  r->symbol_id = quote_wire_get32(p);
+  r->price = (int32_t)quote_wire_get32(p + 4);
+  r->prev_close = (int32_t)quote_wire_get32(p + 8);
+  r->volume = quote_wire_get32(p + 12);
+  r->market_time = quote_wire_get32(p + 16);
+  r->flags = p[20];
+  r->decimals = p[21];
+}
+
+// Single precision, which the ESP32 does in hardware; quotes are floats there
+static inline float quote_wire_value(int32_t scaled, uint8_t decimals) {
+  static const float scale[QUOTE_WIRE_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000};
+  return (float)scaled / scale[decimals <= QUOTE_WIRE_MAX_DECIMALS ? decimals : QUOTE_WIRE_MAX_DECIMALS];
+}
+
+// Encoder side (the aggregator)
+
+// Scale both prices with the most decimals that still fit in 32 bits, so
+// cheap stocks keep their precision and BRK-A does not overflow
+static inline void quote_wire_scale(double price, double prev_close, QuoteWireRecord* r) {
+  double largest = price > prev_close ? price : prev_close;
+  int decimals = QUOTE_WIRE_MAX_DECIMALS;
+  double factor = 10000;
+  while (decimals > 0 && largest * factor >= 2147483647.0) {
+    decimals--;
+    factor /= 10;
+  }
+  r->decimals = (uint8_t)decimals;
+  r->price = (int32_t)(price * factor + (price >= 0 ? 0.5 : -0.5));
+  r->prev_close = (int32_t)(prev_close * factor + (prev_close >= 0 ? 0.5 : -0.5));
+}
+
+static inline void quote_wire_put_record(uint8_t* frame, int i, const QuoteWireRecord& r) {
+  uint8_t* p = frame + QUOTE_WIRE_HEADER_SIZE + i * QUOTE_WIRE_RECORD_SIZE;
+  quote_wire_put32(p, r.symbol_id);
+  quote_wire_put32(p + 4, (uint32_t)r.price);
+  quote_wire_put32(p + 8, (uint32_t)r.prev_close);
+  quote_wire_put32(p + 12, r.volume);
+  quote_wire_put32(p + 16, r.market_time);
+  p[20] = r.flags;
+  p[21] = r.decimals;
+  quote_wire_put16(p + 22, 0);
+}
+
+// Fill in the header once the records are in place
+static inline void quote_wire_finish(uint8_t* frame, uint16_t count, uint32_t sequence,
+                                     uint16_t frame_flags = 0) {
+  quote_wire_put16(frame, QUOTE_WIRE_MAGIC);
+  frame[2] = QUOTE_WIRE_VERSION;
+  frame[3] = QUOTE_WIRE_RECORD_SIZE;
+  quote_wire_put16(frame + 4, count);
+  quote_wire_put16(frame + 6, frame_flags);
+  quote_wire_put32(frame + 8, sequence);
+  quote_wire_put32(frame + 12, quote_wire_frame_crc(frame, QUOTE_WIRE_FRAME_SIZE(count)));
+}
+
+#endif
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Publish slowly moving demo quotes as retained QoS 1 messages, to test
+# QUOTE_SOURCE_MQTT against the local broker:
+#
+#   docker compose --profile mqtt up -d
+#   ./mqtt/publish_demo.sh [broker host] [symbols...]
+#
+# Uses mosquitto_pub if it is installed, otherwise the one in the container.
+
+HOST=${1:-localhost}
+[ $# -gt 0 ] && shift
+SYMBOLS=${*:-AAPL GOOGL NVDA TSLA META AMZN MSFT AMD}
+PREFIX=${PREFIX:-quotes/}
+INTERVAL=${INTERVAL:-2}
+
+if command -v mosquitto_pub >/dev/null 2>&1; then
+  PUB="mosquitto_pub -h $HOST"
+else
+  PUB="docker compose exec -T mosquitto mosquitto_pub -h localhost"
+fi
+
+while :; do
+  now=$(date +%s)
+  for s in $SYMBOLS; do
+    # Each symbol drifts around its own base price
+    payload=$(echo "$s" | awk -v t="$now" '{
+      seed = 0
+      for (i = 1; i <= length($0); i++) seed = seed * 31 + index("ABCDEFGHIJKLMNOPQRSTUVWXYZ.-^=0123456789", substr($0, i, 1))
+      base = 20 + seed % 480
+      price = base * (1 + 0.02 * sin(t / 45 + seed))
+      printf "%.2f,%.2f,%d", price, base, 1000000 + (t * 37 + seed) % 9000000
+    }')
+    $PUB -q 1 -r -t "$PREFIX$s" -m "$payload"
+  done
+  echo "$(date +%T) published $(echo $SYMBOLS | wc -w) quotes"
+  sleep "$INTERVAL"
+done
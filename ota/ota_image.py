@@ -0,0 +1,199 @@
+"""Build update files for the tracker's OTA updater (src/ota_update.cpp).
+
+An update file is a 96-byte header followed by a zlib stream:
+
+    0   u32  magic 0x544F5453 ("STOT")
+    4   u8   version (1)
+    5   u8   kind: 0 = full image, 1 = delta against a base image
+    6   u16  header size (96)
+    8   u32  image size, once inflated and patched
+    12  u32  payload size (the zlib stream after the header)
+    16  32B  SHA-256 of the new image
+    48  32B  delta: the base image's appended SHA-256 (its last 32 bytes),
+             which the running firmware reports as its own; zero for full
+    80  16B  reserved
+
+A full file inflates to the image. A delta inflates to the operations
+described in src/ota_patch.h.
+
+    python3 ota_image.py full new.bin out.ota
+    python3 ota_image.py delta old.bin new.bin out.ota
+    python3 ota_image.py apply old.bin in.ota out.bin   # check a file
+    python3 ota_image.py info in.ota
+"""
+
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = 0x544F5453
+VERSION = 1
+KIND_FULL = 0
+KIND_DELTA = 1
+HEADER = struct.Struct("<IBBHII32s32s16s")
+
+OP_LITERAL = 0x01
+OP_ADD = 0x02
+
+WINDOW = 8         # Bytes that must match exactly to start an ADD
+GIVE_UP = 64       # Stop extending once this many more mismatches than matches
+MIN_ADD = 16       # Shorter matches are sent as literals
+
+
+def image_digest(image):
+    """The digest the firmware reports for itself: ESP-IDF appends the
+    image's SHA-256 when byte 23 of the header is set."""
+    if len(image) < 64 or image[0] != 0xE9:
+        raise ValueError("not an ESP32 application image")
+    if image[23] != 1:
+        raise ValueError("image has no appended SHA-256")
+    return image[-32:]
+
+
+def extend(old, new, o, n):
+    """bsdiff's forward extension: the length maximising matches minus
+    mismatches, so a few changed bytes do not end the run."""
+    limit = min(len(old) - o, len(new) - n)
+    score = best_score = best_len = 0
+    for k in range(limit):
+        score += 1 if old[o + k] == new[n + k] else -1
+        if score > best_score:
+            best_score, best_len = score, k + 1
+        elif score < best_score - GIVE_UP:
+            break
+    return best_len
+
+
+def diff(old, new):
+    index = {}
+    for o in range(len(old) - WINDOW, -1, -1):
+        index[old[o:o + WINDOW]] = o  # Keeps the first occurrence
+
+    out = bytearray()
+
+    def literal(data):
+        if data:
+            out.extend(struct.pack("<BI", OP_LITERAL, len(data)))
+            out.extend(data)
+
+    i = lit_start = 0
+    shift = None  # Offset of the last match, base minus new
+    while i < len(new) - WINDOW:
+        o = None
+        length = 0
+        # Code after a change usually lines up with the base the same way
+        if shift is not None and 0 <= i + shift < len(old):
+            o = i + shift
+            length = extend(old, new, o, i)
+        if length < MIN_ADD:
+            o = index.get(bytes(new[i:i + WINDOW]))
+            length = extend(old, new, o, i) if o is not None else 0
+        if length < MIN_ADD:
+            i += 1
+            continue
+
+        literal(new[lit_start:i])
+        out.extend(struct.pack("<BII", OP_ADD, o, length))
+        out.extend(bytes((new[i + k] - old[o + k]) & 0xFF for k in range(length)))
+        shift = o - i
+        i += length
+        lit_start = i
+
+    literal(new[lit_start:])
+    return bytes(out)
+
+
+def patch(old, ops):
+    out = bytearray()
+    p = 0
+    while p < len(ops):
+        op = ops[p]
+        if op == OP_LITERAL:
+            (length,) = struct.unpack_from("<I", ops, p + 1)
+            p += 5
+            out.extend(ops[p:p + length])
+        elif op == OP_ADD:
+            base, length = struct.unpack_from("<II", ops, p + 1)
+            p += 9
+            out.extend((old[base + k] + ops[p + k]) & 0xFF for k in range(length))
+        else:
+            raise ValueError("bad operation 0x%02x at %d" % (op, p))
+        p += length
+    return bytes(out)
+
+
+def build(new, old=None):
+    """Update file for new; a delta if old is given."""
+    if old is None:
+        kind, base, body = KIND_FULL, bytes(32), new
+    else:
+        kind, base, body = KIND_DELTA, image_digest(old), diff(old, new)
+    payload = zlib.compress(body, 9)
+    header = HEADER.pack(MAGIC, VERSION, kind, HEADER.size, len(new), len(payload),
+                         hashlib.sha256(new).digest(), base, bytes(16))
+    return header + payload
+
+
+def parse(data):
+    fields = HEADER.unpack_from(data)
+    magic, version, kind, size, image_size, payload_size, sha, base, _ = fields
+    if magic != MAGIC or version != VERSION or size != HEADER.size:
+        raise ValueError("not an update file")
+    return kind, image_size, sha, base, data[size:size + payload_size]
+
+
+def apply(old, data):
+    kind, image_size, sha, base, payload = parse(data)
+    body = zlib.decompress(payload)
+    if kind == KIND_DELTA:
+        if image_digest(old) != base:
+            raise ValueError("delta is for a different base image")
+        body = patch(old, body)
+    if len(body) != image_size or hashlib.sha256(body).digest() != sha:
+        raise ValueError("image does not verify")
+    return body
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def write(path, data):
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def main():
+    args = sys.argv[1:]
+    if not args:
+        sys.exit(__doc__)
+    cmd = args[0]
+    start = time.time()
+    if cmd == "full" and len(args) == 3:
+        new = read(args[1])
+        data = build(new)
+    elif cmd == "delta" and len(args) == 4:
+        old, new = read(args[1]), read(args[2])
+        data = build(new, old)
+    elif cmd == "apply" and len(args) == 4:
+        write(args[3], apply(read(args[1]), read(args[2])))
+        print("%s verifies, wrote %s" % (args[2], args[3]))
+        return
+    elif cmd == "info" and len(args) == 2:
+        kind, image_size, sha, base, payload = parse(read(args[1]))
+        print("%s image of %d bytes in %d (sha256 %s%s)" % (
+            "delta" if kind == KIND_DELTA else "full", image_size, len(payload), sha.hex()[:16],
+            ", base " + base.hex()[:16] if kind == KIND_DELTA else ""))
+        return
+    else:
+        sys.exit(__doc__)
+    write(args[-1], data)
+    print("%s: %d bytes for a %d byte image (%.1f%%) in %.1f s" % (
+        args[-1], len(data), len(new), 100.0 * len(data) / len(new), time.time() - start))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+"""Update server for the tracker's OTA updater (OTA_ENABLED, OTA_URL).
+
+Drop each firmware build (the .pio/build/esp32dev/firmware.bin of a
+release) into builds/; the newest file is the one trackers update to.
+Keep the older builds there too: a tracker asks with the digest of the
+firmware it runs,
+
+    GET /firmware.ota?current=<hex sha-256>
+
+and gets 204 if that is the newest build, otherwise the smaller of a
+delta against its build (when the server still has that build) and the
+full image. Update files are made with ota_image.py and cached in
+builds/cache/.
+
+    python3 ota_server.py [port] [builds directory]
+"""
+
+import os
+import sys
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+import ota_image
+
+here = os.path.dirname(os.path.abspath(__file__))
+PORT = int(sys.argv[1]) if len(sys.argv) > 1 else 8070
+BUILDS = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "builds")
+CACHE = os.path.join(BUILDS, "cache")
+
+lock = threading.Lock()  # One diff at a time, they are slow
+
+
+def builds():
+    """Digest -> (path, mtime) of every usable build."""
+    found = {}
+    for name in os.listdir(BUILDS):
+        path = os.path.join(BUILDS, name)
+        if not name.endswith(".bin") or not os.path.isfile(path):
+            continue
+        try:
+            digest = ota_image.image_digest(ota_image.read(path)).hex()
+        except ValueError as e:
+            print("%s: skipped, %s" % (name, e))
+            continue
+        found[digest] = (path, os.path.getmtime(path))
+    return found
+
+
+def update_file(new_digest, new_path, base_path=None):
+    """Cached update file to new, a delta if base_path is given."""
+    os.makedirs(CACHE, exist_ok=True)
+    if base_path is None:
+        name = "%s.ota" % new_digest[:16]
+    else:
+        base_digest = ota_image.image_digest(ota_image.read(base_path)).hex()
+        name = "%s-%s.ota" % (base_digest[:16], new_digest[:16])
+    path = os.path.join(CACHE, name)
+    with lock:
+        if not os.path.exists(path):
+            new = ota_image.read(new_path)
+            old = ota_image.read(base_path) if base_path else None
+            ota_image.write(path, ota_image.build(new, old))
+    return ota_image.read(path)
+
+
+class Handler(BaseHTTPRequestHandler):
+    def do_GET(self):
+        url = urlparse(self.path)
+        if url.path != "/firmware.ota":
+            self.send_error(404)
+            return
+        current = parse_qs(url.query).get("current", [""])[0].lower()
+
+        known = builds()
+        if not known:
+            self.send_error(404, "no builds in " + BUILDS)
+            return
+        latest = max(known, key=lambda d: known[d][1])
+        if current == latest:
+            self.send_response(204)
+            self.end_headers()
+            return
+
+        data = update_file(latest, known[latest][0])
+        kind = "full"
+        if current in known:
+            delta = update_file(latest, known[latest][0], known[current][0])
+            if len(delta) < len(data):
+                data, kind = delta, "delta"
+        self.log_message("%s -> %s: %s, %d bytes", current[:16] or "unknown", latest[:16], kind, len(data))
+
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+if __name__ == "__main__":
+    os.makedirs(BUILDS, exist_ok=True)
+    print("serving %d builds from %s on port %d" % (len(builds()), BUILDS, PORT))
+    ThreadingHTTPServer(("", PORT), Handler).serve_forever()
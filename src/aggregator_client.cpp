@@ -0,0 +1,169 @@
+#include <HTTPClient.h>
+#include <time.h>
+#include "aggregator_client.h"
+#include "logging.h"
+#include "../config.h"
+#include "../include/quote_wire.h"
+
+#define AGGREGATOR_TIMEOUT_MS 5000
+#define AGGREGATOR_URL_MAX 512
+#define AGGREGATOR_LINE_MAX 96
+
+// One response line: symbol,price,prev_close,volume,age_seconds
+// The numbers are empty if the aggregator has no quote for the symbol yet.
+static bool parse_line(char* line, const char** symbol, YahooQuote* quote, bool* has_quote) {
+  char* fields[5];
+  int n = 0;
+  char* p = line;
+  fields[n++] = p;
+  while (*p && n < 5) {
+    if (*p == ',') {
+      *p = '\0';
+      fields[n++] = p + 1;
+    }
+    p++;
+  }
+  if (n < 5) return false;
+
+  *symbol = fields[0];
+  *has_quote = fields[1][0] != '\0';
+  if (*has_quote) {
+    quote->price = strtof(fields[1], nullptr);
+    quote->prev_close = strtof(fields[2], nullptr);
+    quote->volume = strtoul(fields[3], nullptr, 10);
+    // The text format only has the quote's age at the aggregator
+    time_t now = time(nullptr);
+    long age = strtol(fields[4], nullptr, 10);
+    quote->market_time = now > 1600000000 && age >= 0 ? (uint32_t)(now - age) : 0;
+    *has_quote = quote->price > 0 && quote->prev_close > 0;
+  }
+  return true;
+}
+
+// Text response, one line per symbol
+static int read_lines(WiFiClient* stream, const char* const* symbols, int count,
+                      YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  char line[AGGREGATOR_LINE_MAX];
+  int received = 0;
+
+  for (int n = 0; n < count; n++) {
+    size_t got = stream->readBytesUntil('\n', line, sizeof(line) - 1);
+    if (got == 0) break;
+    line[got] = '\0';
+
+    const char* symbol;
+    YahooQuote q;
+    bool has_quote;
+    if (!parse_line(line, &symbol, &q, &has_quote)) {
+      status->parse_error = true;
+      continue;
+    }
+
+    // Lines come back in request order; look the symbol up anyway
+    int index = n;
+    if (strcasecmp(symbols[index], symbol) != 0) {
+      index = -1;
+      for (int i = 0; i < count; i++) {
+        if (strcasecmp(symbols[i], symbol) == 0) index = i;
+      }
+    }
+    if (index >= 0 && has_quote) {
+      quotes[index] = q;
+      ok[index] = true;
+      received++;
+    }
+  }
+  return received;
+}
+
+#if AGGREGATOR_BINARY
+// Only the fetch task uses it
+static uint8_t frame[QUOTE_WIRE_FRAME_SIZE(AGGREGATOR_BATCH_MAX)];
+
+// Binary response (quote_wire.h): read the frame into the static buffer,
+// check it, and copy each record straight into the slot of the symbol it
+// belongs to. No text parsing and no allocation.
+static int read_frame(WiFiClient* stream, int size, const char* const* symbols, int count,
+                      YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  if (size < QUOTE_WIRE_HEADER_SIZE || size > (int)sizeof(frame)) {
+    LOGW("Aggregator frame has a bad size: %d", size);
+    status->parse_error = true;
+    return 0;
+  }
+  size_t got = stream->readBytes(frame, size);
+
+  uint16_t records;
+  QuoteWireError error = quote_wire_check(frame, got, &records);
+  if (error != QUOTE_WIRE_OK) {
+    LOGW("Aggregator frame rejected (error %d, %u bytes)", (int)error, (unsigned)got);
+    status->parse_error = true;
+    return 0;
+  }
+
+  uint32_t ids[AGGREGATOR_BATCH_MAX];
+  for (int i = 0; i < count; i++) ids[i] = quote_wire_symbol_id(symbols[i]);
+
+  int received = 0;
+  for (int r = 0; r < records; r++) {
+    QuoteWireRecord rec;
+    quote_wire_get_record(frame, r, &rec);
+    if (!(rec.flags & QUOTE_WIRE_VALID)) continue;
+
+    // Records come back in request order; match the id anyway
+    int index = (r < count && ids[r] == rec.symbol_id) ? r : -1;
+    for (int i = 0; index < 0 && i < count; i++) {
+      if (ids[i] == rec.symbol_id) index = i;
+    }
+    if (index < 0 || ok[index]) continue;
+
+    quotes[index].price = quote_wire_value(rec.price, rec.decimals);
+    quotes[index].prev_close = quote_wire_value(rec.prev_close, rec.decimals);
+    quotes[index].volume = rec.volume;
+    quotes[index].market_time = rec.market_time;
+    ok[index] = quotes[index].price > 0 && quotes[index].prev_close > 0;
+    if (ok[index]) received++;
+  }
+  return received;
+}
+#endif
+
+int aggregator_fetch_quotes(const char* const* symbols, int count,
+                            YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  char url[AGGREGATOR_URL_MAX];
+  int len = snprintf(url, sizeof(url), "http://%s:%d/%s?symbols=", AGGREGATOR_HOST, AGGREGATOR_PORT,
+                     AGGREGATOR_BINARY ? "quotes.bin" : "quotes");
+  for (int i = 0; i < count && len < (int)sizeof(url); i++) {
+    len += snprintf(url + len, sizeof(url) - len, "%s%s", i ? "," : "", symbols[i]);
+    ok[i] = false;
+  }
+  LOGI("Fetching %d quotes from the aggregator", count);
+
+  uint32_t start = micros();
+  HTTPClient http;
+  http.begin(url);
+  http.setTimeout(AGGREGATOR_TIMEOUT_MS);
+
+  int received = 0;
+  int httpCode = http.GET();
+  status->http_code = httpCode;
+  status->parse_error = false;
+
+  if (httpCode == HTTP_CODE_OK) {
+    // Read straight off the socket, the body is small
+    WiFiClient* stream = http.getStreamPtr();
+    stream->setTimeout(AGGREGATOR_TIMEOUT_MS);
+#if AGGREGATOR_BINARY
+    received = read_frame(stream, http.getSize(), symbols, count, quotes, ok, status);
+#else
+    received = read_lines(stream, symbols, count, quotes, ok, status);
+#endif
+  } else {
+    LOGW("Aggregator request failed: %d", httpCode);
+  }
+
+  http.end();
+  status->latency_us = micros() - start;
+  LOGI("Aggregator: %d of %d quotes in %u ms", received, count,
+       (unsigned)(status->latency_us / 1000));
+  return received;
+}
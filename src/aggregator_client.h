@@ -0,0 +1,19 @@
+#ifndef AGGREGATOR_CLIENT_H
+#define AGGREGATOR_CLIENT_H
+
+#include "yahoo_api.h"
+
+// Client for the quote aggregator service (aggregator/ in this repo). A
+// whole batch of symbols is fetched in one plain HTTP request on the LAN, so
+// there is no TLS handshake and no per-symbol request to Yahoo.
+
+#define AGGREGATOR_BATCH_MAX 16
+
+// Fetch quotes for count symbols (at most AGGREGATOR_BATCH_MAX). ok[i] says
+// whether quotes[i] was filled in; the aggregator leaves symbols it has no
+// quote for yet blank. status describes the one request. Returns the number
+// of quotes received. Blocks, so it is only called from the fetch task.
+int aggregator_fetch_quotes(const char* const* symbols, int count,
+                            YahooQuote* quotes, bool* ok, FetchStatus* status);
+
+#endif
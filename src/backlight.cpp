@@ -0,0 +1,129 @@
+#include <math.h>
+#include <time.h>
+#include "backlight.h"
+#include "quote_store.h"
+#include "../config.h"
+
+// CYD wiring
+#define LCD_BACKLIGHT_PIN 21
+#define LDR_PIN 34
+
+// 12 bit duty leaves enough steps for a smooth fade at the dark end. 5 kHz
+// is far above visible flicker and easy on the backlight transistor.
+#define BACKLIGHT_PWM_CHANNEL 0
+#define BACKLIGHT_PWM_FREQUENCY 5000
+#define BACKLIGHT_PWM_BITS 12
+#define BACKLIGHT_DUTY_MAX ((1 << BACKLIGHT_PWM_BITS) - 1)
+
+// Perceived brightness to duty, roughly how the eye sees LED output
+#define BACKLIGHT_GAMMA 2.2f
+
+// The level is kept in 1/16 steps so slow ramps still move every tick
+#define LEVEL_SCALE 16
+
+static float ambient = -1;        // Filtered LDR reading as 0..1, -1 = none yet
+static uint8_t target = LCD_BRIGHTNESS;
+static int level_x16 = LCD_BRIGHTNESS * LEVEL_SCALE;
+static uint32_t duty = BACKLIGHT_DUTY_MAX;
+
+static void write_level() {
+  float perceived = (float)level_x16 / (255 * LEVEL_SCALE);
+  duty = (uint32_t)lroundf(powf(perceived, BACKLIGHT_GAMMA) * BACKLIGHT_DUTY_MAX);
+  ledcWrite(BACKLIGHT_PWM_CHANNEL, duty);
+}
+
+static int read_ldr() {
+  // Median of three drops the odd spike from WiFi transmit bursts
+  int a = analogRead(LDR_PIN);
+  int b = analogRead(LDR_PIN);
+  int c = analogRead(LDR_PIN);
+  if (a > b) { int t = a; a = b; b = t; }
+  if (b > c) { b = c; }
+  return a > b ? a : b;
+}
+
+// Raw reading to 0 (dark) .. 1 (bright). The calibration points may be in
+// either order, depending on how the LDR divider is wired.
+static float to_ambient(int raw) {
+  float a = (float)(raw - BACKLIGHT_LDR_DARK) / (BACKLIGHT_LDR_BRIGHT - BACKLIGHT_LDR_DARK);
+  if (a < 0) a = 0;
+  if (a > 1) a = 1;
+  return a;
+}
+
+// Overnight and closed-market caps from the local clock. No cap until NTP
+// has set the time.
+static int schedule_cap() {
+  struct tm now;
+  if (!getLocalTime(&now, 0)) return 255;
+
+  int cap = 255;
+  bool night = (BACKLIGHT_NIGHT_START_HOUR > BACKLIGHT_NIGHT_END_HOUR)
+                 ? (now.tm_hour >= BACKLIGHT_NIGHT_START_HOUR || now.tm_hour < BACKLIGHT_NIGHT_END_HOUR)
+                 : (now.tm_hour >= BACKLIGHT_NIGHT_START_HOUR && now.tm_hour < BACKLIGHT_NIGHT_END_HOUR);
+  if (night && BACKLIGHT_NIGHT_MAX < cap) cap = BACKLIGHT_NIGHT_MAX;
+
+  if (!quote_store_market_open() && BACKLIGHT_CLOSED_MAX < cap) cap = BACKLIGHT_CLOSED_MAX;
+  return cap;
+}
+
+void backlight_begin() {
+  ledcSetup(BACKLIGHT_PWM_CHANNEL, BACKLIGHT_PWM_FREQUENCY, BACKLIGHT_PWM_BITS);
+  ledcAttachPin(LCD_BACKLIGHT_PIN, BACKLIGHT_PWM_CHANNEL);
+  write_level();
+
+#if BACKLIGHT_AUTO
+  pinMode(LDR_PIN, INPUT);
+  analogSetPinAttenuation(LDR_PIN, ADC_0db); // The divider only swings a few hundred mV
+#endif
+}
+
+bool backlight_sample() {
+#if BACKLIGHT_AUTO
+  float a = to_ambient(read_ldr());
+  ambient = (ambient < 0) ? a : ambient + BACKLIGHT_FILTER * (a - ambient);
+
+  // Map through the curve between the dark floor and LCD_BRIGHTNESS
+  float wanted = BACKLIGHT_MIN + (LCD_BRIGHTNESS - BACKLIGHT_MIN) * powf(ambient, BACKLIGHT_CURVE);
+#else
+  float wanted = LCD_BRIGHTNESS;
+#endif
+
+  int cap = schedule_cap();
+  if (wanted > cap) wanted = cap;
+  int next = (int)lroundf(wanted);
+
+  // Hysteresis so a flickering light source does not keep the level hunting
+  if (abs(next - target) < BACKLIGHT_HYSTERESIS && next != cap && next != BACKLIGHT_MIN) return false;
+  if (next == target) return false;
+
+  target = next;
+  return level_x16 != target * LEVEL_SCALE;
+}
+
+bool backlight_ramp_step() {
+  int goal = target * LEVEL_SCALE;
+  int step = 255 * LEVEL_SCALE * BACKLIGHT_RAMP_STEP_MS / BACKLIGHT_RAMP_MS;
+  if (step < 1) step = 1;
+
+  if (level_x16 < goal) {
+    level_x16 = (goal - level_x16 > step) ? level_x16 + step : goal;
+  } else if (level_x16 > goal) {
+    level_x16 = (level_x16 - goal > step) ? level_x16 - step : goal;
+  }
+  write_level();
+  return level_x16 != goal;
+}
+
+uint8_t backlight_level() {
+  return (uint8_t)(level_x16 / LEVEL_SCALE);
+}
+
+float backlight_ambient_percent() {
+  return ambient < 0 ? 0 : ambient * 100.0f;
+}
+
+bool backlight_sleep_safe() {
+  bool ramping = level_x16 != target * LEVEL_SCALE;
+  return !ramping && (duty == 0 || duty == BACKLIGHT_DUTY_MAX);
+}
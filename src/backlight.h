@@ -0,0 +1,37 @@
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <Arduino.h>
+
+// Backlight controller. The LED is driven by LEDC PWM well above the
+// flicker threshold, with a gamma-corrected duty so ramps look even. The
+// target follows the room light measured by the LDR on the back of the
+// board, and is capped overnight and while the market is closed.
+//
+// backlight_sample() reads the LDR and picks a new target; while the level
+// moves towards it, backlight_ramp_step() is called every
+// BACKLIGHT_RAMP_STEP_MS.
+
+#define BACKLIGHT_RAMP_STEP_MS 20
+
+// Take over the backlight pin, starting at full brightness
+void backlight_begin();
+
+// Filter one LDR reading and update the target. Returns true if a ramp
+// needs to start.
+bool backlight_sample();
+
+// Move one step towards the target. Returns false once it is reached.
+bool backlight_ramp_step();
+
+// Current level, 0-255 on a perceived scale
+uint8_t backlight_level();
+
+// Ambient light from the LDR, 0-100 %
+float backlight_ambient_percent();
+
+// The PWM stops in light sleep, which would leave the LED stuck fully on or
+// off. Only safe when the output is steady at one of those already.
+bool backlight_sleep_safe();
+
+#endif
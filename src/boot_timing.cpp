@@ -0,0 +1,32 @@
+#include "boot_timing.h"
+#include "logging.h"
+
+#define BOOT_MAX_MARKS 8
+
+struct BootMark {
+  const char* milestone;
+  unsigned long ms;
+};
+
+static BootMark marks[BOOT_MAX_MARKS];
+static int num_marks = 0;
+static bool reported = false;
+
+void boot_mark(const char* milestone) {
+  if (reported || num_marks >= BOOT_MAX_MARKS) return;
+  marks[num_marks].milestone = milestone;
+  marks[num_marks].ms = millis();
+  num_marks++;
+}
+
+void boot_report() {
+  if (reported) return;
+  reported = true;
+
+  LOGI("=== Boot timing ===");
+  unsigned long prev = 0;
+  for (int i = 0; i < num_marks; i++) {
+    LOGI("%6lu ms (+%5lu) %s", marks[i].ms, marks[i].ms - prev, marks[i].milestone);
+    prev = marks[i].ms;
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <Arduino.h>
+
+// Milestones from power-on to the first quote on screen, logged once so
+// changes to the boot path can be measured. Times are millis(), which starts
+// when the app starts (the ROM and second stage bootloader are not counted).
+
+void boot_mark(const char* milestone);
+
+// Log every milestone with the time since the previous one. Only the first
+// call prints anything.
+void boot_report();
+
+#endif
@@ -0,0 +1,352 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "chart_stream.h"
+
+enum TokenState {
+  ST_SCAN,    // Between tokens
+  ST_STRING,  // Inside a string
+  ST_NUMBER,  // Inside a number
+  ST_LITERAL  // Inside true/false/null
+};
+
+enum ChartKey {
+  KEY_NONE = 0,
+  KEY_TIMESTAMP,
+  KEY_CLOSE,
+  KEY_DAY_HIGH,
+  KEY_DAY_LOW,
+  KEY_VOLUME,
+  KEY_PREVIOUS_CLOSE,
+  KEY_CHART_PREVIOUS_CLOSE,
+  KEY_OTHER
+};
+
+static const struct {
+  const char* name;
+  ChartKey key;
+} KEYS[] = {
+  {"timestamp", KEY_TIMESTAMP},
+  {"close", KEY_CLOSE},
+  {"regularMarketDayHigh", KEY_DAY_HIGH},
+  {"regularMarketDayLow", KEY_DAY_LOW},
+  {"regularMarketVolume", KEY_VOLUME},
+  {"previousClose", KEY_PREVIOUS_CLOSE},
+  {"chartPreviousClose", KEY_CHART_PREVIOUS_CLOSE},
+};
+
+static ChartKey lookup_key(const char* name) {
+  for (size_t i = 0; i < sizeof(KEYS) / sizeof(KEYS[0]); i++) {
+    if (strcmp(KEYS[i].name, name) == 0) return KEYS[i].key;
+  }
+  return KEY_OTHER;
+}
+
+// ---- LTTB ------------------------------------------------------------------
+
+static void emit(ChartStream* cs, const ChartPoint& p) {
+  if (cs->out_count < cs->out_capacity) {
+    cs->out[cs->out_count++] = p;
+  }
+}
+
+static void clear_bucket(ChartBucket* b) {
+  b->count = 0;
+  b->seen = 0;
+  b->sum_x = 0;
+  b->sum_y = 0;
+}
+
+static int bucket_stride(const ChartStream* cs) {
+  return 1 + (int)(cs->every / CHART_BUCKET_CAPACITY);
+}
+
+static void bucket_add(ChartStream* cs, ChartBucket* b, const ChartPoint& p) {
+  b->sum_x += p.index;
+  b->sum_y += p.value;
+
+  // Oversized buckets keep every n-th point as a candidate
+  if (b->seen % bucket_stride(cs) == 0 && b->count < CHART_BUCKET_CAPACITY) {
+    b->points[b->count++] = p;
+  }
+  b->seen++;
+}
+
+// Pick the candidate forming the largest triangle with the previous
+// selection (anchor) and the next bucket's average (cx, cy)
+static void select_from(ChartStream* cs, const ChartBucket* b, double cx, double cy) {
+  if (b->count == 0) return;
+
+  const ChartPoint& a = cs->anchor;
+  int best = 0;
+  double best_area = -1;
+  for (int i = 0; i < b->count; i++) {
+    const ChartPoint& p = b->points[i];
+    double area = fabs((a.index - cx) * (p.value - a.value) -
+                       (a.index - p.index) * (cy - a.value));
+    if (area > best_area) {
+      best_area = area;
+      best = i;
+    }
+  }
+
+  cs->anchor = b->points[best];
+  emit(cs, cs->anchor);
+}
+
+// Series positions 1 .. n-2 share buckets 0 .. w-3, bucket i covering
+// [floor(i * every) + 1, floor((i + 1) * every) + 1). The final position (and
+// anything past the expected length) gets bucket w-2 to itself.
+static int bucket_of(const ChartStream* cs, int index) {
+  int final_bucket = cs->out_capacity - 2;
+  if (index >= cs->expected_length - 1) return final_bucket;
+
+  int bucket = (int)ceil(index / cs->every) - 1;
+  if (bucket < 0) bucket = 0;
+  while (bucket < final_bucket - 1 && (int)floor((bucket + 1) * cs->every) + 1 <= index) bucket++;
+  while (bucket > 0 && (int)floor(bucket * cs->every) + 1 > index) bucket--;
+  return bucket;
+}
+
+static void lttb_begin(ChartStream* cs) {
+  int n = cs->series_length > 2 ? cs->series_length : CHART_DEFAULT_SERIES_LENGTH;
+  int w = cs->out_capacity;
+  cs->expected_length = n;
+
+  // First and last points are kept as-is, the rest share w - 2 buckets
+  cs->every = (w > 2) ? (double)(n - 2) / (w - 2) : n;
+  if (cs->every < 1) cs->every = 1;
+
+  cs->have_anchor = false;
+  cs->current_bucket = -1;
+  cs->next_bucket = -1;
+  cs->current = 0;
+  clear_bucket(&cs->buckets[0]);
+  clear_bucket(&cs->buckets[1]);
+}
+
+static void lttb_add(ChartStream* cs, uint16_t index, float value) {
+  ChartPoint p = {index, value};
+
+  if (!cs->have_anchor) {
+    cs->anchor = p;
+    cs->last_point = p;
+    cs->have_anchor = true;
+    emit(cs, p);
+    return;
+  }
+  cs->last_point = p;
+
+  int bucket = bucket_of(cs, index);
+
+  ChartBucket* cur = &cs->buckets[cs->current];
+  ChartBucket* next = &cs->buckets[1 - cs->current];
+
+  if (cs->current_bucket < 0) {
+    cs->current_bucket = bucket;
+  }
+  if (bucket == cs->current_bucket) {
+    bucket_add(cs, cur, p);
+    return;
+  }
+
+  // The next buffer holds whichever bucket follows the current one. Once a
+  // point lands beyond it, that bucket is complete and the current bucket
+  // can be decided.
+  if (cs->next_bucket < 0) {
+    cs->next_bucket = bucket;
+  }
+  if (bucket == cs->next_bucket) {
+    bucket_add(cs, next, p);
+    return;
+  }
+
+  select_from(cs, cur, next->sum_x / next->seen, next->sum_y / next->seen);
+
+  // The old current buffer now collects the new next bucket
+  clear_bucket(cur);
+  bucket_add(cs, cur, p);
+  cs->current = 1 - cs->current;
+  cs->current_bucket = cs->next_bucket;
+  cs->next_bucket = bucket;
+}
+
+// ---- Tokenizer -------------------------------------------------------------
+
+static void on_array_start(ChartStream* cs, int key) {
+  cs->array_key = key;
+  if (key == KEY_CLOSE) {
+    cs->close_index = 0;
+    lttb_begin(cs);
+  } else if (key == KEY_TIMESTAMP) {
+    cs->series_length = 0;
+  }
+}
+
+static void on_element(ChartStream* cs, bool is_null, double value) {
+  if (cs->array_key == KEY_TIMESTAMP) {
+    if (!is_null) {
+      if (cs->series_length == 0) cs->first_timestamp = (uint32_t)value;
+      cs->last_timestamp = (uint32_t)value;
+    }
+    cs->series_length++;
+  } else if (cs->array_key == KEY_CLOSE) {
+    int index = cs->close_index++;
+    if (!is_null && index <= UINT16_MAX) {
+      lttb_add(cs, (uint16_t)index, (float)value);
+    }
+  }
+}
+
+static void on_scalar(ChartStream* cs, double value) {
+  switch (cs->pending_key) {
+    case KEY_DAY_HIGH: cs->day_high = (float)value; break;
+    case KEY_DAY_LOW: cs->day_low = (float)value; break;
+    case KEY_VOLUME: cs->volume = (uint32_t)value; break;
+    case KEY_PREVIOUS_CLOSE: cs->previous_close = (float)value; break;
+    case KEY_CHART_PREVIOUS_CLOSE:
+      // Only used when the response has no previousClose
+      if (cs->previous_close <= 0) cs->previous_close = (float)value;
+      break;
+    default: break;
+  }
+}
+
+static void end_value(ChartStream* cs, bool is_null, double value) {
+  if (cs->array_key != KEY_NONE) {
+    on_element(cs, is_null, value);
+  } else if (!is_null) {
+    on_scalar(cs, value);
+  }
+  cs->pending_key = KEY_NONE;
+}
+
+static void finish_token(ChartStream* cs) {
+  cs->token[cs->token_len] = '\0';
+
+  if (cs->state == ST_NUMBER) {
+    end_value(cs, false, strtod(cs->token, nullptr));
+  } else if (cs->state == ST_LITERAL) {
+    // true/false never appear in the arrays we read, treat them like null
+    end_value(cs, true, 0);
+  }
+  cs->state = ST_SCAN;
+  cs->token_len = 0;
+}
+
+static void append_token(ChartStream* cs, char c) {
+  if (cs->token_len < (int)sizeof(cs->token) - 1) {
+    cs->token[cs->token_len++] = c;
+  }
+}
+
+void chart_stream_begin(ChartStream* cs, ChartPoint* out, int out_capacity) {
+  memset(cs, 0, sizeof(*cs));
+  cs->out = out;
+  cs->out_capacity = out_capacity;
+  cs->state = ST_SCAN;
+}
+
+void chart_stream_feed(ChartStream* cs, const char* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+
+    switch (cs->state) {
+      case ST_STRING:
+        if (cs->escape) {
+          cs->escape = false;
+          append_token(cs, c);
+        } else if (c == '\\') {
+          cs->escape = true;
+        } else if (c == '"') {
+          cs->token[cs->token_len] = '\0';
+          cs->state = ST_SCAN;
+          cs->token_len = 0;
+          cs->key_ready = true;
+        } else {
+          append_token(cs, c);
+        }
+        continue;
+
+      case ST_NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E') {
+          append_token(cs, c);
+          continue;
+        }
+        finish_token(cs);
+        break; // Reprocess the terminator below
+
+      case ST_LITERAL:
+        if (c >= 'a' && c <= 'z') {
+          append_token(cs, c);
+          continue;
+        }
+        finish_token(cs);
+        break;
+
+      case ST_SCAN:
+        break;
+    }
+
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t') continue;
+
+    bool key_ready = cs->key_ready;
+    cs->key_ready = false;
+
+    if (c == ':' && key_ready) {
+      cs->pending_key = lookup_key(cs->token);
+    } else if (c == '"') {
+      // A string where a value is expected is a value we ignore
+      if (cs->pending_key != KEY_NONE) cs->pending_key = KEY_NONE;
+      cs->state = ST_STRING;
+      cs->escape = false;
+    } else if (c == '[') {
+      if (cs->array_key == KEY_NONE &&
+          (cs->pending_key == KEY_TIMESTAMP || cs->pending_key == KEY_CLOSE)) {
+        on_array_start(cs, cs->pending_key);
+      }
+      cs->pending_key = KEY_NONE;
+    } else if (c == ']') {
+      cs->array_key = KEY_NONE;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+      cs->state = ST_NUMBER;
+      append_token(cs, c);
+    } else if (c >= 'a' && c <= 'z') {
+      cs->state = ST_LITERAL;
+      append_token(cs, c);
+    } else if (c == '{') {
+      cs->pending_key = KEY_NONE;
+    }
+  }
+}
+
+int chart_stream_finish(ChartStream* cs) {
+  if (cs->state == ST_NUMBER || cs->state == ST_LITERAL) {
+    finish_token(cs);
+  }
+  if (!cs->have_anchor) return cs->out_count;
+
+  ChartBucket* cur = &cs->buckets[cs->current];
+  ChartBucket* next = &cs->buckets[1 - cs->current];
+
+  // The final point is emitted on its own, so take it out of the candidates
+  ChartBucket* latest = next->seen > 0 ? next : cur;
+  if (latest->count > 0 && latest->points[latest->count - 1].index == cs->last_point.index) {
+    latest->count--;
+  }
+
+  if (next->seen > 0) {
+    select_from(cs, cur, next->sum_x / next->seen, next->sum_y / next->seen);
+    if (cs->next_bucket != cs->out_capacity - 2) {
+      // The series ended early (trailing nulls), the last bucket is partial
+      select_from(cs, next, cs->last_point.index, cs->last_point.value);
+    }
+  } else if (cs->current_bucket != cs->out_capacity - 2) {
+    select_from(cs, cur, cs->last_point.index, cs->last_point.value);
+  }
+
+  if (cs->last_point.index != cs->anchor.index) {
+    emit(cs, cs->last_point);
+  }
+  return cs->out_count;
+}
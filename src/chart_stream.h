@@ -0,0 +1,83 @@
+#ifndef CHART_STREAM_H
+#define CHART_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming reader for Yahoo chart responses (interval=1m/5m). The JSON is
+// fed in chunks as it arrives; numeric arrays are never stored. Each close
+// price goes straight into a Largest-Triangle-Three-Buckets downsampler that
+// only buffers the two buckets it is working on, so the full ~390 point
+// series is reduced to the plot width with a few hundred bytes of state.
+//
+// Plain C++ with no Arduino dependencies.
+
+// Candidate points kept per bucket. A 1 day / 1 minute series over 220 px is
+// ~2 points per bucket; larger buckets are thinned evenly to fit.
+#define CHART_BUCKET_CAPACITY 32
+
+// Used to size the buckets if the close array arrives before the timestamps
+#define CHART_DEFAULT_SERIES_LENGTH 390
+
+struct ChartPoint {
+  uint16_t index; // Position in the original series (the x axis)
+  float value;
+};
+
+struct ChartBucket {
+  ChartPoint points[CHART_BUCKET_CAPACITY];
+  int count;     // Candidates stored
+  int seen;      // Points that fell in the bucket (for thinning)
+  double sum_x;  // Running average over every point, not just candidates
+  double sum_y;
+};
+
+struct ChartStream {
+  // Output
+  ChartPoint* out;
+  int out_capacity;
+  int out_count;
+
+  // Scalars picked up from "meta" on the way past
+  float day_high;
+  float day_low;
+  float previous_close;
+  uint32_t volume;
+
+  // Series shape from the timestamp array
+  int series_length;
+  uint32_t first_timestamp;
+  uint32_t last_timestamp;
+
+  // Tokenizer
+  int state;
+  int array_key;   // Which array we are inside, 0 = none
+  int pending_key; // Key whose value comes next, 0 = none
+  char token[32];
+  int token_len;
+  bool escape;
+  bool key_ready;  // A string just closed; it is a key if ':' follows
+  int close_index; // Position in the close array, nulls included
+
+  // LTTB
+  bool have_anchor;
+  ChartPoint anchor;     // Last selected point ("a")
+  ChartPoint last_point; // Most recent non-null point, always emitted last
+  int expected_length;   // Series length the buckets were sized for
+  double every;          // Bucket width in series positions
+  int current_bucket;    // Bucket number held in buckets[current]
+  int next_bucket;       // Bucket number held in the other buffer, -1 = empty
+  int current;           // Which of the two buffers is the current bucket
+  ChartBucket buckets[2];
+};
+
+void chart_stream_begin(ChartStream* cs, ChartPoint* out, int out_capacity);
+
+// Feed the next chunk of the response body
+void chart_stream_feed(ChartStream* cs, const char* data, size_t len);
+
+// Flush the buffered buckets and the final point. Returns the number of
+// points written to out.
+int chart_stream_finish(ChartStream* cs);
+
+#endif
@@ -0,0 +1,137 @@
+#include <WiFi.h>
+#include "connectivity.h"
+#include "logging.h"
+#include "../config.h"
+
+// Every few failed attempts, drop the cached access point and do a full
+// scan in case the network moved to another access point or channel
+#define CONN_FULL_SCAN_EVERY 4
+
+static ConnState state = CONN_STARTING;
+static volatile bool link_up = false;   // Written from the WiFi event task
+static volatile bool link_lost = false;
+
+static unsigned long offline_since = 0;
+static unsigned long next_attempt = 0;
+static unsigned long attempt_start = 0;
+static unsigned long backoff_ms = WIFI_RETRY_MIN_MS;
+static int attempts = 0;
+
+static void on_wifi_event(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      link_up = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      link_up = false;
+      link_lost = true;
+      break;
+    default:
+      break;
+  }
+}
+
+// Random spread of +-25% around the backoff
+static unsigned long with_jitter(unsigned long ms) {
+  long spread = ms / 4;
+  return ms + random(-spread, spread + 1);
+}
+
+static void schedule_retry() {
+  state = CONN_OFFLINE;
+  next_attempt = millis() + with_jitter(backoff_ms);
+  backoff_ms = min(backoff_ms * 2, (unsigned long)WIFI_RETRY_MAX_MS);
+}
+
+static void start_attempt() {
+  attempts++;
+  attempt_start = millis();
+  state = CONN_CONNECTING;
+
+  if (attempts % CONN_FULL_SCAN_EVERY == 0) {
+    LOGI("WiFi reconnect attempt %d (full scan)", attempts);
+    String ssid = WiFi.SSID();
+    String psk = WiFi.psk();
+    WiFi.disconnect();
+    WiFi.begin(ssid.c_str(), psk.c_str());
+  } else {
+    LOGI("WiFi reconnect attempt %d", attempts);
+    WiFi.reconnect();
+  }
+}
+
+void connectivity_begin() {
+  // The supervisor decides when to retry, not the driver
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(on_wifi_event, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(on_wifi_event, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  WiFi.onEvent(on_wifi_event, ARDUINO_EVENT_WIFI_STA_LOST_IP);
+
+  link_up = (WiFi.status() == WL_CONNECTED);
+  link_lost = false;
+  if (link_up) {
+    state = CONN_ONLINE;
+  } else {
+    offline_since = millis();
+    schedule_retry();
+  }
+}
+
+ConnEvent connectivity_tick() {
+  switch (state) {
+    case CONN_STARTING:
+      return CONN_EVENT_NONE;
+
+    case CONN_ONLINE:
+      if (link_lost || WiFi.status() != WL_CONNECTED) {
+        link_lost = false;
+        offline_since = millis();
+        backoff_ms = WIFI_RETRY_MIN_MS;
+        attempts = 0;
+        LOGW("WiFi connection lost");
+        schedule_retry();
+        return CONN_EVENT_LOST;
+      }
+      return CONN_EVENT_NONE;
+
+    case CONN_OFFLINE:
+      if (link_up) break; // Came back by itself
+      if ((long)(millis() - next_attempt) >= 0) {
+        start_attempt();
+      }
+      return CONN_EVENT_NONE;
+
+    case CONN_CONNECTING:
+      if (link_up) break;
+      if (millis() - attempt_start > WIFI_ATTEMPT_TIMEOUT_MS) {
+        LOGW("WiFi reconnect attempt %d failed, next in ~%lu s",
+             attempts, backoff_ms / 1000);
+        WiFi.disconnect();
+        link_lost = false;
+        schedule_retry();
+      }
+      return CONN_EVENT_NONE;
+  }
+
+  // Reconnected
+  state = CONN_ONLINE;
+  link_lost = false;
+  LOGI("WiFi reconnected after %lu s offline (%d attempts)",
+       (millis() - offline_since) / 1000, attempts);
+  backoff_ms = WIFI_RETRY_MIN_MS;
+  attempts = 0;
+  return CONN_EVENT_RESTORED;
+}
+
+ConnState connectivity_state() {
+  return state;
+}
+
+bool connectivity_online() {
+  return state == CONN_ONLINE;
+}
+
+unsigned long connectivity_offline_since() {
+  return offline_since;
+}
@@ -0,0 +1,37 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <Arduino.h>
+
+// WiFi connection supervisor. Disconnects are picked up from the WiFi event
+// callback and reconnect attempts are spaced out with exponential backoff
+// (plus jitter, so a room full of trackers does not retry in step). Nothing
+// here waits: connectivity_tick() only checks timers and flags.
+
+enum ConnState {
+  CONN_STARTING,   // connectivity_begin() not called yet
+  CONN_ONLINE,
+  CONN_OFFLINE,    // Waiting for the next attempt
+  CONN_CONNECTING  // Attempt in progress
+};
+
+enum ConnEvent {
+  CONN_EVENT_NONE,
+  CONN_EVENT_LOST,     // Just went offline, data on screen is now stale
+  CONN_EVENT_RESTORED  // Back online, time for a catch-up fetch
+};
+
+// Start supervising. Call once the first connection is up.
+void connectivity_begin();
+
+// Advance the state machine. Call from the main loop; returns at most one
+// event per call.
+ConnEvent connectivity_tick();
+
+ConnState connectivity_state();
+bool connectivity_online();
+
+// millis() when the connection was lost (valid while not online)
+unsigned long connectivity_offline_since();
+
+#endif
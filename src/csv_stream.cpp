@@ -0,0 +1,78 @@
+#include "csv_stream.h"
+
+enum CsvState {
+  STATE_START,        // At the start of a field
+  STATE_PLAIN,        // Inside an unquoted field
+  STATE_QUOTED,       // Inside quotes
+  STATE_QUOTE_QUOTED, // A quote inside quotes: closes them or is doubled
+  STATE_LINE_END      // After a CR, a LF belongs to the same line end
+};
+
+void csv_begin(CsvParser* parser) {
+  memset(parser, 0, sizeof(*parser));
+}
+
+static void append(CsvParser* parser, char c) {
+  if (parser->len < CSV_FIELD_MAX - 1) parser->field[parser->len++] = c;
+}
+
+static CsvEvent complete(CsvParser* parser, bool row_end) {
+  parser->field[parser->len] = '\0';
+  parser->len = 0;
+  parser->column = parser->next_column;
+  parser->row = parser->next_row;
+  if (row_end) {
+    parser->next_column = 0;
+    parser->next_row++;
+  } else {
+    parser->next_column++;
+  }
+  parser->state = row_end ? STATE_LINE_END : STATE_START;
+  return row_end ? CSV_ROW : CSV_FIELD;
+}
+
+CsvEvent csv_feed(CsvParser* parser, char c) {
+  switch (parser->state) {
+    case STATE_LINE_END:
+      if (c == '\n') return CSV_NONE;
+      parser->state = STATE_START;
+      // fall through
+    case STATE_START:
+      if (c == '"') {
+        parser->state = STATE_QUOTED;
+        return CSV_NONE;
+      }
+      // Blank lines are skipped rather than read as rows of one empty field
+      if ((c == '\r' || c == '\n') && parser->next_column == 0) return CSV_NONE;
+      parser->state = STATE_PLAIN;
+      // fall through
+    case STATE_PLAIN:
+      if (c == ',') return complete(parser, false);
+      if (c == '\r' || c == '\n') return complete(parser, true);
+      append(parser, c);
+      return CSV_NONE;
+    case STATE_QUOTED:
+      if (c == '"') parser->state = STATE_QUOTE_QUOTED;
+      else append(parser, c);
+      return CSV_NONE;
+    case STATE_QUOTE_QUOTED:
+      if (c == '"') {
+        append(parser, c);
+        parser->state = STATE_QUOTED;
+        return CSV_NONE;
+      }
+      if (c == ',') return complete(parser, false);
+      if (c == '\r' || c == '\n') return complete(parser, true);
+      parser->state = STATE_PLAIN; // Text after the closing quote
+      append(parser, c);
+      return CSV_NONE;
+  }
+  return CSV_NONE;
+}
+
+CsvEvent csv_finish(CsvParser* parser) {
+  bool open_field = parser->state == STATE_PLAIN || parser->state == STATE_QUOTED ||
+                    parser->state == STATE_QUOTE_QUOTED || parser->next_column > 0;
+  if (!open_field) return CSV_NONE;
+  return complete(parser, true);
+}
@@ -0,0 +1,38 @@
+#ifndef CSV_STREAM_H
+#define CSV_STREAM_H
+
+#include <Arduino.h>
+
+// Streaming CSV parser: characters are fed one at a time as they come off
+// the socket, so a response is never held in memory as a whole. Handles
+// quoted fields, doubled quotes inside them and CRLF line ends. A field
+// longer than CSV_FIELD_MAX - 1 is truncated.
+
+#define CSV_FIELD_MAX 24
+
+enum CsvEvent {
+  CSV_NONE,  // Nothing complete yet
+  CSV_FIELD, // parser.field holds the next field of the row
+  CSV_ROW    // parser.field holds the last field of the row
+};
+
+struct CsvParser {
+  char field[CSV_FIELD_MAX];
+  uint8_t column;  // Of the field just completed, from 0
+  uint16_t row;    // Of the field just completed, from 0
+  // Internal
+  uint8_t len;
+  uint8_t state;
+  uint8_t next_column;
+  uint16_t next_row;
+};
+
+void csv_begin(CsvParser* parser);
+
+// Feed one character
+CsvEvent csv_feed(CsvParser* parser, char c);
+
+// End of input: completes a last row without a line end
+CsvEvent csv_finish(CsvParser* parser);
+
+#endif
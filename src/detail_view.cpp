@@ -0,0 +1,334 @@
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include "detail_view.h"
+#include "chart_stream.h"
+#include "spi_calibration.h"
+#include "quote_store.h"
+#include "yahoo_api.h"
+#include "fetch_task.h"
+#include "logging.h"
+#include "../config.h"
+
+#define DETAIL_CACHE_SIZE 3    // Open symbol plus both neighbours
+#define DETAIL_READ_CHUNK 512  // Bytes pulled off the socket per parser call
+
+// Chart area (matches the table's 220 px content width)
+#define CHART_X 10
+#define CHART_Y 110
+#define CHART_W DETAIL_CHART_WIDTH
+#define CHART_H 150
+
+static ChartStream chart_stream; // ~700 bytes, only used on the fetch task
+
+static DetailData cache[DETAIL_CACHE_SIZE];
+static bool cache_ready = false;
+
+static int open_index = -1;
+static int pending_prefetch[2] = {-1, -1};
+static bool requested[NUM_STOCKS]; // Queued on the fetch task, not back yet
+
+static uint32_t latency_last_ms = 0;
+static uint32_t latency_max_ms = 0;
+
+static void init_cache() {
+  if (cache_ready) return;
+  for (int i = 0; i < DETAIL_CACHE_SIZE; i++) {
+    cache[i].index = -1;
+    cache[i].valid = false;
+  }
+  cache_ready = true;
+}
+
+static DetailData* find_cached(int index) {
+  for (int i = 0; i < DETAIL_CACHE_SIZE; i++) {
+    if (cache[i].index == index && cache[i].valid &&
+        millis() - cache[i].fetched_ms < DETAIL_CACHE_SECONDS * 1000UL) {
+      return &cache[i];
+    }
+  }
+  return nullptr;
+}
+
+// Reuse the slot already holding this symbol, else an empty slot, else the
+// oldest one that is not the symbol on screen
+static DetailData* slot_for(int index) {
+  for (int i = 0; i < DETAIL_CACHE_SIZE; i++) {
+    if (cache[i].index == index) return &cache[i];
+  }
+
+  DetailData* victim = nullptr;
+  for (int i = 0; i < DETAIL_CACHE_SIZE; i++) {
+    if (!cache[i].valid) return &cache[i];
+    if (cache[i].index == open_index) continue;
+    if (!victim || cache[i].fetched_ms < victim->fetched_ms) victim = &cache[i];
+  }
+  return victim;
+}
+
+static void request_detail(int index) {
+  if (requested[index]) return;
+  requested[index] = fetch_task_submit(FETCH_DETAIL, index);
+}
+
+bool detail_fetch(int index, DetailData* d) {
+  d->index = index;
+  d->valid = false;
+
+  String url = String(YAHOO_CHART_URL) + STOCK_SYMBOLS[index] + "?range=1d&interval=1m";
+  LOGI("Fetching detail for %s...", STOCK_SYMBOLS[index]);
+
+  HTTPClient http;
+  http.useHTTP10(true); // No chunked encoding, so the body can be parsed straight from the stream
+  yahoo_begin(http, url);
+
+  int httpCode = http.GET();
+  if (httpCode != HTTP_CODE_OK) {
+    LOGW("Detail HTTP GET failed: %d", httpCode);
+    http.end();
+    return false;
+  }
+
+  // The 1 minute series is ~390 points per array, so nothing is buffered:
+  // the body goes through the parser chunk by chunk and the close prices are
+  // downsampled to the chart width as they arrive
+  unsigned long start = millis();
+  size_t body_bytes = 0;
+  char buf[DETAIL_READ_CHUNK];
+  ChartStream* cs = &chart_stream;
+  chart_stream_begin(cs, d->points, CHART_W);
+
+  WiFiClient* stream = http.getStreamPtr();
+  int remaining = http.getSize(); // -1 when the server sends no length
+  while (http.connected() && (remaining > 0 || remaining == -1)) {
+    size_t available = stream->available();
+    if (available == 0) {
+      if (millis() - start > 15000) break;
+      delay(1);
+      continue;
+    }
+    int n = stream->readBytes(buf, available < sizeof(buf) ? available : sizeof(buf));
+    chart_stream_feed(cs, buf, n);
+    body_bytes += n;
+    if (remaining > 0) remaining -= n;
+  }
+  http.end();
+
+  int num_points = chart_stream_finish(cs);
+  if (num_points < 2 || cs->day_high <= 0) {
+    LOGE("ERROR: No detail data found");
+    return false;
+  }
+
+  d->day_high = cs->day_high;
+  d->day_low = cs->day_low;
+  d->volume = cs->volume;
+  d->prev_close = cs->previous_close;
+  d->series_length = cs->series_length > 1 ? cs->series_length : d->points[num_points - 1].index + 1;
+  d->num_points = num_points;
+
+  d->valid = true;
+  LOGI("Detail for %s: range %.2f-%.2f, %d of %d points, %u bytes in %lu ms",
+       STOCK_SYMBOLS[index], d->day_low, d->day_high, d->num_points, d->series_length,
+       (unsigned)body_bytes, millis() - start);
+  return true;
+}
+
+static void draw_header(TFT_eSPI& tft, int index) {
+  const StockData& s = stocks[index];
+
+  tft.fillScreen(TFT_BLACK);
+
+  tft.setCursor(10, 5);
+  tft.setTextColor(TFT_CYAN);
+  tft.setTextSize(2);
+  tft.print(s.symbol);
+
+  tft.setCursor(10, 30);
+  tft.setTextColor(TFT_WHITE);
+  if (s.valid) {
+    tft.printf("$%.2f", s.price);
+
+    tft.setCursor(10, 50);
+    tft.setTextSize(1);
+    tft.setTextColor((s.change >= 0) ? TFT_GREEN : TFT_RED);
+    tft.printf("%+.2f (%+.2f%%)", s.change, s.change_percent);
+  } else {
+    tft.setTextColor(TFT_YELLOW);
+    tft.print("Loading...");
+  }
+
+  tft.drawLine(10, 64, 230, 64, TFT_BLUE);
+
+  tft.setCursor(10, 300);
+  tft.setTextColor(TFT_DARKGREY);
+  tft.setTextSize(1);
+  tft.print("Tap anywhere to go back");
+}
+
+static void draw_volume(TFT_eSPI& tft, uint32_t volume) {
+  if (volume >= 1000000) {
+    tft.printf("%.1fM", volume / 1000000.0);
+  } else if (volume >= 1000) {
+    tft.printf("%.1fK", volume / 1000.0);
+  } else {
+    tft.printf("%u", (unsigned)volume);
+  }
+}
+
+static void draw_chart(TFT_eSPI& tft, const DetailData& d) {
+  tft.drawRect(CHART_X - 1, CHART_Y - 1, CHART_W + 2, CHART_H + 2, TFT_NAVY);
+  if (d.num_points < 2) return;
+
+  float lo = d.points[0].value;
+  float hi = d.points[0].value;
+  for (int i = 1; i < d.num_points; i++) {
+    if (d.points[i].value < lo) lo = d.points[i].value;
+    if (d.points[i].value > hi) hi = d.points[i].value;
+  }
+  // Keep the previous close in view so the baseline means something
+  if (d.prev_close > 0) {
+    if (d.prev_close < lo) lo = d.prev_close;
+    if (d.prev_close > hi) hi = d.prev_close;
+  }
+  if (hi - lo < 0.01) hi = lo + 0.01;
+
+  float scale = (CHART_H - 1) / (hi - lo);
+  if (d.prev_close > 0) {
+    int base_y = CHART_Y + CHART_H - 1 - (int)((d.prev_close - lo) * scale);
+    for (int x = CHART_X; x < CHART_X + CHART_W; x += 4) {
+      tft.drawPixel(x, base_y, TFT_DARKGREY);
+    }
+  }
+
+  // Points keep their position in the full series, so gaps from missing
+  // minutes stay where they happened instead of being squeezed out
+  uint16_t color = (d.points[d.num_points - 1].value >= d.prev_close) ? TFT_GREEN : TFT_RED;
+  long span = d.series_length > 1 ? d.series_length - 1 : 1;
+  int prev_x = CHART_X + (long)d.points[0].index * (CHART_W - 1) / span;
+  int prev_y = CHART_Y + CHART_H - 1 - (int)((d.points[0].value - lo) * scale);
+  for (int i = 1; i < d.num_points; i++) {
+    int x = CHART_X + (long)d.points[i].index * (CHART_W - 1) / span;
+    int y = CHART_Y + CHART_H - 1 - (int)((d.points[i].value - lo) * scale);
+    tft.drawLine(prev_x, prev_y, x, y, color);
+    prev_x = x;
+    prev_y = y;
+  }
+
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_DARKGREY);
+  tft.setCursor(CHART_X + 2, CHART_Y + 2);
+  tft.printf("%.2f", hi);
+  tft.setCursor(CHART_X + 2, CHART_Y + CHART_H - 10);
+  tft.printf("%.2f", lo);
+}
+
+static void draw_details(TFT_eSPI& tft, const DetailData* d) {
+  tft.fillRect(10, 70, 220, 30, TFT_BLACK);
+  tft.fillRect(CHART_X - 1, CHART_Y - 1, CHART_W + 2, CHART_H + 2, TFT_BLACK);
+
+  tft.setTextSize(1);
+  tft.setCursor(10, 72);
+  if (!d) {
+    tft.setTextColor(TFT_YELLOW);
+    tft.print("Loading details...");
+    return;
+  }
+
+  tft.setTextColor(TFT_WHITE);
+  tft.printf("Day range: $%.2f - $%.2f", d->day_low, d->day_high);
+  tft.setCursor(10, 87);
+  tft.print("Volume: ");
+  draw_volume(tft, d->volume);
+
+  draw_chart(tft, *d);
+}
+
+bool detail_is_open() {
+  return open_index >= 0;
+}
+
+void detail_open(TFT_eSPI& tft, int stock_index, uint32_t tap_us) {
+  init_cache();
+  open_index = stock_index;
+
+  // First pixels come from data already in RAM, the network comes after
+  DetailData* d = find_cached(stock_index);
+  tft_begin_frame(tft);
+  draw_header(tft, stock_index);
+  draw_details(tft, d);
+  tft_end_frame(tft);
+
+  latency_last_ms = (micros() - tap_us) / 1000;
+  if (latency_last_ms > latency_max_ms) latency_max_ms = latency_last_ms;
+  LOGI("Tap-to-first-pixel: %u ms (max %u ms)%s",
+       (unsigned)latency_last_ms, (unsigned)latency_max_ms,
+       latency_last_ms > DETAIL_LATENCY_TARGET_MS ? " [OVER TARGET]" : "");
+
+  // Drawn by detail_accept() when it arrives
+  if (!d) {
+    request_detail(stock_index);
+  }
+
+  // Neighbours are the most likely next taps
+  pending_prefetch[0] = (stock_index + 1) % NUM_STOCKS;
+  pending_prefetch[1] = (stock_index + NUM_STOCKS - 1) % NUM_STOCKS;
+}
+
+void detail_close() {
+  open_index = -1;
+  pending_prefetch[0] = -1;
+  pending_prefetch[1] = -1;
+}
+
+void detail_service() {
+  // Prefetches wait for the quote fetches to finish
+  if (!detail_is_open() || fetch_task_busy()) return;
+
+  for (int i = 0; i < 2; i++) {
+    int index = pending_prefetch[i];
+    if (index < 0) continue;
+
+    pending_prefetch[i] = -1;
+    if (index != open_index && !find_cached(index)) {
+      request_detail(index);
+      return; // One at a time, the open symbol's refresh may need the task
+    }
+  }
+}
+
+void detail_accept(TFT_eSPI& tft, int index, DetailData* d) {
+  init_cache();
+  requested[index] = false;
+
+  DetailData* slot = nullptr;
+  if (d && d->valid) {
+    slot = slot_for(index);
+    if (slot) {
+      *slot = *d;
+      slot->fetched_ms = millis();
+    }
+  }
+  free(d);
+
+  if (open_index != index) return;
+
+  tft_begin_frame(tft);
+  if (slot) {
+    draw_details(tft, slot);
+  } else if (!find_cached(index)) {
+    tft.fillRect(10, 70, 220, 30, TFT_BLACK);
+    tft.setCursor(10, 72);
+    tft.setTextSize(1);
+    tft.setTextColor(TFT_RED);
+    tft.print("Details unavailable");
+  }
+  tft_end_frame(tft);
+}
+
+uint32_t detail_latency_last_ms() {
+  return latency_last_ms;
+}
+
+uint32_t detail_latency_max_ms() {
+  return latency_max_ms;
+}
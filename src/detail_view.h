@@ -0,0 +1,53 @@
+#ifndef DETAIL_VIEW_H
+#define DETAIL_VIEW_H
+
+#include <TFT_eSPI.h>
+#include "chart_stream.h"
+
+// Full-screen detail view for one symbol: price, day range, volume and an
+// intraday chart. The extra data is fetched on demand (on the fetch task)
+// and cached, and the neighbours of the open symbol are prefetched while
+// the fetch task is idle.
+
+#define DETAIL_CHART_WIDTH 220 // Plot width in pixels, one point per column at most
+
+struct DetailData {
+  int index;          // Stock index, -1 = empty slot
+  bool valid;
+  unsigned long fetched_ms;
+  float day_high;
+  float day_low;
+  uint32_t volume;
+  float prev_close;
+  int series_length;  // Positions in the full series, for the x axis
+  int num_points;
+  ChartPoint points[DETAIL_CHART_WIDTH]; // Downsampled close prices
+};
+
+bool detail_is_open();
+
+// Draw the view for stocks[stock_index]. The header is drawn from the quote
+// store straight away; range, volume and chart follow once fetched.
+// tap_us is the touch interrupt time, used to measure tap-to-first-pixel.
+void detail_open(TFT_eSPI& tft, int stock_index, uint32_t tap_us);
+
+void detail_close();
+
+// Queue a prefetch for one pending neighbour, if the fetch task is idle.
+// Call from the main loop.
+void detail_service();
+
+// Fetch the detail data for stocks[index] into d. Blocks for the whole
+// request; runs on the fetch task.
+bool detail_fetch(int index, DetailData* d);
+
+// Take a finished fetch for stocks[index] into the cache (and onto the
+// screen if that symbol is open). d may be null or invalid if the fetch
+// failed. Frees d. Call from the main loop.
+void detail_accept(TFT_eSPI& tft, int index, DetailData* d);
+
+// Tap-to-first-pixel latency statistics in milliseconds
+uint32_t detail_latency_last_ms();
+uint32_t detail_latency_max_ms();
+
+#endif
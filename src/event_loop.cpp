@@ -0,0 +1,131 @@
+#include "event_loop.h"
+#include "health.h"
+#include "logging.h"
+#include "../config.h"
+
+struct Timer {
+  const char* name;
+  TimerCallback callback;
+  uint32_t period_ms;
+  uint32_t next_ms;
+  bool running;
+};
+
+static Timer timers[EVENT_LOOP_MAX_TIMERS];
+static int num_timers = 0;
+
+// Worst case since boot, and since the last report
+static EventLoopStats total = {0, 0, 0, 0, ""};
+static EventLoopStats window = {0, 0, 0, 0, ""};
+static uint32_t last_pass_us = 0;
+static unsigned long last_report_ms = 0;
+
+int timer_add(const char* name, uint32_t period_ms, TimerCallback callback) {
+  if (num_timers >= EVENT_LOOP_MAX_TIMERS) {
+    LOGE("ERROR: No timer slot for %s", name);
+    return -1;
+  }
+  Timer& t = timers[num_timers];
+  t.name = name;
+  t.callback = callback;
+  t.period_ms = period_ms;
+  t.next_ms = millis() + period_ms;
+  t.running = true;
+  return num_timers++;
+}
+
+void timer_start(int id, uint32_t delay_ms) {
+  if (id < 0 || id >= num_timers) return;
+  timers[id].next_ms = millis() + delay_ms;
+  timers[id].running = true;
+}
+
+void timer_stop(int id) {
+  if (id < 0 || id >= num_timers) return;
+  timers[id].running = false;
+}
+
+static void record(EventLoopStats& s, uint32_t gap_us, uint32_t late_us, uint32_t block_us, const char* by) {
+  if (gap_us > s.max_gap_us) s.max_gap_us = gap_us;
+  if (late_us > s.max_late_us) s.max_late_us = late_us;
+  if (block_us > s.max_block_us) {
+    s.max_block_us = block_us;
+    s.max_block_by = by;
+  }
+}
+
+static void report() {
+  LOGI("Event loop: %u passes in %u s, max gap %u ms, max timer lateness %u ms, "
+       "longest handler %s %u ms",
+       (unsigned)window.passes, (unsigned)(EVENT_LOOP_REPORT_SECONDS),
+       (unsigned)(window.max_gap_us / 1000), (unsigned)(window.max_late_us / 1000),
+       window.max_block_by, (unsigned)(window.max_block_us / 1000));
+  if (window.max_block_us > EVENT_LOOP_BLOCK_WARN_MS * 1000UL) {
+    LOGW("WARNING: %s blocked the loop for %u ms",
+         window.max_block_by, (unsigned)(window.max_block_us / 1000));
+  }
+  window = {0, 0, 0, 0, ""};
+}
+
+void event_loop_run() {
+  uint32_t pass_start = micros();
+  uint32_t gap_us = last_pass_us ? pass_start - last_pass_us : 0;
+  record(total, gap_us, 0, 0, "");
+  record(window, gap_us, 0, 0, "");
+  last_pass_us = pass_start;
+
+  for (int i = 0; i < num_timers; i++) {
+    Timer& t = timers[i];
+    if (!t.running) continue;
+
+    uint32_t now = millis();
+    if ((int32_t)(now - t.next_ms) < 0) continue;
+
+    uint32_t late_us = 0;
+    if (t.period_ms > 0) {
+      late_us = (now - t.next_ms) * 1000;
+      // Keep the schedule, but skip missed periods instead of bunching up
+      t.next_ms += t.period_ms;
+      if ((int32_t)(now - t.next_ms) >= 0) t.next_ms = now + t.period_ms;
+    }
+
+    uint32_t start = micros();
+    health_mark(HEALTH_LOOP, t.name);
+    t.callback();
+    health_mark(HEALTH_LOOP, "");
+    uint32_t block_us = micros() - start;
+
+    record(total, 0, late_us, block_us, t.name);
+    record(window, 0, late_us, block_us, t.name);
+  }
+
+  total.passes++;
+  window.passes++;
+  health_feed();
+
+  if (millis() - last_report_ms >= EVENT_LOOP_REPORT_SECONDS * 1000UL) {
+    last_report_ms = millis();
+    report();
+  }
+
+  // Let the idle task run (and feed its watchdog)
+  delay(1);
+}
+
+uint32_t event_loop_next_due_ms(uint32_t max_ms) {
+  uint32_t now = millis();
+  uint32_t next = max_ms;
+  for (int i = 0; i < num_timers; i++) {
+    const Timer& t = timers[i];
+    if (!t.running || t.period_ms == 0) continue;
+
+    int32_t remaining = (int32_t)(t.next_ms - now);
+    if (remaining <= 0) return 0;
+    if ((uint32_t)remaining < next) next = remaining;
+  }
+  return next;
+}
+
+void event_loop_stats(EventLoopStats* stats) {
+  *stats = total;
+}
@@ -0,0 +1,45 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <Arduino.h>
+
+// Cooperative main loop. Work is split into short handlers: timers that run
+// every period_ms, and idle handlers (period 0) that run on every pass.
+// Nothing may wait inside a handler; long work goes to the fetch task.
+//
+// Each pass measures how long every handler ran, how late the timers fired
+// and the gap between passes, and the worst values are logged periodically
+// so anything that blocks shows up straight away.
+
+#define EVENT_LOOP_MAX_TIMERS 16
+
+typedef void (*TimerCallback)();
+
+// Register a handler. Returns its id, or -1 if the table is full. Timers
+// first run one period from now; idle handlers (period_ms = 0) on the next
+// pass.
+int timer_add(const char* name, uint32_t period_ms, TimerCallback callback);
+
+// (Re)start a timer, first run after delay_ms (0 = next pass)
+void timer_start(int id, uint32_t delay_ms);
+void timer_stop(int id);
+
+// Run everything that is due, then yield for a moment. Call from loop().
+void event_loop_run();
+
+struct EventLoopStats {
+  uint32_t passes;          // Since the last report
+  uint32_t max_gap_us;      // Longest time between two passes
+  uint32_t max_late_us;     // Worst timer lateness (jitter)
+  uint32_t max_block_us;    // Longest single handler run
+  const char* max_block_by; // Which handler that was
+};
+
+// Milliseconds until the next running timer is due (0 = overdue), or
+// max_ms if none is sooner. Idle handlers are not counted; they only poll.
+uint32_t event_loop_next_due_ms(uint32_t max_ms);
+
+// Worst-case figures since boot
+void event_loop_stats(EventLoopStats* stats);
+
+#endif
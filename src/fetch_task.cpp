@@ -0,0 +1,174 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "fetch_task.h"
+#include "detail_view.h"
+#include "aggregator_client.h"
+#include "quote_provider.h"
+#include "health.h"
+#include "../config.h"
+
+#define FETCH_TASK_STACK 12288 // HTTPS handshake plus the JSON parser
+#define FETCH_TASK_PRIORITY 1
+#define FETCH_TASK_CORE 0      // The main loop runs on core 1
+#define FETCH_QUEUE_LENGTH (NUM_STOCKS + LAN_FANOUT_MAX_EXTRA + 4) // Room for a whole cycle
+#define FETCH_BATCH_MAX (AGGREGATOR_BATCH_MAX > PROVIDER_BATCH_MAX ? AGGREGATOR_BATCH_MAX : PROVIDER_BATCH_MAX)
+
+struct FetchJob {
+  uint8_t type;
+  int16_t index;
+  char symbol[FETCH_SYMBOL_LEN];
+  int8_t provider; // -1 = whichever is current
+  uint8_t tried;   // Providers that had no quote for it, bit 1 << id
+};
+
+static QueueHandle_t job_queue = nullptr;
+static QueueHandle_t result_queue = nullptr;
+static int jobs_in_flight = 0; // Main loop only: +1 on submit, -1 on poll
+
+#if QUOTE_SOURCE == QUOTE_SOURCE_AGGREGATOR
+// No routing on the LAN, and no rate limit to respect
+static const QuoteProvider aggregator = {"aggregator", true, AGGREGATOR_BATCH_MAX, 0, aggregator_fetch_quotes};
+#endif
+
+// Provider for a quote job, and its id (-1 for the aggregator). A retry
+// names its provider, the rest go to the current one.
+static const QuoteProvider& job_provider(const FetchJob& job, int* id) {
+#if QUOTE_SOURCE == QUOTE_SOURCE_AGGREGATOR
+  *id = -1;
+  return aggregator;
+#else
+  *id = job.provider >= 0 ? job.provider : quote_provider_current();
+  return quote_provider(*id);
+#endif
+}
+
+// Quote jobs waiting in the queue are collected into one request, as many
+// as the provider takes at once. Each still gets its own result.
+static void fetch_quotes(const FetchJob& first) {
+  int id;
+  const QuoteProvider& provider = job_provider(first, &id);
+
+  static FetchJob batch[FETCH_BATCH_MAX];
+  int count = 0;
+  batch[count++] = first;
+
+  // This task is the only reader, so a peeked job is still there to take
+  FetchJob next;
+  while (count < provider.batch_max && xQueuePeek(job_queue, &next, 0) == pdTRUE &&
+         next.type != FETCH_DETAIL && next.provider == first.provider) {
+    xQueueReceive(job_queue, &batch[count++], 0);
+  }
+
+  const char* symbols[FETCH_BATCH_MAX];
+  YahooQuote quotes[FETCH_BATCH_MAX];
+  bool ok[FETCH_BATCH_MAX];
+  FetchStatus status;
+  memset(quotes, 0, sizeof(quotes)); // Providers only fill in what their source has
+  for (int i = 0; i < count; i++) {
+    symbols[i] = batch[i].symbol;
+  }
+  health_mark(HEALTH_FETCH, provider.name, first.symbol);
+  int received = provider.fetch(symbols, count, quotes, ok, &status);
+  health_mark(HEALTH_FETCH, "");
+  status.batch = count;
+  status.received = received;
+
+  for (int i = 0; i < count; i++) {
+    FetchResult result;
+    memset(&result, 0, sizeof(result));
+    result.type = batch[i].type;
+    result.index = batch[i].index;
+    memcpy(result.symbol, batch[i].symbol, sizeof(result.symbol));
+    result.ok = ok[i];
+    result.quote = quotes[i];
+    result.status = status;
+    result.provider = id;
+    result.tried = batch[i].tried;
+    result.batch_index = i;
+    // Never fuller than the job queue, so this does not wait in practice
+    xQueueSend(result_queue, &result, portMAX_DELAY);
+  }
+
+  // Rate limiting between quote requests
+  if (provider.spacing_ms > 0) {
+    vTaskDelay(pdMS_TO_TICKS(provider.spacing_ms));
+  }
+}
+
+static void fetch_task(void*) {
+  health_watch_task();
+  FetchJob job;
+  for (;;) {
+    health_feed();
+    // Wakes up now and then while idle to feed the watchdog
+    if (xQueueReceive(job_queue, &job, pdMS_TO_TICKS(WATCHDOG_SECONDS * 500)) != pdTRUE) continue;
+
+    if (job.type == FETCH_QUOTE || job.type == FETCH_SHARED) {
+      fetch_quotes(job);
+      continue;
+    }
+
+    FetchResult result;
+    memset(&result, 0, sizeof(result));
+    result.type = job.type;
+    result.index = job.index;
+    memcpy(result.symbol, job.symbol, sizeof(result.symbol));
+
+    // Sent back even on failure, the receiver frees it
+    result.detail = (DetailData*)malloc(sizeof(DetailData));
+    health_mark(HEALTH_FETCH, "detail", job.symbol);
+    result.ok = result.detail && detail_fetch(job.index, result.detail);
+    health_mark(HEALTH_FETCH, "");
+    xQueueSend(result_queue, &result, portMAX_DELAY);
+  }
+}
+
+void fetch_task_begin() {
+  job_queue = xQueueCreate(FETCH_QUEUE_LENGTH, sizeof(FetchJob));
+  result_queue = xQueueCreate(FETCH_QUEUE_LENGTH, sizeof(FetchResult));
+  xTaskCreatePinnedToCore(fetch_task, "fetch", FETCH_TASK_STACK, nullptr,
+                          FETCH_TASK_PRIORITY, nullptr, FETCH_TASK_CORE);
+}
+
+static bool submit(FetchJobType type, int index, const char* symbol, int provider = -1, uint8_t tried = 0) {
+  FetchJob job;
+  job.type = (uint8_t)type;
+  job.index = (int16_t)index;
+  strncpy(job.symbol, symbol, sizeof(job.symbol) - 1);
+  job.symbol[sizeof(job.symbol) - 1] = '\0';
+  job.provider = (int8_t)provider;
+  job.tried = tried;
+
+  if (xQueueSend(job_queue, &job, 0) != pdTRUE) return false;
+  jobs_in_flight++;
+  return true;
+}
+
+bool fetch_task_submit(FetchJobType type, int index) {
+  return submit(type, index, STOCK_SYMBOLS[index]);
+}
+
+bool fetch_task_submit_symbol(FetchJobType type, const char* symbol) {
+  return submit(type, -1, symbol);
+}
+
+bool fetch_task_retry(const FetchResult& missed, int provider, uint8_t tried) {
+  return submit((FetchJobType)missed.type, missed.index, missed.symbol, provider, tried);
+}
+
+bool fetch_task_poll(FetchResult* result) {
+  if (xQueueReceive(result_queue, result, 0) != pdTRUE) return false;
+  jobs_in_flight--;
+  return true;
+}
+
+bool fetch_task_busy() {
+  return jobs_in_flight > 0;
+}
+
+void fetch_task_queue_depths(int* jobs, int* results) {
+  *jobs = job_queue ? (int)uxQueueMessagesWaiting(job_queue) : 0;
+  *results = result_queue ? (int)uxQueueMessagesWaiting(result_queue) : 0;
+}
@@ -0,0 +1,55 @@
+#ifndef FETCH_TASK_H
+#define FETCH_TASK_H
+
+#include <Arduino.h>
+#include "yahoo_api.h"
+
+struct DetailData;
+
+// All HTTP requests run on a separate FreeRTOS task so the main loop (touch,
+// drawing, animation) never waits on the network. Jobs go in through one
+// queue and results come back through another; the main loop applies them,
+// so the quote store and the display are only ever touched from there.
+
+#define FETCH_SYMBOL_LEN 12
+
+enum FetchJobType {
+  FETCH_QUOTE,  // Quote for one watchlist symbol
+  FETCH_DETAIL, // Day range, volume and chart for the detail view
+  FETCH_SHARED  // Quote for another tracker on the LAN (index unused)
+};
+
+struct FetchResult {
+  uint8_t type;         // FetchJobType
+  int16_t index;        // Stock index
+  char symbol[FETCH_SYMBOL_LEN];
+  bool ok;
+  YahooQuote quote;     // FETCH_QUOTE
+  FetchStatus status;   // FETCH_QUOTE, the whole request's
+  int8_t provider;      // QuoteProvider id, -1 for the aggregator
+  uint8_t tried;        // Providers asked before this one, bit 1 << id
+  uint8_t batch_index;  // Position in the request, 0 for the first result
+  DetailData* detail;   // FETCH_DETAIL, heap allocated (null if that failed), owned by the receiver
+};
+
+void fetch_task_begin();
+
+// Queue a job. Never blocks; returns false if the queue is full.
+bool fetch_task_submit(FetchJobType type, int index);
+
+// Queue a quote for a symbol that is not on the watchlist (FETCH_SHARED)
+bool fetch_task_submit_symbol(FetchJobType type, const char* symbol);
+
+// Ask provider for a quote job again after the providers in tried had none
+bool fetch_task_retry(const FetchResult& missed, int provider, uint8_t tried);
+
+// Take the next finished job, if any. Never blocks.
+bool fetch_task_poll(FetchResult* result);
+
+// True while jobs are queued or running
+bool fetch_task_busy();
+
+// Jobs waiting for the task, and results waiting for the main loop
+void fetch_task_queue_depths(int* jobs, int* results);
+
+#endif
@@ -0,0 +1,244 @@
+#include <Preferences.h>
+#include <esp_system.h>
+#include <esp_idf_version.h>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+#include <esp_core_dump.h>
+#endif
+#include "health.h"
+#include "logging.h"
+#include "../config.h"
+
+#define HEALTH_MAGIC 0x4845414C // "HEAL"
+#define HEALTH_MARK_LEN 24
+#define HEALTH_BACKTRACE_MAX 10 // Addresses logged, to fit a log line
+
+static const char* const TASK_NAMES[] = {"loopTask", "fetch", "log", "mqtt", "push", "stream", "ota"};
+#define HEALTH_NUM_TASKS (int)(sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0]))
+
+// Kept across panics and watchdog resets, not across power loss
+struct HealthRecord {
+  uint32_t magic;
+  uint32_t uptime_s;
+  uint32_t heap_free;
+  uint32_t heap_min;
+  uint32_t heap_largest;
+  int16_t stack_free[HEALTH_NUM_TASKS];
+  uint32_t alloc_failures;
+  uint32_t alloc_failed_size;
+  char alloc_failed_task[16];
+  char marks[HEALTH_NUM_MARKS][HEALTH_MARK_LEN];
+};
+
+RTC_NOINIT_ATTR static HealthRecord rtc;
+
+static esp_reset_reason_t reset_reason = ESP_RST_UNKNOWN;
+static uint32_t crashes = 0;
+static HealthTaskStack stacks[HEALTH_NUM_TASKS];
+static bool stack_warned[HEALTH_NUM_TASKS];
+
+static const char* reason_name(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON: return "power on";
+    case ESP_RST_EXT: return "reset pin";
+    case ESP_RST_SW: return "restart";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "interrupt watchdog";
+    case ESP_RST_TASK_WDT: return "task watchdog";
+    case ESP_RST_WDT: return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default: return "unknown";
+  }
+}
+
+// Resets that leave a core dump behind
+static bool crashed(esp_reset_reason_t reason) {
+  return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+         reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+}
+
+// Runs inside the failing malloc: no logging, no allocating
+static void on_alloc_failed(size_t size, uint32_t caps, const char* function) {
+  rtc.alloc_failures++;
+  rtc.alloc_failed_size = size;
+  strncpy(rtc.alloc_failed_task, pcTaskGetName(nullptr), sizeof(rtc.alloc_failed_task) - 1);
+  rtc.alloc_failed_task[sizeof(rtc.alloc_failed_task) - 1] = '\0';
+}
+
+static void report_record() {
+  LOGW("Before the reset: up %u s, heap %u free, %u lowest, %u largest block",
+       (unsigned)rtc.uptime_s, (unsigned)rtc.heap_free, (unsigned)rtc.heap_min, (unsigned)rtc.heap_largest);
+
+  char line[LOG_LINE_MAX];
+  int len = snprintf(line, sizeof(line), "Unused stack:");
+  for (int i = 0; i < HEALTH_NUM_TASKS && len < (int)sizeof(line); i++) {
+    if (rtc.stack_free[i] < 0) continue;
+    len += snprintf(line + len, sizeof(line) - len, " %s %d", TASK_NAMES[i], rtc.stack_free[i]);
+  }
+  LOGW("%s", line);
+
+  for (int m = 0; m < HEALTH_NUM_MARKS; m++) {
+    rtc.marks[m][HEALTH_MARK_LEN - 1] = '\0';
+  }
+  LOGW("Main loop was in: %s", rtc.marks[HEALTH_LOOP][0] ? rtc.marks[HEALTH_LOOP] : "(between handlers)");
+  LOGW("Fetch task was on: %s", rtc.marks[HEALTH_FETCH][0] ? rtc.marks[HEALTH_FETCH] : "(idle)");
+  if (rtc.alloc_failures > 0) {
+    rtc.alloc_failed_task[sizeof(rtc.alloc_failed_task) - 1] = '\0';
+    LOGW("%u failed allocations, the last of %u bytes in %s",
+         (unsigned)rtc.alloc_failures, (unsigned)rtc.alloc_failed_size, rtc.alloc_failed_task);
+  }
+}
+
+static void report_core_dump() {
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+  size_t address, size;
+  if (esp_core_dump_image_get(&address, &size) != ESP_OK) {
+    LOGW("No core dump in flash");
+    return;
+  }
+  LOGW("Core dump of %u bytes in flash, at /coredump on the metrics port", (unsigned)size);
+#if CONFIG_ESP_COREDUMP_DATA_FORMAT_ELF
+  esp_core_dump_summary_t summary;
+  if (esp_core_dump_get_summary(&summary) != ESP_OK) return;
+  LOGW("Crashed in task %s at 0x%08x", summary.exc_task, (unsigned)summary.exc_pc);
+  char line[LOG_LINE_MAX];
+  int len = snprintf(line, sizeof(line), "Backtrace%s:", summary.exc_bt_info.corrupted ? " (corrupted)" : "");
+  for (int i = 0; i < (int)summary.exc_bt_info.depth && i < HEALTH_BACKTRACE_MAX && len < (int)sizeof(line); i++) {
+    len += snprintf(line + len, sizeof(line) - len, " 0x%08x", (unsigned)summary.exc_bt_info.bt[i]);
+  }
+  LOGW("%s", line);
+#endif
+#else
+  LOGW("Core dumps to flash are not enabled in this build");
+#endif
+}
+
+void health_begin() {
+  reset_reason = esp_reset_reason();
+  bool valid = rtc.magic == HEALTH_MAGIC && reset_reason != ESP_RST_POWERON;
+
+  Preferences prefs;
+  prefs.begin("health", false);
+  crashes = prefs.getUInt("crashes", 0);
+  if (crashed(reset_reason)) prefs.putUInt("crashes", ++crashes);
+  prefs.end();
+
+  if (crashed(reset_reason) || reset_reason == ESP_RST_BROWNOUT) {
+    LOGE("ERROR: Last reset: %s (%u crashes so far)", reason_name(reset_reason), (unsigned)crashes);
+    if (valid) report_record();
+    if (crashed(reset_reason)) report_core_dump();
+  } else {
+    LOGI("Last reset: %s", reason_name(reset_reason));
+  }
+
+  memset(&rtc, 0, sizeof(rtc));
+  for (int i = 0; i < HEALTH_NUM_TASKS; i++) {
+    rtc.stack_free[i] = -1;
+    stacks[i] = {TASK_NAMES[i], -1};
+  }
+  rtc.magic = HEALTH_MAGIC;
+  heap_caps_register_failed_alloc_callback(on_alloc_failed);
+
+#if WATCHDOG_ENABLED
+  // The watchdog is already running for the idle task; this sets our
+  // timeout and makes it panic, so a stall leaves a core dump
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_task_wdt_config_t config = {WATCHDOG_SECONDS * 1000, 1, true};
+  esp_task_wdt_reconfigure(&config);
+#else
+  esp_task_wdt_init(WATCHDOG_SECONDS, true);
+#endif
+#endif
+}
+
+void health_watch_task() {
+#if WATCHDOG_ENABLED
+  esp_task_wdt_add(nullptr);
+#endif
+}
+
+void health_feed() {
+#if WATCHDOG_ENABLED
+  esp_task_wdt_reset();
+#endif
+}
+
+void health_mark(HealthMark which, const char* what, const char* detail) {
+  char* mark = rtc.marks[which];
+  if (detail) {
+    snprintf(mark, HEALTH_MARK_LEN, "%s %s", what, detail);
+  } else {
+    strncpy(mark, what, HEALTH_MARK_LEN - 1);
+  }
+}
+
+void health_snapshot() {
+  rtc.uptime_s = millis() / 1000;
+  rtc.heap_free = ESP.getFreeHeap();
+  rtc.heap_min = ESP.getMinFreeHeap();
+  rtc.heap_largest = ESP.getMaxAllocHeap();
+
+  for (int i = 0; i < HEALTH_NUM_TASKS; i++) {
+    TaskHandle_t task = xTaskGetHandle(TASK_NAMES[i]);
+    int free_bytes = task ? (int)uxTaskGetStackHighWaterMark(task) : -1;
+    stacks[i].free_bytes = free_bytes;
+    rtc.stack_free[i] = free_bytes;
+    if (free_bytes >= 0 && free_bytes < HEALTH_STACK_WARN_BYTES && !stack_warned[i]) {
+      LOGW("WARNING: Task %s has only %d bytes of stack left", TASK_NAMES[i], free_bytes);
+      stack_warned[i] = true;
+    }
+  }
+}
+
+int health_task_stacks(const HealthTaskStack** out) {
+  *out = stacks;
+  return HEALTH_NUM_TASKS;
+}
+
+const char* health_reset_reason() {
+  return reason_name(reset_reason);
+}
+
+uint32_t health_crashes() {
+  return crashes;
+}
+
+uint32_t health_alloc_failures() {
+  return rtc.alloc_failures;
+}
+
+bool health_core_dump(const uint8_t** data, size_t* length) {
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+  static const void* mapped = nullptr;
+  static size_t mapped_length = 0;
+  if (!mapped) {
+    size_t address, size;
+    if (esp_core_dump_image_get(&address, &size) != ESP_OK) return false;
+    const esp_partition_t* part =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_COREDUMP, nullptr);
+    if (!part || address < part->address || address + size > part->address + part->size) return false;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_partition_mmap_handle_t handle;
+    if (esp_partition_mmap(part, address - part->address, size, ESP_PARTITION_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+#else
+    spi_flash_mmap_handle_t handle;
+    if (esp_partition_mmap(part, address - part->address, size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+#endif
+      mapped = nullptr;
+      return false;
+    }
+    mapped_length = size; // Stays mapped, the dump only changes with a crash
+  }
+  *data = (const uint8_t*)mapped;
+  *length = mapped_length;
+  return true;
+#else
+  return false;
+#endif
+}
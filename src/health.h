@@ -0,0 +1,53 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <Arduino.h>
+
+// Crash and stall telemetry, for trackers that freeze in the field.
+//
+// The task watchdog watches the main loop and the fetch task: if either is
+// stuck for WATCHDOG_SECONDS (a hung request, a handler in an endless
+// loop) the tracker panics, which saves a core dump to the coredump flash
+// partition and restarts. Every HEALTH_SNAPSHOT_SECONDS the free heap, its
+// minimum and each task's unused stack are written to RTC memory, which
+// survives that restart, as do breadcrumbs of what the main loop and the
+// fetch task were doing and the last failed allocation.
+//
+// On the next boot all of it is logged with the reset reason and a
+// summary of the core dump (task, PC, backtrace). The full dump can be
+// downloaded from the metrics server at /coredump.
+
+enum HealthMark {
+  HEALTH_LOOP,  // Main loop handler running
+  HEALTH_FETCH, // Fetch task job
+  HEALTH_NUM_MARKS
+};
+
+// First thing at boot: reports how the previous run ended
+void health_begin();
+
+// Puts the calling task under the task watchdog; it must then call
+// health_feed() at least every WATCHDOG_SECONDS
+void health_watch_task();
+void health_feed();
+
+// Records what a task is doing, kept across a crash ("" when done)
+void health_mark(HealthMark which, const char* what, const char* detail = nullptr);
+
+// Event loop handler: heap and stack snapshot into RTC memory
+void health_snapshot();
+
+// For the metrics page
+struct HealthTaskStack {
+  const char* name;
+  int free_bytes; // -1 if the task is not running
+};
+int health_task_stacks(const HealthTaskStack** stacks); // Returns the count
+const char* health_reset_reason();
+uint32_t health_crashes();         // Crash restarts, kept in NVS
+uint32_t health_alloc_failures();  // Since boot
+
+// The core dump in flash, mapped into memory; false if there is none
+bool health_core_dump(const uint8_t** data, size_t* length);
+
+#endif
@@ -0,0 +1,138 @@
+#include "indicators.h"
+#include "../config.h"
+
+// A new session shows as a previous close that moved by more than providers
+// disagree by, or as the day's volume starting again from near zero
+#define SESSION_PREV_CLOSE_CHANGE 0.005f // Relative
+#define SESSION_VOLUME_DROP 0.5f         // Of the volume seen so far
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+struct IndicatorState {
+  float ema_fast;
+  float ema_slow;
+  float avg_gain;      // Wilder averages of up and down moves
+  float avg_loss;
+  float last_price;
+  float day_high;
+  float day_low;
+  float pv_sum;        // Session sum of price * volume
+  float volume_sum;    // Session volume that went into pv_sum
+  float session_prev_close;
+  uint32_t last_volume;
+  uint16_t samples;    // Quotes seen, saturates (only the warm-up needs it)
+};
+
+static IndicatorState state[NUM_STOCKS];
+
+void indicators_init() {
+  memset(state, 0, sizeof(state));
+}
+
+static void start_session(IndicatorState& s, float price, float prev_close) {
+  s.session_prev_close = prev_close;
+  s.day_high = price;
+  s.day_low = price;
+  s.pv_sum = 0;
+  s.volume_sum = 0;
+}
+
+static bool new_session(const IndicatorState& s, float prev_close, uint32_t day_volume) {
+  if (prev_close > 0 && s.session_prev_close > 0 &&
+      fabsf(prev_close - s.session_prev_close) > s.session_prev_close * SESSION_PREV_CLOSE_CHANGE) {
+    return true;
+  }
+  return day_volume > 0 && day_volume < s.last_volume * SESSION_VOLUME_DROP;
+}
+
+void indicators_update(int index, float price, float prev_close, uint32_t day_volume) {
+  IndicatorState& s = state[index];
+
+  if (s.samples == 0) {
+    s.ema_fast = price;
+    s.ema_slow = price;
+    start_session(s, price, prev_close);
+    // Volume traded before the first quote is credited to its price, which
+    // is the best guess available when starting mid-session
+    s.last_volume = 0;
+  } else {
+    s.ema_fast += (price - s.ema_fast) * (2.0f / (EMA_FAST_PERIOD + 1));
+    s.ema_slow += (price - s.ema_slow) * (2.0f / (EMA_SLOW_PERIOD + 1));
+
+    float move = price - s.last_price;
+    float gain = move > 0 ? move : 0;
+    float loss = move < 0 ? -move : 0;
+    if (s.samples <= RSI_PERIOD) {
+      // Plain running mean over the first RSI_PERIOD changes
+      s.avg_gain += (gain - s.avg_gain) / s.samples;
+      s.avg_loss += (loss - s.avg_loss) / s.samples;
+    } else {
+      s.avg_gain = (s.avg_gain * (RSI_PERIOD - 1) + gain) / RSI_PERIOD;
+      s.avg_loss = (s.avg_loss * (RSI_PERIOD - 1) + loss) / RSI_PERIOD;
+    }
+
+    if (new_session(s, prev_close, day_volume)) {
+      start_session(s, price, prev_close);
+      s.last_volume = 0;
+    }
+    if (price > s.day_high) s.day_high = price;
+    if (price < s.day_low) s.day_low = price;
+  }
+
+  if (day_volume > s.last_volume) {
+    float traded = (float)(day_volume - s.last_volume);
+    s.pv_sum += price * traded;
+    s.volume_sum += traded;
+    s.last_volume = day_volume;
+  }
+
+  s.last_price = price;
+  if (s.samples < UINT16_MAX) s.samples++;
+}
+
+bool indicators_get(int index, int indicator, float* value) {
+  const IndicatorState& s = state[index];
+  if (s.samples == 0) return false;
+
+  switch (indicator) {
+    case INDICATOR_EMA_FAST:
+      *value = s.ema_fast;
+      return s.samples >= EMA_FAST_PERIOD;
+    case INDICATOR_EMA_SLOW:
+      *value = s.ema_slow;
+      return s.samples >= EMA_SLOW_PERIOD;
+    case INDICATOR_RSI:
+      if (s.samples <= RSI_PERIOD) return false;
+      if (s.avg_loss == 0) {
+        *value = (s.avg_gain == 0) ? 50 : 100;
+      } else {
+        *value = 100 - 100 / (1 + s.avg_gain / s.avg_loss);
+      }
+      return true;
+    case INDICATOR_VWAP:
+      if (s.volume_sum <= 0) return false;
+      *value = s.pv_sum / s.volume_sum;
+      return true;
+    case INDICATOR_DAY_HIGH:
+      *value = s.day_high;
+      return true;
+    case INDICATOR_DAY_LOW:
+      *value = s.day_low;
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* indicators_label(int indicator) {
+  switch (indicator) {
+    case INDICATOR_EMA_FAST: return "EMA" STR(EMA_FAST_PERIOD);
+    case INDICATOR_EMA_SLOW: return "EMA" STR(EMA_SLOW_PERIOD);
+    case INDICATOR_RSI: return "RSI" STR(RSI_PERIOD);
+    case INDICATOR_VWAP: return "VWAP";
+    case INDICATOR_DAY_HIGH: return "High";
+    case INDICATOR_DAY_LOW: return "Low";
+    default: return "";
+  }
+}
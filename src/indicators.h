@@ -0,0 +1,35 @@
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include <Arduino.h>
+
+// Streaming technical indicators, one fixed-size state block per symbol.
+// Every quote updates them in O(1) from the previous state; no price history
+// is kept. Periods are counted in quotes, so with the default 60 second
+// update interval EMA(9) covers roughly the last 9 minutes.
+//
+// EMA(9) and EMA(21) use the usual 2 / (N + 1) smoothing, seeded with the
+// first price. RSI(14) uses Wilder's smoothing, averaged plainly over the
+// first 14 changes. VWAP weights each quote by the volume traded since the
+// previous one and restarts, along with the day high/low, with each new
+// session: when the previous close moves on, or when the day's volume falls
+// to a fraction of what it was. Small differences between providers, and
+// quotes without a volume, do not count as a new session.
+
+#define EMA_FAST_PERIOD 9
+#define EMA_SLOW_PERIOD 21
+#define RSI_PERIOD 14
+
+void indicators_init();
+
+// Feed a new quote for stocks[index]. day_volume is the session's cumulative
+// volume as reported by the API (0 if unknown, VWAP is then not updated).
+void indicators_update(int index, float price, float prev_close, uint32_t day_volume);
+
+// Current value of one indicator (INDICATOR_* from config.h). Returns false until it has enough data.
+bool indicators_get(int index, int indicator, float* value);
+
+// Short column heading for an indicator, e.g. "EMA9"
+const char* indicators_label(int indicator);
+
+#endif
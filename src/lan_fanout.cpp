@@ -0,0 +1,401 @@
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPmDNS.h>
+#include "lan_fanout.h"
+#include "logging.h"
+#include "../config.h"
+
+#define LAN_MAGIC 0x31515453 // "STQ1"
+#define LAN_VERSION 1
+#define LAN_SERVICE "stocktracker"
+
+// Entries per packet, keeps a full frame inside one Ethernet MTU
+#define LAN_MAX_ENTRIES 48
+
+// A candidate becomes leader after this long without hearing a better one
+#define LAN_ELECTION_MS (2 * LAN_HEARTBEAT_MS)
+// A follower's watchlist is dropped after this many missed heartbeats
+#define LAN_SUBSCRIPTION_TIMEOUT_MS (4 * LAN_HEARTBEAT_MS)
+
+// Room for every symbol of a full watchlist plus the extras the leader
+// fetches for others
+#define LAN_MAX_SUBSCRIPTIONS (NUM_STOCKS + LAN_FANOUT_MAX_EXTRA)
+#define LAN_INBOX_SIZE (2 * LAN_MAX_ENTRIES) // Packets wait in the socket until a whole frame fits
+#define LAN_PACKETS_PER_TICK 4
+
+enum LanFrameType {
+  FRAME_HEARTBEAT = 1, // Entries: the sender's watchlist symbols
+  FRAME_QUOTES = 2     // Entries: LanQuote
+};
+
+// Both ends are ESP32s, so fields are sent in native (little-endian) order
+struct __attribute__((packed)) LanHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t type;   // LanFrameType
+  uint8_t role;   // Sender's LanRole
+  uint8_t count;  // Entries after the header
+  uint32_t sender;
+  uint32_t seq;
+};
+
+static_assert(sizeof(LanQuote) == LAN_SYMBOL_LEN + 12, "LanQuote must not be padded");
+
+#define LAN_MAX_PACKET (sizeof(LanHeader) + LAN_MAX_ENTRIES * sizeof(LanQuote))
+
+struct Subscription {
+  char symbol[LAN_SYMBOL_LEN];
+  unsigned long last_seen; // 0 = free slot
+};
+
+static WiFiUDP udp;
+static uint32_t device_id = 0;
+static uint32_t seq = 0;
+
+static LanRole role = LAN_OFF;
+static unsigned long role_since = 0;
+static unsigned long last_heartbeat = 0;
+static uint32_t leader_id = 0;       // Follower: who we listen to
+static unsigned long leader_heard = 0;
+static bool fetch_needed = false;
+
+static Subscription subscriptions[LAN_MAX_SUBSCRIPTIONS];
+static bool subscriptions_full = false; // Warned about it already
+
+// Follower: when the leader last listed each of our symbols as fetched, 0 = never
+static unsigned long covered_at[NUM_STOCKS];
+
+static LanQuote inbox[LAN_INBOX_SIZE];
+static int inbox_head = 0;
+static int inbox_count = 0;
+
+static uint8_t packet[LAN_MAX_PACKET];
+static LanQuote outgoing[LAN_MAX_ENTRIES];
+static int outgoing_count = 0;
+
+static IPAddress group_address() {
+  return IPAddress(LAN_GROUP);
+}
+
+static void copy_symbol(char* dest, const char* src) {
+  strncpy(dest, src, LAN_SYMBOL_LEN - 1);
+  dest[LAN_SYMBOL_LEN - 1] = '\0';
+}
+
+static int own_index(const char* symbol) {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (strncmp(STOCK_SYMBOLS[i], symbol, LAN_SYMBOL_LEN) == 0) return i;
+  }
+  return -1;
+}
+
+// ---- Sending ---------------------------------------------------------------
+
+static void send_frame(LanFrameType type, const void* entries, int count, size_t entry_size) {
+  LanHeader header = {LAN_MAGIC, LAN_VERSION, (uint8_t)type, (uint8_t)role, (uint8_t)count, device_id, ++seq};
+  memcpy(packet, &header, sizeof(header));
+  memcpy(packet + sizeof(header), entries, count * entry_size);
+
+  udp.beginPacket(group_address(), LAN_PORT);
+  udp.write(packet, sizeof(header) + count * entry_size);
+  udp.endPacket();
+}
+
+// The watchlist, and for the leader also the extras it fetches for others,
+// so followers know what they still have to fetch themselves. Long lists
+// go out in several frames.
+static void send_heartbeat() {
+  static char symbols[NUM_STOCKS + LAN_FANOUT_MAX_EXTRA][LAN_SYMBOL_LEN];
+  int count = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    copy_symbol(symbols[count++], STOCK_SYMBOLS[i]);
+  }
+  count += lan_extra_symbols(symbols + count, LAN_FANOUT_MAX_EXTRA);
+
+  for (int start = 0; start < count; start += LAN_MAX_ENTRIES) {
+    int n = count - start < LAN_MAX_ENTRIES ? count - start : LAN_MAX_ENTRIES;
+    send_frame(FRAME_HEARTBEAT, symbols[start], n, LAN_SYMBOL_LEN);
+  }
+  last_heartbeat = millis();
+}
+
+// ---- Roles -----------------------------------------------------------------
+
+static void become(LanRole next) {
+  if (next == role) return;
+  LOGI("LAN: %s -> %s", lan_role_name(role), lan_role_name(next));
+
+  if (role == LAN_FOLLOWER) fetch_needed = true;
+  if (next == LAN_FOLLOWER) memset(covered_at, 0, sizeof(covered_at));
+  role = next;
+  role_since = millis();
+  outgoing_count = 0;
+  MDNS.addServiceTxt(LAN_SERVICE, "udp", "role", lan_role_name(role));
+
+  // Let the others know straight away rather than at the next heartbeat
+  send_heartbeat();
+}
+
+// A leader's heartbeat or quotes arrived
+static void leader_seen(uint32_t sender) {
+  if (role == LAN_LEADER) {
+    if (sender > device_id) return; // It steps down when it hears us
+    LOGI("LAN: %08x has the lower id, stepping down", (unsigned)sender);
+  }
+
+  if (role != LAN_FOLLOWER || leader_id == 0 || sender <= leader_id) {
+    leader_id = sender;
+  }
+  if (sender == leader_id) leader_heard = millis();
+  become(LAN_FOLLOWER);
+}
+
+static void subscribe(const char* symbol) {
+  unsigned long now = millis();
+  Subscription* free_slot = nullptr;
+  for (int s = 0; s < LAN_MAX_SUBSCRIPTIONS; s++) {
+    Subscription& sub = subscriptions[s];
+    if (sub.last_seen && strncmp(sub.symbol, symbol, LAN_SYMBOL_LEN) == 0) {
+      sub.last_seen = now;
+      return;
+    }
+    if (!sub.last_seen && !free_slot) free_slot = &sub;
+  }
+  if (!free_slot) {
+    if (!subscriptions_full) {
+      LOGW("WARNING: LAN: more than %d shared symbols, %s is left to its tracker",
+           LAN_MAX_SUBSCRIPTIONS, symbol);
+      subscriptions_full = true;
+    }
+    return; // The follower fetches it itself, it is not in our heartbeat
+  }
+
+  copy_symbol(free_slot->symbol, symbol);
+  free_slot->last_seen = now;
+}
+
+static void expire_subscriptions() {
+  unsigned long now = millis();
+  for (int s = 0; s < LAN_MAX_SUBSCRIPTIONS; s++) {
+    if (subscriptions[s].last_seen && now - subscriptions[s].last_seen > LAN_SUBSCRIPTION_TIMEOUT_MS) {
+      subscriptions[s].last_seen = 0;
+      subscriptions_full = false;
+    }
+  }
+}
+
+// ---- Receiving -------------------------------------------------------------
+
+static void on_heartbeat(const LanHeader& h, const uint8_t* entries) {
+  if (h.role == LAN_LEADER) {
+    leader_seen(h.sender);
+    if (role != LAN_FOLLOWER || h.sender != leader_id) return;
+
+    // Note which of our symbols the leader fetches
+    char symbol[LAN_SYMBOL_LEN];
+    for (int n = 0; n < h.count; n++) {
+      copy_symbol(symbol, (const char*)entries + n * LAN_SYMBOL_LEN);
+      int i = own_index(symbol);
+      if (i >= 0) covered_at[i] = millis();
+    }
+    return;
+  }
+
+  // Defer to a better candidate, it becomes leader first
+  if (h.role == LAN_CANDIDATE && role == LAN_CANDIDATE && h.sender < device_id) {
+    role_since = millis();
+  }
+
+  // Fetch whatever the followers show
+  if (h.role == LAN_FOLLOWER && role == LAN_LEADER) {
+    char symbol[LAN_SYMBOL_LEN];
+    for (int n = 0; n < h.count; n++) {
+      copy_symbol(symbol, (const char*)entries + n * LAN_SYMBOL_LEN);
+      subscribe(symbol);
+    }
+  }
+}
+
+static void on_quotes(const LanHeader& h, const uint8_t* entries) {
+  if (h.role != LAN_LEADER) return;
+  leader_seen(h.sender);
+  if (role != LAN_FOLLOWER || h.sender != leader_id) return;
+
+  for (int n = 0; n < h.count && inbox_count < LAN_INBOX_SIZE; n++) {
+    LanQuote& q = inbox[(inbox_head + inbox_count++) % LAN_INBOX_SIZE];
+    memcpy(&q, entries + n * sizeof(LanQuote), sizeof(LanQuote));
+    q.symbol[LAN_SYMBOL_LEN - 1] = '\0';
+  }
+}
+
+static void receive() {
+  for (int p = 0; p < LAN_PACKETS_PER_TICK; p++) {
+    if (LAN_INBOX_SIZE - inbox_count < LAN_MAX_ENTRIES) return; // Read the rest once drained
+
+    int size = udp.parsePacket();
+    if (size <= 0) return;
+
+    int len = udp.read(packet, sizeof(packet));
+    if (len < (int)sizeof(LanHeader)) continue;
+
+    LanHeader h;
+    memcpy(&h, packet, sizeof(h));
+    if (h.magic != LAN_MAGIC || h.version != LAN_VERSION || h.sender == device_id) continue;
+
+    const uint8_t* entries = packet + sizeof(h);
+    size_t payload = len - sizeof(h);
+    if (h.type == FRAME_HEARTBEAT && payload >= h.count * (size_t)LAN_SYMBOL_LEN) {
+      on_heartbeat(h, entries);
+    } else if (h.type == FRAME_QUOTES && payload >= h.count * sizeof(LanQuote)) {
+      on_quotes(h, entries);
+    }
+  }
+}
+
+// ---- Public ----------------------------------------------------------------
+
+void lan_begin() {
+  // The NIC-specific half of the MAC, unique on the LAN
+  device_id = (uint32_t)(ESP.getEfuseMac() >> 16);
+
+  char hostname[32];
+  snprintf(hostname, sizeof(hostname), "stocktracker-%08x", (unsigned)device_id);
+  char id[12];
+  snprintf(id, sizeof(id), "%08x", (unsigned)device_id);
+
+  udp.beginMulticast(group_address(), LAN_PORT);
+
+  role = LAN_CANDIDATE;
+  role_since = millis();
+  if (MDNS.begin(hostname)) {
+    MDNS.addService(LAN_SERVICE, "udp", LAN_PORT);
+    MDNS.addServiceTxt(LAN_SERVICE, "udp", "id", id);
+    MDNS.addServiceTxt(LAN_SERVICE, "udp", "role", lan_role_name(role));
+
+    // Join a running leader straight away instead of waiting out an election
+    int found = MDNS.queryService(LAN_SERVICE, "udp");
+    for (int i = 0; i < found; i++) {
+      if (MDNS.txt(i, "role") == "leader") {
+        leader_id = strtoul(MDNS.txt(i, "id").c_str(), nullptr, 16);
+        leader_heard = millis();
+        become(LAN_FOLLOWER);
+        break;
+      }
+    }
+  } else {
+    LOGW("LAN: mDNS failed to start, electing over multicast only");
+  }
+
+  LOGI("LAN fan-out as %s, id %s, %s", hostname, id, lan_role_name(role));
+  send_heartbeat();
+}
+
+void lan_restart() {
+  if (role == LAN_OFF) return;
+  udp.stop();
+  udp.beginMulticast(group_address(), LAN_PORT);
+}
+
+LanEvent lan_tick() {
+  if (role == LAN_OFF) return LAN_EVENT_NONE;
+
+  receive();
+
+  unsigned long now = millis();
+  if (role == LAN_FOLLOWER && now - leader_heard > LAN_LEADER_TIMEOUT_MS) {
+    LOGW("LAN: leader %08x gone, fetching directly", (unsigned)leader_id);
+    leader_id = 0;
+    become(LAN_CANDIDATE);
+  } else if (role == LAN_CANDIDATE && now - role_since > LAN_ELECTION_MS) {
+    become(LAN_LEADER);
+  }
+
+  if (now - last_heartbeat >= LAN_HEARTBEAT_MS) {
+    send_heartbeat();
+  }
+  expire_subscriptions();
+
+  if (fetch_needed) {
+    fetch_needed = false;
+    return LAN_EVENT_FETCH_NEEDED;
+  }
+  return LAN_EVENT_NONE;
+}
+
+LanRole lan_role() {
+  return role;
+}
+
+const char* lan_role_name(LanRole r) {
+  switch (r) {
+    case LAN_CANDIDATE: return "candidate";
+    case LAN_LEADER: return "leader";
+    case LAN_FOLLOWER: return "follower";
+    default: return "off";
+  }
+}
+
+bool lan_poll_quote(LanQuote* quote) {
+  if (inbox_count == 0) return false;
+  *quote = inbox[inbox_head];
+  inbox_head = (inbox_head + 1) % LAN_INBOX_SIZE;
+  inbox_count--;
+  return true;
+}
+
+bool lan_covers(int index) {
+  return role == LAN_FOLLOWER && covered_at[index] != 0 &&
+         millis() - covered_at[index] <= LAN_LEADER_TIMEOUT_MS;
+}
+
+int lan_extra_symbols(char (*symbols)[LAN_SYMBOL_LEN], int max_count) {
+  if (role != LAN_LEADER) return 0;
+
+  // The first max_count in table order, so the heartbeat lists the same ones
+  // the fetch cycle takes; the rest are fetched by their own trackers
+  static bool capped = false; // Warned about it already
+  int count = 0, wanted = 0;
+  for (int s = 0; s < LAN_MAX_SUBSCRIPTIONS; s++) {
+    if (subscriptions[s].last_seen && own_index(subscriptions[s].symbol) < 0) {
+      if (count < max_count) copy_symbol(symbols[count++], subscriptions[s].symbol);
+      wanted++;
+    }
+  }
+  if (wanted > count && !capped) {
+    LOGW("WARNING: LAN: other trackers want %d extra symbols, fetching %d (LAN_FANOUT_MAX_EXTRA)",
+         wanted, count);
+  }
+  capped = wanted > count;
+  return count;
+}
+
+bool lan_is_shared(int index) {
+  if (role != LAN_LEADER) return false;
+
+  for (int s = 0; s < LAN_MAX_SUBSCRIPTIONS; s++) {
+    if (subscriptions[s].last_seen &&
+        strncmp(subscriptions[s].symbol, STOCK_SYMBOLS[index], LAN_SYMBOL_LEN) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void lan_publish(const char* symbol, const YahooQuote& quote) {
+  if (role != LAN_LEADER) return;
+
+  LanQuote& q = outgoing[outgoing_count++];
+  memset(&q, 0, sizeof(q));
+  copy_symbol(q.symbol, symbol);
+  q.price = quote.price;
+  q.prev_close = quote.prev_close;
+  q.volume = quote.volume;
+
+  if (outgoing_count == LAN_MAX_ENTRIES) lan_flush();
+}
+
+void lan_flush() {
+  if (role != LAN_LEADER || outgoing_count == 0) return;
+  send_frame(FRAME_QUOTES, outgoing, outgoing_count, sizeof(LanQuote));
+  outgoing_count = 0;
+}
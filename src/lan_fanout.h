@@ -0,0 +1,72 @@
+#ifndef LAN_FANOUT_H
+#define LAN_FANOUT_H
+
+#include <Arduino.h>
+#include "yahoo_api.h"
+
+// LAN fan-out. With several trackers on one network only one of them, the
+// leader, talks to Yahoo: it fetches the union of everyone's watchlists and
+// multicasts the quotes. The others (followers) display what they receive.
+//
+// Every tracker multicasts a heartbeat with its role and watchlist; the
+// leader's also lists the extra symbols it fetches for others. At boot an
+// mDNS query looks for a running leader; after that the role is decided
+// from heartbeats, the lowest device id winning. A follower fetches the
+// symbols the leader does not list itself. A follower that stops hearing
+// its leader goes back to fetching directly and stands for election itself.
+
+#define LAN_SYMBOL_LEN 12 // Longest symbol that can be shared, plus the terminator
+
+enum LanRole {
+  LAN_OFF,       // Fan-out disabled or not started
+  LAN_CANDIDATE, // Fetching directly, waiting to see if anyone else leads
+  LAN_LEADER,    // Fetching for everyone
+  LAN_FOLLOWER   // Showing the leader's quotes, not fetching
+};
+
+enum LanEvent {
+  LAN_EVENT_NONE,
+  LAN_EVENT_FETCH_NEEDED // No longer a follower, fetch directly straight away
+};
+
+struct LanQuote {
+  char symbol[LAN_SYMBOL_LEN];
+  float price;
+  float prev_close;
+  uint32_t volume;
+};
+
+// Start advertising and listening. Blocks briefly for the mDNS query, so it
+// runs from setup() once WiFi is up.
+void lan_begin();
+
+// Rejoin the multicast group after WiFi came back
+void lan_restart();
+
+// Send heartbeats, read packets, run the election. Call from the main loop.
+LanEvent lan_tick();
+
+LanRole lan_role();
+const char* lan_role_name(LanRole role);
+
+// Follower: take the next quote received from the leader
+bool lan_poll_quote(LanQuote* quote);
+
+// Follower: true if the leader fetches STOCK_SYMBOLS[index], so this
+// tracker does not have to
+bool lan_covers(int index);
+
+// Leader: symbols other trackers want that are not on this watchlist.
+// Returns the count written (at most max_count); the same ones every call
+// until a subscription is added or expires.
+int lan_extra_symbols(char (*symbols)[LAN_SYMBOL_LEN], int max_count);
+
+// Leader: true if another tracker also shows STOCK_SYMBOLS[index], so it is
+// fetched every cycle even while off screen
+bool lan_is_shared(int index);
+
+// Leader: queue a quote for the next frame, and send the frame
+void lan_publish(const char* symbol, const YahooQuote& quote);
+void lan_flush();
+
+#endif
@@ -0,0 +1,123 @@
+#include "logging.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <atomic>
+#include <stdarg.h>
+
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define LOG_TASK_CORE 0              // Away from the main loop
+#define SYSLOG_FACILITY 16           // local0
+#define SYSLOG_TAG "stock_tracker"
+
+// One line. A producer claims the slot by advancing head, fills it and then
+// publishes it by setting sequence to its position + 1; the writer takes
+// slots strictly in order and frees each by advancing tail.
+struct LogSlot {
+  std::atomic<uint32_t> sequence;
+  uint8_t level;
+  uint8_t length;
+  char text[LOG_LINE_MAX];
+};
+
+static LogSlot slots[LOG_BUFFER_LINES];
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> tail(0);
+static std::atomic<uint32_t> dropped(0);
+static TaskHandle_t writer = nullptr;
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+static const int SYSLOG_SEVERITY[] = {0, 3, 4, 6, 7}; // By level: err, warning, info, debug
+static WiFiUDP syslog;
+#endif
+
+void log_write(uint8_t level, const char* format, ...) {
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  do {
+    // tail only grows, so a stale value can only make the ring look fuller
+    if (pos - tail.load(std::memory_order_acquire) >= LOG_BUFFER_LINES) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!head.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  LogSlot& slot = slots[pos % LOG_BUFFER_LINES];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(slot.text, sizeof(slot.text), format, args);
+  va_end(args);
+  if (n < 0) n = 0;
+  if (n >= (int)sizeof(slot.text)) n = sizeof(slot.text) - 1;
+  while (n > 0 && slot.text[n - 1] == '\n') n--; // The writer ends every line
+  slot.length = n;
+  slot.level = level;
+  slot.sequence.store(pos + 1, std::memory_order_release);
+
+  if (writer) xTaskNotifyGive(writer);
+}
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+static void send_syslog(uint8_t level, const char* text, size_t length) {
+  if (!LOG_SYSLOG_HOST[0] || WiFi.status() != WL_CONNECTED) return;
+  syslog.beginPacket(LOG_SYSLOG_HOST, LOG_SYSLOG_PORT);
+  syslog.printf("<%d>" SYSLOG_TAG ": ", SYSLOG_FACILITY * 8 + SYSLOG_SEVERITY[level]);
+  syslog.write((const uint8_t*)text, length);
+  syslog.endPacket();
+}
+
+static void write_line(uint8_t level, const char* text, size_t length) {
+  Serial.write((const uint8_t*)text, length);
+  Serial.write('\n');
+  send_syslog(level, text, length);
+}
+
+static void writer_task(void*) {
+  uint32_t reported_dropped = 0;
+  char text[LOG_LINE_MAX];
+  for (;;) {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    LogSlot& slot = slots[pos % LOG_BUFFER_LINES];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+      // Empty, or the next line is still being written; wait for a notify
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+      continue;
+    }
+    uint8_t level = slot.level;
+    size_t length = slot.length;
+    memcpy(text, slot.text, length);
+    tail.store(pos + 1, std::memory_order_release);
+
+    write_line(level, text, length);
+
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reported_dropped) {
+      int n = snprintf(text, sizeof(text), "WARNING: %u log lines dropped, the log ring was full",
+                       (unsigned)(lost - reported_dropped));
+      write_line(LOG_LEVEL_WARN, text, n);
+      reported_dropped = lost;
+    }
+  }
+}
+#endif
+
+void log_begin() {
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  if (writer) return;
+  xTaskCreatePinnedToCore(writer_task, "log", LOG_TASK_STACK, nullptr,
+                          LOG_TASK_PRIORITY, &writer, LOG_TASK_CORE);
+#endif
+}
+
+void log_flush(uint32_t timeout_ms) {
+  if (!writer) return;
+  unsigned long start = millis();
+  while (tail.load(std::memory_order_acquire) != head.load(std::memory_order_acquire) &&
+         millis() - start < timeout_ms) {
+    delay(1);
+  }
+  Serial.flush();
+}
+
+uint32_t log_dropped() {
+  return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,43 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Leveled logging that never waits for the UART. At 115200 baud a line
+// takes about 5 ms to send, so writing from the main loop or the fetch
+// task held them up for as long as the log was long.
+//
+// LOGE/LOGW/LOGI/LOGD take printf arguments, one line per call. Calls
+// below LOG_LEVEL compile to nothing, format string included. The rest
+// are formatted into a fixed ring of lines without taking a lock and
+// written out by a low-priority task, to Serial and, with
+// LOG_SYSLOG_HOST set, as UDP syslog. When the ring is full, new lines
+// are dropped and counted rather than waited for.
+//
+// Lines still in the ring are lost on a crash; call log_flush() before a
+// deliberate restart.
+
+#define LOG_AT(level, ...)                                   \
+  do {                                                       \
+    if (LOG_LEVEL >= (level)) log_write((level), __VA_ARGS__); \
+  } while (0)
+
+#define LOGE(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOGW(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGI(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGD(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// Starts the writer task. Lines logged before this wait in the ring.
+void log_begin();
+
+// Use the macros above; safe from any task, not from interrupts
+void log_write(uint8_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Waits until everything logged so far is written out, at most timeout_ms
+void log_flush(uint32_t timeout_ms);
+
+// Lines dropped because the ring was full, since boot
+uint32_t log_dropped();
+
+#endif
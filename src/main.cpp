@@ -8,119 +8,303 @@
 #include <nvs_flash.h>
 #include <esp_wifi.h>
 #include "../config.h"
+#include "spi_calibration.h"
+#include "quote_store.h"
+#include "quote_snapshot.h"
+#include "watchlist.h"
+#include "ticker_tape.h"
+#include "yahoo_api.h"
+#include "touch.h"
+#include "detail_view.h"
+#include "sparkline.h"
+#include "indicators.h"
+#include "wifi_fast.h"
+#include "boot_timing.h"
+#include "connectivity.h"
+#include "status_text.h"
+#include "event_loop.h"
+#include "fetch_task.h"
+#include "power.h"
+#include "backlight.h"
+#include "metrics.h"
+#include "lan_fanout.h"
+#include "quote_push.h"
+#include "mqtt_quotes.h"
+#include "yahoo_stream.h"
+#include "quote_provider.h"
+#include "ota_update.h"
+#include "logging.h"
+#include "health.h"
 
-#define LCD_BACKLIGHT_PIN 21
 #define SCREEN_WIDTH 240
 #define SCREEN_HEIGHT 320
 
 #define UPDATE_INTERVAL (UPDATE_INTERVAL_SECONDS * 1000UL)
 
+// Data area below the table header, sized to the visible rows
+#define DATA_AREA_Y 55
+#define DATA_AREA_HEIGHT (WATCHLIST_VISIBLE_ROWS * WATCHLIST_ROW_HEIGHT + 5)
 
-// Stock data structure
-struct StockData {
-  String symbol;
-  String name;
-  float price;
-  float change;
-  float change_percent;
-  bool valid;
-  bool changed; // Track if data changed
-};
+// Sparkline column at the right edge of each row
+#define SPARKLINE_X (230 - SPARKLINE_WIDTH)
+
+// Table columns. The indicator column squeezes the others to the left.
+#if INDICATOR_COLUMN != INDICATOR_NONE
+#define PRICE_COLUMN_X 46
+#define CHANGE_COLUMN_X 102
+#define INDICATOR_COLUMN_X 148
+#else
+#define PRICE_COLUMN_X 80
+#define CHANGE_COLUMN_X 150
+#endif
 
 // Global variables
 TFT_eSPI tft = TFT_eSPI();
-static StockData stocks[NUM_STOCKS];
 static time_t last_update_time = 0;
+static bool shown_from_snapshot = false; // Table drawn from cached quotes at boot
+
+// Fetch cycle state (quotes are fetched on the fetch task)
+static int fetch_timer = -1;
+static int cycle_pending = 0;       // Quote jobs of this cycle not back yet
+static bool cycle_changed = false;  // A visible row changed this cycle
+static bool catch_up_pending = false; // Start another cycle when this one ends
+static bool page_cycle = false;     // The running cycle only fetches a page that scrolled in
+static int backlight_ramp_timer = -1;
 
 // Function declarations
 void create_ui();
-void fetch_stock_data();
+void start_fetch_cycle();
+void begin_cycle();
+bool polling_paused();
+int drop_fetched_elsewhere(int* order, int count);
+void fetch_visible_page();
+void handle_fetch_results();
+void apply_quote(int i, const YahooQuote& q);
+void finish_fetch_cycle();
+void check_connectivity();
+void expire_quotes();
+void handle_lan();
+void handle_push();
+void handle_mqtt();
+void handle_stream();
+void resume_polling_if_lost(bool live, bool* was_live);
+void apply_arrivals(bool (*poll)(int*, YahooQuote*));
+void tick_ticker();
+void tick_auto_scroll();
 void update_display();
 void update_single_stock(int stock_index);
 void show_initial_structure();
+void draw_row(int i, int y);
+void draw_row_text(int i, int y);
+void draw_indicator(int i, int y);
+void refresh_visible_rows();
+void draw_status();
+void handle_touch();
+void update_power();
+void sample_backlight();
+void ramp_backlight();
+void show_main_screen();
+void show_wifi_setup();
+void connect_with_wifimanager();
 
 void setup() {
   Serial.begin(115200);
   delay(100);
+  log_begin();
+  // How the last run ended, before anything can crash this one
+  health_begin();
+  
+  LOGI("=== STOCK TRACKER WITH WIFIMANAGER v2.0 ===");
+  LOGI("This version uses WiFiManager for WiFi setup");
   
-  Serial.println("=== STOCK TRACKER WITH WIFIMANAGER v2.0 ===");
-  Serial.println("This version uses WiFiManager for WiFi setup");
+#if OTA_ENABLED
+  // Rolls back straight away if an update keeps failing to start
+  ota_begin();
+#endif
   
   // Initialize display
   tft.init();
   tft.setRotation(0);
   tft.fillScreen(TFT_BLACK);
-  pinMode(LCD_BACKLIGHT_PIN, OUTPUT);
-  analogWrite(LCD_BACKLIGHT_PIN, LCD_BRIGHTNESS);
+  backlight_begin();
   
+  // Pick the fastest stable SPI clock (saved in NVS after the first boot)
+  spi_calibration_begin(tft);
+  boot_mark("display ready");
   
   // Initialize stock data
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    stocks[i].symbol = STOCK_SYMBOLS[i];
-    stocks[i].name = STOCK_NAMES[i];
-    stocks[i].price = 0.0;
-    stocks[i].change = 0.0;
-    stocks[i].change_percent = 0.0;
-    stocks[i].valid = false;
-    stocks[i].changed = false;
+  quote_store_init();
+  
+#if TOUCH_ENABLED
+  touch_begin();
+#endif
+  
+  // Draw the last-known quotes straight away, WiFi and the first fetch
+  // take a while
+  shown_from_snapshot = quote_snapshot_restore() > 0;
+  if (shown_from_snapshot) {
+    show_main_screen();
+    boot_mark("cached quotes shown");
+  }
+  
+  // Try the cached access point first, WiFiManager only if that fails
+  boot_mark("wifi start");
+  if (wifi_fast_connect()) {
+    LOGI("=== WIFI FAST CONNECT SUCCESS ===");
+    LOGI("IP address: %s", WiFi.localIP().toString().c_str());
+  } else {
+    connect_with_wifimanager();
+  }
+  wifi_fast_remember();
+  boot_mark("wifi connected");
+  
+  // From here on dropouts are handled in the background
+  connectivity_begin();
+  
+#if METRICS_ENABLED
+  metrics_begin();
+#endif
+#if LAN_FANOUT
+  lan_begin();
+#endif
+  
+  // Configure time  
+  configTime(TIMEZONE_OFFSET * 3600, 0, "pool.ntp.org", "time.nist.gov");
+  LOGI("Time configured (UTC%d)", TIMEZONE_OFFSET);
+  
+  // Ready to start
+  
+  if (!shown_from_snapshot) {
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+    ticker_create_ui(tft);
+#else
+    create_ui();
+    
+    // Show initial structure with all symbols
+    show_initial_structure();
+#endif
   }
   
+  // Network requests run on their own task from here on
+  fetch_task_begin();
+#if AGGREGATOR_PUSH
+  quote_push_begin();
+#endif
+#if QUOTE_SOURCE == QUOTE_SOURCE_STREAM
+  yahoo_stream_begin();
+#endif
+  
+#if POWER_SAVING
+  power_begin();
+#endif
+  
+  // Everything else runs from short handlers on the event loop
+#if TOUCH_ENABLED
+  timer_add("touch", 0, handle_touch);
+#endif
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  timer_add("ticker", 0, tick_ticker);
+#else
+  timer_add("scroll", 250, tick_auto_scroll);
+#endif
+  timer_add("results", 0, handle_fetch_results);
+  timer_add("connectivity", 100, check_connectivity);
+  timer_add("quote_age", 30000, expire_quotes);
+  timer_add("detail", 250, detail_service);
+#if QUOTE_SOURCE == QUOTE_SOURCE_MQTT
+  // Quotes arrive as they are published, there is no fetch cycle
+  mqtt_quotes_begin();
+  timer_add("mqtt", 50, handle_mqtt);
+#else
+  fetch_timer = timer_add("fetch", UPDATE_INTERVAL, start_fetch_cycle);
+#endif
+  timer_add("backlight", BACKLIGHT_SAMPLE_MS, sample_backlight);
+  backlight_ramp_timer = timer_add("fade", BACKLIGHT_RAMP_STEP_MS, ramp_backlight);
+  timer_stop(backlight_ramp_timer);
+#if METRICS_ENABLED
+  timer_add("metrics", 10, metrics_service);
+#endif
+#if LAN_FANOUT
+  timer_add("lan", 50, handle_lan);
+#endif
+#if AGGREGATOR_PUSH
+  timer_add("push", 50, handle_push);
+#endif
+#if QUOTE_SOURCE == QUOTE_SOURCE_STREAM
+  timer_add("stream", 50, handle_stream);
+#endif
+#if OTA_ENABLED
+  timer_add("ota", 10000, ota_service);
+#endif
+  health_snapshot();
+  timer_add("health", HEALTH_SNAPSHOT_SECONDS * 1000, health_snapshot);
+  
+  // First fetch straight away
+  timer_start(fetch_timer, 0);
+  
+  // Not earlier: the WiFi portal above may wait for minutes
+  health_watch_task();
+}
+
+// Slow path: saved credentials with a full scan and DHCP, or the setup
+// portal if that fails. Restarts if the portal times out.
+void connect_with_wifimanager() {
   // Setup WiFiManager
   WiFiManager wm;
   
-  Serial.println("=== WIFI MANAGER DEBUG ===");
-  Serial.println("Initializing WiFiManager...");
+  LOGI("=== WIFI MANAGER DEBUG ===");
+  LOGI("Initializing WiFiManager...");
   
   // Check if we have saved WiFi credentials
   wifi_config_t conf;
   esp_wifi_get_config(WIFI_IF_STA, &conf);
-  Serial.printf("Saved SSID: '%s'\n", conf.sta.ssid);
-  Serial.printf("Saved SSID length: %d\n", strlen((char*)conf.sta.ssid));
+  LOGI("Saved SSID: '%s'", conf.sta.ssid);
+  LOGI("Saved SSID length: %d", (int)strlen((char*)conf.sta.ssid));
   
   if (strlen((char*)conf.sta.ssid) > 0) {
-    Serial.println("Found saved WiFi credentials!");
+    LOGI("Found saved WiFi credentials!");
   } else {
-    Serial.println("No saved WiFi credentials found");
+    LOGI("No saved WiFi credentials found");
   }
   
   // Configure WiFiManager to preserve settings
   wm.setDebugOutput(true);
   wm.setConfigPortalTimeout(120); // 2 minute timeout for config portal
   wm.setConnectTimeout(30); // 30 second timeout for connection attempts
+#if WIFI_STATIC_IP
+  wm.setSTAStaticIPConfig(IPAddress(WIFI_STATIC_ADDRESS), IPAddress(WIFI_STATIC_GATEWAY),
+                          IPAddress(WIFI_STATIC_SUBNET), IPAddress(WIFI_STATIC_DNS));
+#endif
   wm.setSaveParamsCallback([](){
-    Serial.println("=== WIFI PARAMS SAVED CALLBACK ===");
+    LOGI("=== WIFI PARAMS SAVED CALLBACK ===");
   });
   wm.setSaveConfigCallback([](){
-    Serial.println("=== WIFI CONFIG SAVED CALLBACK ===");
+    LOGI("=== WIFI CONFIG SAVED CALLBACK ===");
+  });
+  // The cached table stays up unless the setup portal is actually needed
+  wm.setAPCallback([](WiFiManager*){
+    LOGI("=== WIFI CONFIG PORTAL STARTED ===");
+    if (shown_from_snapshot) {
+      shown_from_snapshot = false;
+      show_wifi_setup();
+    }
   });
   
   // Try to connect to saved WiFi first
-  Serial.println("Attempting WiFi connection with autoConnect...");
-  
-  tft.setCursor(10, 10);
-  tft.setTextColor(TFT_WHITE);
-  tft.setTextSize(2);
-  tft.print("WiFi Setup...");
+  LOGI("Attempting WiFi connection with autoConnect...");
   
-  // Show setup message on display
-  tft.setCursor(10, 40);
-  tft.setTextSize(1);
-  tft.print("1. Connect to WiFi:");
-  tft.setCursor(10, 55);
-  tft.print("   Stock_Tracker_Setup");
-  tft.setCursor(10, 75);
-  tft.print("2. Enter WiFi credentials");
-  tft.setCursor(10, 90);
-  tft.print("3. Wait for connection...");
+  if (!shown_from_snapshot) {
+    show_wifi_setup();
+  }
   
   // Try autoConnect first - only show portal if no saved WiFi
-  Serial.println("Attempting WiFi connection...");
+  LOGI("Attempting WiFi connection...");
   
   bool wifi_result = wm.autoConnect("Stock_Tracker_Setup");
   
   if (!wifi_result) {
-    Serial.println("=== WIFI CONNECTION FAILED ===");
-    Serial.println("Failed to connect and hit timeout");
+    LOGE("=== WIFI CONNECTION FAILED ===");
+    LOGE("Failed to connect and hit timeout");
     tft.fillScreen(TFT_RED);
     tft.setCursor(10, 10);
     tft.setTextColor(TFT_WHITE);
@@ -132,60 +316,242 @@ void setup() {
   }
   
   // Connected! Check credentials again
-  Serial.println("=== WIFI CONNECTION SUCCESS ===");
-  Serial.println("WiFi Connected!");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("SSID: ");
-  Serial.println(WiFi.SSID());
-  Serial.print("RSSI: ");
-  Serial.println(WiFi.RSSI());
+  LOGI("=== WIFI CONNECTION SUCCESS ===");
+  LOGI("WiFi Connected!");
+  LOGI("IP address: %s", WiFi.localIP().toString().c_str());
+  LOGI("SSID: %s", WiFi.SSID().c_str());
+  LOGI("RSSI: %d", WiFi.RSSI());
   
   // Check if credentials are now saved
   wifi_config_t conf_after;
   esp_wifi_get_config(WIFI_IF_STA, &conf_after);
-  Serial.printf("After connection - Saved SSID: '%s'\n", conf_after.sta.ssid);
-  Serial.printf("After connection - Saved SSID length: %d\n", strlen((char*)conf_after.sta.ssid));
+  LOGI("After connection - Saved SSID: '%s'", conf_after.sta.ssid);
+  LOGI("After connection - Saved SSID length: %d", (int)strlen((char*)conf_after.sta.ssid));
   
   // Stop WiFiManager AP mode (turn off hotspot)
-  Serial.println("Stopping WiFiManager portal and AP...");
+  LOGI("Stopping WiFiManager portal and AP...");
   wm.stopWebPortal();
   WiFi.softAPdisconnect(true);
-  Serial.println("AP disconnected");
-  
-  tft.fillScreen(TFT_BLACK);
-  tft.setCursor(10, 10);
-  tft.setTextColor(TFT_GREEN);
-  tft.setTextSize(2);
-  tft.print("WiFi Connected!");
-  delay(2000);
+  LOGI("AP disconnected");
+
+}
+
+void loop() {
+  event_loop_run();
+#if POWER_SAVING
+  update_power();
+#endif
+}
+
+// Clock down between fetches. Light sleep is only allowed while nothing on
+// screen moves, the ticker tape would visibly stutter.
+void update_power() {
+  bool busy = cycle_pending > 0 || fetch_task_busy() || touch_active();
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  // The tape scrolls whenever the detail view does not cover it
+  bool animating = !detail_is_open();
+  busy = busy || animating;
+  bool can_sleep = !animating;
+#else
+  bool can_sleep = true;
+#endif
+  can_sleep = can_sleep && backlight_sleep_safe();
+  power_update(busy, can_sleep, event_loop_next_due_ms(POWER_LIGHT_SLEEP_MAX_MS));
+}
+
+// Follow the room light. The fade timer only runs while the level moves.
+void sample_backlight() {
+  if (backlight_sample()) {
+    timer_start(backlight_ramp_timer, 0);
+  }
+}
+
+void ramp_backlight() {
+  if (!backlight_ramp_step()) {
+    timer_stop(backlight_ramp_timer);
+  }
+}
+
+// Grey out quotes that stopped moving with the exchange clock, e.g. ones the
+// aggregator keeps serving while its upstream fails
+void expire_quotes() {
+  if (quote_store_expire() > 0) {
+    refresh_visible_rows();
+  }
+}
+
+// Grey out the prices while offline, catch up as soon as WiFi is back
+void check_connectivity() {
+  ConnEvent conn_event = connectivity_tick();
+  if (conn_event == CONN_EVENT_LOST) {
+    quote_store_mark_stale();
+    refresh_visible_rows();
+  } else if (conn_event == CONN_EVENT_RESTORED) {
+#if LAN_FANOUT
+    lan_restart();
+#endif
+    timer_start(fetch_timer, 0);
+  }
+}
+
+#if LAN_FANOUT
+// Followers take their quotes from the leader's frames. Each frame is
+// handled like a finished fetch cycle.
+void handle_lan() {
+  if (lan_tick() == LAN_EVENT_FETCH_NEEDED) {
+    timer_start(fetch_timer, 0);
+  }
   
-  // Configure time  
-  configTime(TIMEZONE_OFFSET * 3600, 0, "pool.ntp.org", "time.nist.gov");
-  Serial.printf("Time configured (UTC%d)\n", TIMEZONE_OFFSET);
+  bool received = false;
+  LanQuote lq;
+  while (lan_poll_quote(&lq)) {
+    for (int i = 0; i < NUM_STOCKS; i++) {
+      if (strcmp(STOCK_SYMBOLS[i], lq.symbol) == 0) {
+        YahooQuote q = {lq.price, lq.prev_close, lq.volume, 0};
+        apply_quote(i, q);
+        received = true;
+      }
+    }
+  }
+  if (received && cycle_pending == 0) {
+    finish_fetch_cycle();
+  }
+}
+#endif
+
+// Quotes that arrive without being fetched (push, MQTT) are applied as
+// they come; each batch is handled like a finished fetch cycle
+void apply_arrivals(bool (*poll)(int*, YahooQuote*)) {
+  bool received = false;
+  int i;
+  YahooQuote q;
+  while (poll(&i, &q)) {
+    apply_quote(i, q);
+    received = true;
+  }
+  if (received && cycle_pending == 0) {
+    finish_fetch_cycle();
+  }
+}
+
+// Polling resumes straight away when a pushed source drops
+void resume_polling_if_lost(bool live, bool* was_live) {
+  if (*was_live && !live) {
+    timer_start(fetch_timer, 0);
+  }
+  *was_live = live;
+}
+
+#if AGGREGATOR_PUSH
+void handle_push() {
+  static bool was_live = false;
+  resume_polling_if_lost(quote_push_live(), &was_live);
+  apply_arrivals(quote_push_poll);
+}
+#endif
+
+#if QUOTE_SOURCE == QUOTE_SOURCE_STREAM
+void handle_stream() {
+  static bool was_live = false;
+  resume_polling_if_lost(yahoo_stream_live(), &was_live);
+  apply_arrivals(yahoo_stream_poll);
+}
+#endif
+
+#if QUOTE_SOURCE == QUOTE_SOURCE_MQTT
+void handle_mqtt() {
+  // Quotes only arrive while connected, grey them out until the broker is back
+  static bool was_connected = false;
+  bool connected = mqtt_quotes_connected();
+  if (was_connected && !connected) {
+    quote_store_mark_stale();
+  }
+  if (connected != was_connected) {
+    refresh_visible_rows();
+  }
+  was_connected = connected;
   
-  // Ready to start
+  apply_arrivals(mqtt_quotes_poll);
+}
+#endif
+
+void tick_ticker() {
+  if (!detail_is_open()) {
+    ticker_tick(tft);
+  }
+}
+
+// Page through watchlists that are longer than the screen
+void tick_auto_scroll() {
+  if (watchlist_auto_scroll_tick()) {
+    update_display();
+    fetch_visible_page();
+  }
+}
+
+void handle_touch() {
+#if TOUCH_ENABLED
+  touch_poll();
+  
+  TouchEvent tap;
+  if (!touch_get_tap(&tap)) return;
+  LOGI("Tap at %d,%d", tap.x, tap.y);
+#if POWER_SAVING
+  power_boost();
+#endif
+  
+  // Any tap on the detail view goes back to the list
+  if (detail_is_open()) {
+    detail_close();
+    show_main_screen();
+    return;
+  }
   
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  int stock_index = ticker_row_at(tap.y);
+  if (stock_index < 0) return;
+  ticker_stop(tft);
+#else
+  int stock_index = watchlist_row_at(tap.y);
+  if (stock_index < 0) return;
+#endif
+  
+  detail_open(tft, stock_index, tap.irq_us);
+#endif
+}
+
+// Redraw the list layout, e.g. after returning from the detail view
+void show_main_screen() {
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  ticker_create_ui(tft);
+#else
   create_ui();
-  
-  // Show initial structure with all symbols
-  show_initial_structure();
-  
-  fetch_stock_data();
+  update_display();
+#endif
 }
 
-void loop() {
-  static unsigned long lastUpdate = 0;
-  
-  if (millis() - lastUpdate > UPDATE_INTERVAL) {
-    fetch_stock_data();
-    lastUpdate = millis();
-  }
+// WiFiManager portal instructions
+void show_wifi_setup() {
+  tft.fillScreen(TFT_BLACK);
+  tft.setCursor(10, 10);
+  tft.setTextColor(TFT_WHITE);
+  tft.setTextSize(2);
+  tft.print("WiFi Setup...");
   
-  delay(1000);
+  // Show setup message on display
+  tft.setCursor(10, 40);
+  tft.setTextSize(1);
+  tft.print("1. Connect to WiFi:");
+  tft.setCursor(10, 55);
+  tft.print("   Stock_Tracker_Setup");
+  tft.setCursor(10, 75);
+  tft.print("2. Enter WiFi credentials");
+  tft.setCursor(10, 90);
+  tft.print("3. Wait for connection...");
 }
 
 void create_ui() {
+  tft_begin_frame(tft);
   tft.fillScreen(TFT_BLACK);
   
   // Title
@@ -201,114 +567,218 @@ void create_ui() {
   tft.setTextColor(TFT_CYAN);
   tft.setTextSize(1);
   tft.print("Symbol");
-  tft.setCursor(80, 35);
+  tft.setCursor(PRICE_COLUMN_X, 35);
   tft.print("Price");
-  tft.setCursor(150, 35);
+  tft.setCursor(CHANGE_COLUMN_X, 35);
   tft.print("Change");
+#if INDICATOR_COLUMN != INDICATOR_NONE
+  tft.setCursor(INDICATOR_COLUMN_X, 35);
+  tft.print(indicators_label(INDICATOR_COLUMN));
+#endif
   tft.drawLine(10, 50, 230, 50, TFT_BLUE);
+  
+  tft_end_frame(tft);
 }
 
-void fetch_stock_data() {
-  Serial.println("=== Starting stock data fetch ===");
+// Queue this cycle's quote requests. The results come back one at a time
+// through handle_fetch_results().
+void start_fetch_cycle() {
+  if (cycle_pending > 0 && !page_cycle) {
+    // Still busy with the last cycle, run again as soon as it ends
+    catch_up_pending = true;
+    return;
+  }
+  // A page fetch that is still running just becomes part of this cycle
   
+  LOGI("=== Starting stock data fetch ===");
+  if (polling_paused()) return;
+  
+  // Visible rows first, then a few off-screen symbols
+  static int order[NUM_STOCKS];
+  int count = watchlist_fetch_order(order, NUM_STOCKS);
+  
+#if LAN_FANOUT
+  // Symbols other trackers show as well are fetched every cycle
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    bool queued = false;
+    for (int n = 0; n < count && !queued; n++) {
+      queued = order[n] == i;
+    }
+    if (!queued && lan_is_shared(i)) order[count++] = i;
+  }
+#endif
+  count = drop_fetched_elsewhere(order, count);
+  LOGI("Fetching %d of %d symbols this cycle", count, NUM_STOCKS);
+  begin_cycle();
+  page_cycle = false;
+  for (int n = 0; n < count; n++) {
+    if (fetch_task_submit(FETCH_QUOTE, order[n])) {
+      cycle_pending++;
+    }
+  }
+  
+#if LAN_FANOUT
+  // Leader: plus whatever the followers show that is not on this watchlist
+  static char extra[LAN_FANOUT_MAX_EXTRA][LAN_SYMBOL_LEN];
+  int extra_count = lan_extra_symbols(extra, LAN_FANOUT_MAX_EXTRA);
+  for (int n = 0; n < extra_count; n++) {
+    if (fetch_task_submit_symbol(FETCH_SHARED, extra[n])) {
+      cycle_pending++;
+    }
+  }
+  if (extra_count > 0) LOGI("Fetching %d symbols for other trackers", extra_count);
+#endif
+}
+
+// Whether quotes come from somewhere else right now, or cannot be fetched
+bool polling_paused() {
   // Debug WiFi status
-  Serial.printf("WiFi status: %d (WL_CONNECTED=%d)\n", WiFi.status(), WL_CONNECTED);
-  Serial.printf("Current SSID: %s\n", WiFi.SSID().c_str());
-  Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
-  Serial.printf("RSSI: %d\n", WiFi.RSSI());
+  LOGD("WiFi status: %d (WL_CONNECTED=%d)", WiFi.status(), WL_CONNECTED);
+  LOGD("Current SSID: %s", WiFi.SSID().c_str());
+  LOGD("IP: %s", WiFi.localIP().toString().c_str());
+  LOGD("RSSI: %d", WiFi.RSSI());
   
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("ERROR: WiFi not connected!");
-    
-    // Check saved credentials
-    wifi_config_t conf_check;
-    esp_wifi_get_config(WIFI_IF_STA, &conf_check);
-    Serial.printf("Saved credentials check - SSID: '%s'\n", conf_check.sta.ssid);
-    
-    return;
+    // The connectivity supervisor reconnects and triggers a catch-up fetch
+    LOGW("WiFi not connected, skipping fetch");
+    return true;
   }
-  Serial.println("WiFi is connected");
+  LOGD("WiFi is connected");
   
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    // Using Yahoo Finance API (free, no API key needed)
-    String url = String("https://query1.finance.yahoo.com/v8/finance/chart/") + STOCK_SYMBOLS[i];
-    
-    Serial.printf("Fetching %s...\n", STOCK_SYMBOLS[i]);
-    Serial.printf("URL: %s\n", url.c_str());
-    
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(15000); // Increased timeout to 15 seconds
-    http.addHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36");
-    http.addHeader("Accept", "application/json");
-    http.addHeader("Connection", "close");
-    
-    int httpCode = http.GET();
-    Serial.printf("HTTP Response Code: %d\n", httpCode);
+#if QUOTE_SOURCE == QUOTE_SOURCE_STREAM
+  if (yahoo_stream_live()) {
+    LOGD("Quotes are streamed, skipping fetch");
+    return true;
+  }
+#endif
+#if OTA_ENABLED
+  if (ota_in_progress()) {
+    // The download needs the memory and the bandwidth, and it ends in a restart
+    LOGD("Firmware update in progress, skipping fetch");
+    return true;
+  }
+#endif
+  return false;
+}
+
+// Leave out the symbols whose quotes arrive some other way. Returns the
+// new count.
+int drop_fetched_elsewhere(int* order, int count) {
+  int kept = 0;
+  for (int n = 0; n < count; n++) {
+#if LAN_FANOUT
+    // A follower fetches only what the leader does not
+    if (lan_covers(order[n])) continue;
+#endif
+#if AGGREGATOR_PUSH
+    // Only what the aggregator did not take into the subscription
+    if (quote_push_covers(order[n])) continue;
+#endif
+    order[kept++] = order[n];
+  }
+  return kept;
+}
+
+void begin_cycle() {
+#if QUOTE_SOURCE != QUOTE_SOURCE_AGGREGATOR
+  quote_provider_begin_cycle();
+#endif
+  cycle_changed = false;
+}
+
+// A page that scrolled in is fetched right away rather than when the
+// off-screen round-robin gets to it. Its rows join the running cycle if
+// there is one, otherwise they are a cycle of their own.
+void fetch_visible_page() {
+#if DISPLAY_LAYOUT == LAYOUT_TABLE
+  // Offline the catch-up fetch after reconnecting covers it
+  if (WiFi.status() != WL_CONNECTED || polling_paused()) return;
+  
+  static int order[WATCHLIST_VISIBLE_ROWS];
+  int count = watchlist_page_fetch_order(order, WATCHLIST_VISIBLE_ROWS);
+  count = drop_fetched_elsewhere(order, count);
+  if (count == 0) return;
+  
+  bool idle = cycle_pending == 0;
+  LOGI("Fetching %d symbols of the new page%s", count, idle ? "" : " with the running cycle");
+  if (idle) begin_cycle();
+  for (int n = 0; n < count; n++) {
+    if (fetch_task_submit(FETCH_QUOTE, order[n])) {
+      cycle_pending++;
+    }
+  }
+  if (idle) page_cycle = cycle_pending > 0;
+#endif
+}
+
+void handle_fetch_results() {
+  FetchResult result;
+  while (fetch_task_poll(&result)) {
+    if (result.type == FETCH_DETAIL) {
+      detail_accept(tft, result.index, result.detail);
+      continue;
+    }
     
-    if (httpCode == HTTP_CODE_OK) {
-      String payload = http.getString();
-      Serial.printf("Payload length: %d\n", payload.length());
-      
-      DynamicJsonDocument doc(40 * 1024); // Increased to 40KB for large Yahoo responses
-      DeserializationError error = deserializeJson(doc, payload);
-      
-      if (error) {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
-      } else {
-        Serial.println("JSON parsed successfully");
-        
-        if (doc["chart"]["result"][0]["meta"]) {
-          JsonObject meta = doc["chart"]["result"][0]["meta"];
-          
-          float price = meta["regularMarketPrice"];
-          float prev_close = meta["previousClose"];
-          
-          Serial.printf("Raw data - Current: %.2f, Previous: %.2f\n", price, prev_close);
-          
-          if (price > 0 && prev_close > 0) {
-            float change = price - prev_close;
-            float change_percent = (change / prev_close) * 100;
-            
-            // Check if data changed (always true on first time when valid=false)
-            bool data_changed = true; // Always update on first successful fetch
-            if (stocks[i].valid) {
-              // Only check for changes if we already have valid data
-              data_changed = (abs(stocks[i].price - price) > 0.01 ||
-                            abs(stocks[i].change_percent - change_percent) > 0.01);
-            }
-            
-            stocks[i].price = price;
-            stocks[i].change = change;
-            stocks[i].change_percent = change_percent;
-            stocks[i].valid = true;
-            stocks[i].changed = data_changed;
-            
-            Serial.printf("SUCCESS: %s: $%.2f (%+.2f%%) %s\n", 
-                         STOCK_SYMBOLS[i], 
-                         stocks[i].price, 
-                         stocks[i].change_percent,
-                         data_changed ? "[CHANGED]" : "");
-            
-            // Mark that we have new data (display will be updated later if needed)
-          } else {
-            Serial.printf("ERROR: Invalid price data for %s\n", STOCK_SYMBOLS[i]);
-          }
-        } else {
-          Serial.println("ERROR: No chart data found");
-        }
+#if LAN_FANOUT
+    if (result.ok) {
+      lan_publish(result.symbol, result.quote);
+    }
+#endif
+#if METRICS_ENABLED
+    if (result.type == FETCH_QUOTE) {
+      metrics_record_fetch(result.index, result.ok, result.status, result.batch_index == 0);
+    }
+#endif
+#if QUOTE_SOURCE != QUOTE_SOURCE_AGGREGATOR
+    if (result.batch_index == 0) {
+      quote_provider_record(result.provider, result.status);
+    }
+    // A symbol the provider had no quote for (e.g. Stooq's N/D) goes to the
+    // next best one, each provider once per cycle
+    if (!result.ok) {
+      uint8_t tried = result.tried | (1 << result.provider);
+      int next = quote_provider_fallback(tried);
+      if (next >= 0 && fetch_task_retry(result, next, tried)) {
+        cycle_pending++;
       }
-    } else {
-      Serial.printf("HTTP GET failed: %d\n", httpCode);
     }
-    
-    http.end();
-    delay(500); // Rate limiting
+#endif
+    if (result.ok && result.type == FETCH_QUOTE) {
+      apply_quote(result.index, result.quote);
+    }
+    if (cycle_pending > 0 && --cycle_pending == 0) {
+      finish_fetch_cycle();
+    }
   }
-  
-  // Check if any data changed
-  bool any_changed = false;
-  for (int i = 0; i < NUM_STOCKS; i++) {
+}
+
+void apply_quote(int i, const YahooQuote& q) {
+  bool data_changed = quote_store_apply(i, q.price, q.prev_close, q.volume, q.market_time);
+  
+  // Logged once, after the first successful quote since boot
+  boot_mark("first quote");
+  boot_report();
+  
+  LOGD("SUCCESS: %s: $%.2f (%+.2f%%) %s", 
+      STOCK_SYMBOLS[i], 
+      stocks[i].price, 
+      stocks[i].change_percent,
+      data_changed ? "[CHANGED]" : "");
+  
+#if DISPLAY_LAYOUT == LAYOUT_TABLE
+  // Visible rows are drawn as their quote arrives rather than at the end
+  if (data_changed && watchlist_is_visible(i)) {
+    update_single_stock(i);
+    stocks[i].changed = false;
+    cycle_changed = true;
+  }
+#endif
+}
+
+void finish_fetch_cycle() {
+  // Check if any visible data changed
+  bool any_changed = cycle_changed;
+  for (int i = watchlist_first_visible(); i < watchlist_first_visible() + watchlist_visible_count(); i++) {
     if (stocks[i].changed) {
       any_changed = true;
       break;
@@ -316,197 +786,223 @@ void fetch_stock_data() {
   }
   
   // Show summary
-  Serial.printf("=== Stock fetch complete. Valid stocks: ");
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    if (stocks[i].valid) {
-      Serial.printf("%s ", STOCK_SYMBOLS[i]);
-    }
-  }
-  Serial.printf("- Changes: %s\n", any_changed ? "YES" : "NO");
-  
-  // Count valid stocks
-  int valid_stocks = 0;
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    if (stocks[i].valid) valid_stocks++;
-  }
+  LOGI("=== Stock fetch complete. Valid stocks: %d/%d - Changes: %s",
+       quote_store_valid_count(), NUM_STOCKS, any_changed ? "YES" : "NO");
   
-  // Only update display if data actually changed
   if (any_changed) {
-    Serial.println("Updating display due to data changes");
     last_update_time = time(nullptr); // Update timestamp only when data changes
-    update_display();
-    
-    // Reset change flags
-    for (int i = 0; i < NUM_STOCKS; i++) {
-      stocks[i].changed = false;
-    }
-  } else {
-    Serial.println("No data changes, skipping display update");
+  }
+  
+  // Redraw only the changed rows and the newest sparkline columns
+  refresh_visible_rows();
+  
+  // Reset change flags (off-screen rows are drawn fresh when scrolled in)
+  quote_store_clear_changed();
+  
+  // Keep the last-known quotes for the next boot
+  quote_snapshot_save();
+  
+#if LAN_FANOUT
+  // Send what is left of this cycle's quotes to the followers
+  lan_flush();
+#endif
+  
+  page_cycle = false;
+  if (catch_up_pending) {
+    catch_up_pending = false;
+    timer_start(fetch_timer, 0);
   }
 }
 
 void update_display() {
-  Serial.println("=== Updating display ===");
+  LOGD("=== Updating display ===");
   
-  // Clear data area
-  tft.fillRect(10, 55, 220, 200, TFT_BLACK);
+  // The list is hidden behind the detail view and redrawn when it closes
+  if (detail_is_open()) return;
   
-  // Count valid stocks
-  int valid_count = 0;
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    if (stocks[i].valid) {
-      valid_count++;
-    }
-  }
-  Serial.printf("Displaying %d valid stocks\n", valid_count);
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  // Ticker rows pick up new prices as they scroll in, only the status is fixed
+  ticker_draw_status(tft);
+  return;
+#endif
   
-  // Display all stocks in table format
-  int y = 60;
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    // Show symbol even if not valid yet
-    tft.setCursor(10, y);
-    tft.setTextColor(TFT_WHITE);
-    tft.setTextSize(1);
-    tft.print(STOCK_SYMBOLS[i]);
-    
-    if (stocks[i].valid) {
-      Serial.printf("Drawing %s at y=%d: $%.2f (%.2f%%)\n", 
-                   stocks[i].symbol.c_str(), y, stocks[i].price, stocks[i].change_percent);
-      
-      // Price
-      tft.setCursor(80, y);
-      tft.setTextColor(TFT_WHITE);
-      tft.printf("$%.2f", stocks[i].price);
-      
-      // Change
-      tft.setCursor(150, y);
-      uint16_t color = (stocks[i].change >= 0) ? TFT_GREEN : TFT_RED;
-      tft.setTextColor(color);
-      tft.printf("%+.2f%%", stocks[i].change_percent);
-    } else {
-      // Show "Loading..." for invalid stocks
-      tft.setCursor(80, y);
-      tft.setTextColor(TFT_YELLOW);
-      tft.print("Loading...");
-      Serial.printf("Stock %d (%s) is not valid - showing loading\n", i, STOCK_SYMBOLS[i]);
-    }
-    
-    y += 20;
-  }
+  tft_begin_frame(tft);
   
-  // Clear the status area to remove any old text
-  tft.fillRect(10, 240, 220, 80, TFT_BLACK);
+  // Clear data area
+  tft.fillRect(10, DATA_AREA_Y, 220, DATA_AREA_HEIGHT, TFT_BLACK);
   
-  // Status - Show connection status only
-  tft.setCursor(10, 280);
-  tft.setTextColor(TFT_CYAN);
-  tft.setTextSize(1);
-  if (valid_count == 0) {
-    tft.print("Connecting...");
-  } else {
-    tft.printf("Live (%d stocks)", valid_count);
-  }
+  LOGD("Displaying rows %d-%d of %d (%d valid)",
+       watchlist_first_visible() + 1,
+       watchlist_first_visible() + watchlist_visible_count(),
+       NUM_STOCKS, quote_store_valid_count());
   
-  // Commented out last updated time display
-  /*
-  struct tm timeinfo;
-  if (last_update_time > 0 && localtime_r(&last_update_time, &timeinfo)) {
-    // Convert to 12-hour format
-    int hour12 = timeinfo.tm_hour;
-    if (hour12 == 0) hour12 = 12;
-    else if (hour12 > 12) hour12 -= 12;
-    const char* ampm = (timeinfo.tm_hour >= 12) ? "PM" : "AM";
-    
-    tft.printf("Last updated: %d:%02d %s", 
-               hour12, timeinfo.tm_min, ampm);
+  // Only the rows inside the visible window are laid out
+  for (int i = watchlist_first_visible(); i < watchlist_first_visible() + watchlist_visible_count(); i++) {
+    draw_row(i, watchlist_row_y(i));
   }
-  */
   
-  Serial.println("=== Display update complete ===");
+  draw_status();
+  
+  tft_end_frame(tft);
+  LOGD("=== Display update complete ===");
 }
 
 void update_single_stock(int stock_index) {
-  Serial.printf("=== Updating single stock: %s ===\n", STOCK_SYMBOLS[stock_index]);
+  // Off-screen rows are drawn when they are scrolled into view
+  int y = watchlist_row_y(stock_index);
+  if (y < 0 || detail_is_open()) return;
+  
+  LOGD("=== Updating single stock: %s ===", STOCK_SYMBOLS[stock_index]);
+  
+  tft_begin_frame(tft);
+  
+  // Clear just this stock's text, the sparkline only gets its new column
+  tft.fillRect(10, y, SPARKLINE_X - 10, WATCHLIST_ROW_HEIGHT, TFT_BLACK);
+  draw_row_text(stock_index, y);
+#if SPARKLINES_ENABLED
+  sparkline_draw_latest(tft, stock_index, SPARKLINE_X, y);
+#endif
+  
+  draw_status();
   
-  // Calculate Y position for this stock
-  int y = 60 + (stock_index * 20);
+  tft_end_frame(tft);
+  LOGD("=== Single stock update complete for %s ===", STOCK_SYMBOLS[stock_index]);
+}
+
+void show_initial_structure() {
+  LOGI("=== Showing initial structure ===");
   
-  // Clear just this stock's row
-  tft.fillRect(10, y, 220, 20, TFT_BLACK);
+  // Nothing is valid yet, so every visible row shows "Loading..."
+  update_display();
   
-  // Show symbol
+  LOGI("=== Initial structure complete ===");
+}
+
+// Update the visible rows after a fetch without clearing the table
+void refresh_visible_rows() {
+  if (detail_is_open()) return;
+  
+#if DISPLAY_LAYOUT == LAYOUT_TICKER
+  ticker_draw_status(tft);
+#else
+  tft_begin_frame(tft);
+  for (int i = watchlist_first_visible(); i < watchlist_first_visible() + watchlist_visible_count(); i++) {
+    int y = watchlist_row_y(i);
+    if (stocks[i].changed) {
+      tft.fillRect(10, y, SPARKLINE_X - 10, WATCHLIST_ROW_HEIGHT, TFT_BLACK);
+      draw_row_text(i, y);
+    }
+#if SPARKLINES_ENABLED
+    sparkline_draw_latest(tft, i, SPARKLINE_X, y);
+#endif
+  }
+  draw_status();
+  tft_end_frame(tft);
+#endif
+}
+
+// Draw one table row. Expects the row area to be cleared already.
+void draw_row(int i, int y) {
+  draw_row_text(i, y);
+#if SPARKLINES_ENABLED
+  sparkline_draw(tft, i, SPARKLINE_X, y);
+#endif
+}
+
+void draw_row_text(int i, int y) {
+  // Show symbol even if not valid yet
   tft.setCursor(10, y);
   tft.setTextColor(TFT_WHITE);
   tft.setTextSize(1);
-  tft.print(STOCK_SYMBOLS[stock_index]);
+  tft.print(stocks[i].symbol);
   
-  if (stocks[stock_index].valid) {
-    Serial.printf("Drawing %s at y=%d: $%.2f (%.2f%%)\n", 
-                 stocks[stock_index].symbol.c_str(), y, stocks[stock_index].price, stocks[stock_index].change_percent);
+  if (stocks[i].valid) {
+    LOGD("Drawing %s at y=%d: $%.2f (%.2f%%)", 
+        stocks[i].symbol, y, stocks[i].price, stocks[i].change_percent);
+    
+    // Quotes from the boot snapshot are greyed out until refreshed
+    bool stale = stocks[i].stale;
     
     // Price
-    tft.setCursor(80, y);
-    tft.setTextColor(TFT_WHITE);
-    tft.printf("$%.2f", stocks[stock_index].price);
+    tft.setCursor(PRICE_COLUMN_X, y);
+    tft.setTextColor(stale ? TFT_DARKGREY : TFT_WHITE);
+    tft.printf("$%.2f", stocks[i].price);
     
     // Change
-    tft.setCursor(150, y);
-    uint16_t color = (stocks[stock_index].change >= 0) ? TFT_GREEN : TFT_RED;
+    tft.setCursor(CHANGE_COLUMN_X, y);
+    uint16_t color = (stocks[i].change >= 0) ? TFT_GREEN : TFT_RED;
+    if (stale) color = TFT_DARKGREY;
     tft.setTextColor(color);
-    tft.printf("%+.2f%%", stocks[stock_index].change_percent);
-  }
-  
-  // Update status area
-  tft.fillRect(10, 240, 220, 80, TFT_BLACK);
-  tft.setCursor(10, 280);
-  tft.setTextColor(TFT_CYAN);
-  tft.setTextSize(1);
-  
-  // Count valid stocks
-  int valid_count = 0;
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    if (stocks[i].valid) valid_count++;
-  }
-  
-  if (valid_count == 0) {
-    tft.print("Connecting...");
+    tft.printf("%+.2f%%", stocks[i].change_percent);
+    
+#if INDICATOR_COLUMN != INDICATOR_NONE
+    draw_indicator(i, y);
+#endif
   } else {
-    tft.printf("Live (%d stocks)", valid_count);
+    // Show "Loading..." for invalid stocks
+    tft.setCursor(PRICE_COLUMN_X, y);
+    tft.setTextColor(TFT_YELLOW);
+    tft.print("Loading...");
   }
-  
-  Serial.printf("=== Single stock update complete for %s ===\n", STOCK_SYMBOLS[stock_index]);
 }
 
-void show_initial_structure() {
-  Serial.println("=== Showing initial structure ===");
-  
-  // Clear data area
-  tft.fillRect(10, 55, 220, 200, TFT_BLACK);
-  
-  // Display all stock symbols with "Loading..." placeholders
-  int y = 60;
-  for (int i = 0; i < NUM_STOCKS; i++) {
-    // Show symbol
-    tft.setCursor(10, y);
-    tft.setTextColor(TFT_WHITE);
-    tft.setTextSize(1);
-    tft.print(STOCK_SYMBOLS[i]);
-    
-    // Show "Loading..." placeholder
-    tft.setCursor(80, y);
-    tft.setTextColor(TFT_YELLOW);
-    tft.print("Loading...");
-    
-    y += 20;
+#if INDICATOR_COLUMN != INDICATOR_NONE
+void draw_indicator(int i, int y) {
+  tft.setCursor(INDICATOR_COLUMN_X, y);
+  
+  float value;
+  if (!indicators_get(i, INDICATOR_COLUMN, &value)) {
+    // Still warming up
+    tft.setTextColor(TFT_DARKGREY);
+    tft.print("--");
+    return;
   }
   
-  // Status
+#if INDICATOR_COLUMN == INDICATOR_RSI
+  // Overbought / oversold
+  uint16_t color = TFT_WHITE;
+  if (value >= 70) color = TFT_RED;
+  else if (value <= 30) color = TFT_GREEN;
+  tft.setTextColor(color);
+  tft.printf("%.0f", value);
+#else
+  // Price above or below the level
+  tft.setTextColor((stocks[i].price >= value) ? TFT_GREEN : TFT_RED);
+  tft.printf("%.2f", value);
+#endif
+}
+#endif
+
+void draw_status() {
+  // Clear the status area to remove any old text
   tft.fillRect(10, 240, 220, 80, TFT_BLACK);
+  
+  // Status - Show connection status only
+  char status[40];
   tft.setCursor(10, 280);
-  tft.setTextColor(TFT_CYAN);
+  tft.setTextColor(status_text(status, sizeof(status)));
   tft.setTextSize(1);
-  tft.print("Connecting...");
+  tft.print(status);
   
-  Serial.println("=== Initial structure complete ===");
+  // Position in the list when it does not fit on one screen
+  if (NUM_STOCKS > WATCHLIST_VISIBLE_ROWS) {
+    tft.setCursor(160, 280);
+    tft.printf("%d-%d/%d", watchlist_first_visible() + 1,
+               watchlist_first_visible() + watchlist_visible_count(), NUM_STOCKS);
+  }
+  
+  // Commented out last updated time display
+  /*
+  struct tm timeinfo;
+  if (last_update_time > 0 && localtime_r(&last_update_time, &timeinfo)) {
+    // Convert to 12-hour format
+    int hour12 = timeinfo.tm_hour;
+    if (hour12 == 0) hour12 = 12;
+    else if (hour12 > 12) hour12 -= 12;
+    const char* ampm = (timeinfo.tm_hour >= 12) ? "PM" : "AM";
+    
+    tft.printf("Last updated: %d:%02d %s", 
+               hour12, timeinfo.tm_min, ampm);
+  }
+  */
 }
-
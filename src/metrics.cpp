@@ -0,0 +1,499 @@
+#include <WiFi.h>
+#include <stdarg.h>
+#include <esp_timer.h>
+#include "metrics.h"
+#include "event_loop.h"
+#include "fetch_task.h"
+#include "power.h"
+#include "backlight.h"
+#include "quote_provider.h"
+#include "logging.h"
+#include "health.h"
+#include "../config.h"
+
+#define METRICS_PREFIX "stock_tracker_"
+
+// Histogram bucket bounds (le), in microseconds, with the label text
+#define FETCH_BUCKETS 8
+static const uint32_t FETCH_BOUNDS_US[FETCH_BUCKETS] = {
+  100000, 250000, 500000, 1000000, 2000000, 4000000, 8000000, 16000000
+};
+static const char* FETCH_BOUND_LABELS[FETCH_BUCKETS] = {
+  "0.1", "0.25", "0.5", "1", "2", "4", "8", "16"
+};
+
+#define RENDER_BUCKETS 7
+static const uint32_t RENDER_BOUNDS_US[RENDER_BUCKETS] = {
+  1000, 2000, 5000, 10000, 20000, 50000, 100000
+};
+static const char* RENDER_BOUND_LABELS[RENDER_BUCKETS] = {
+  "0.001", "0.002", "0.005", "0.01", "0.02", "0.05", "0.1"
+};
+
+// Counts per bucket are not cumulative here, they are summed when the page
+// is written
+struct FetchHistogram {
+  uint32_t buckets[FETCH_BUCKETS];
+  uint32_t count;
+  uint64_t sum_us;
+};
+
+struct SymbolMetrics {
+  FetchHistogram latency;
+  uint32_t failures;
+  uint32_t parse_errors;
+};
+
+// HTTP status codes are counted in a small table, anything beyond it goes
+// into "other"
+#define STATUS_SLOTS 8
+struct StatusCount {
+  int16_t code;
+  uint32_t count;
+};
+
+static SymbolMetrics symbols[NUM_STOCKS];
+static StatusCount status_counts[STATUS_SLOTS];
+static uint32_t status_other = 0;
+
+static uint32_t render_buckets[RENDER_BUCKETS];
+static uint32_t render_count = 0;
+static uint64_t render_sum_us = 0;
+static uint32_t render_max_us = 0;
+
+static uint32_t scrapes = 0;
+
+// ---- Recording -------------------------------------------------------------
+
+void metrics_record_fetch(int index, bool ok, const FetchStatus& status, bool first_result) {
+  if (index < 0 || index >= NUM_STOCKS) return;
+  SymbolMetrics& m = symbols[index];
+
+  // A batch's time is shared out over its symbols, as the provider router does
+  uint32_t latency_us = status.batch > 1 ? status.latency_us / status.batch : status.latency_us;
+  FetchHistogram& h = m.latency;
+  for (int b = 0; b < FETCH_BUCKETS; b++) {
+    if (latency_us <= FETCH_BOUNDS_US[b]) {
+      h.buckets[b]++;
+      break;
+    }
+  }
+  h.count++;
+  h.sum_us += latency_us;
+
+  if (!ok) m.failures++;
+  if (!ok && status.parse_error) m.parse_errors++;
+
+  if (!first_result) return;
+  for (int s = 0; s < STATUS_SLOTS; s++) {
+    if (status_counts[s].count == 0) status_counts[s].code = status.http_code;
+    if (status_counts[s].code == status.http_code) {
+      status_counts[s].count++;
+      return;
+    }
+  }
+  status_other++;
+}
+
+void metrics_record_render(uint32_t duration_us) {
+  for (int b = 0; b < RENDER_BUCKETS; b++) {
+    if (duration_us <= RENDER_BOUNDS_US[b]) {
+      render_buckets[b]++;
+      break;
+    }
+  }
+  render_count++;
+  render_sum_us += duration_us;
+  if (duration_us > render_max_us) render_max_us = duration_us;
+}
+
+// ---- Page ------------------------------------------------------------------
+
+// The page is written a piece at a time into this buffer as the previous
+// piece goes out, so its size does not grow with the watchlist. A piece is
+// one step of PAGE_STEPS below: one symbol's lines of a per-symbol family,
+// or a group of system gauges.
+static char page[METRICS_BUFFER_SIZE];
+static size_t page_len = 0;
+static bool page_full = false; // The current step did not fit
+
+static void out(const char* format, ...) {
+  if (page_full) return;
+
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(page + page_len, sizeof(page) - page_len, format, args);
+  va_end(args);
+
+  if (n < 0 || page_len + n >= sizeof(page)) {
+    page_full = true;
+    return;
+  }
+  page_len += n;
+}
+
+static void header(const char* name, const char* type, const char* help) {
+  out("# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n", name, help, name, type);
+}
+
+static void gauge(const char* name, const char* help, double value) {
+  header(name, "gauge", help);
+  out(METRICS_PREFIX "%s %.6g\n", name, value);
+}
+
+static void write_fetch_latency(int i) {
+  if (i == 0) header("fetch_duration_seconds", "histogram", "Quote request time including connection setup, per symbol of a batch");
+  const FetchHistogram& h = symbols[i].latency;
+  uint32_t cumulative = 0;
+  for (int b = 0; b < FETCH_BUCKETS; b++) {
+    cumulative += h.buckets[b];
+    out(METRICS_PREFIX "fetch_duration_seconds_bucket{symbol=\"%s\",le=\"%s\"} %u\n",
+        STOCK_SYMBOLS[i], FETCH_BOUND_LABELS[b], (unsigned)cumulative);
+  }
+  out(METRICS_PREFIX "fetch_duration_seconds_bucket{symbol=\"%s\",le=\"+Inf\"} %u\n",
+      STOCK_SYMBOLS[i], (unsigned)h.count);
+  out(METRICS_PREFIX "fetch_duration_seconds_sum{symbol=\"%s\"} %.3f\n",
+      STOCK_SYMBOLS[i], h.sum_us / 1e6);
+  out(METRICS_PREFIX "fetch_duration_seconds_count{symbol=\"%s\"} %u\n",
+      STOCK_SYMBOLS[i], (unsigned)h.count);
+}
+
+static void write_fetch_failures(int i) {
+  if (i == 0) header("fetch_failures_total", "counter", "Quote requests that gave no usable quote");
+  out(METRICS_PREFIX "fetch_failures_total{symbol=\"%s\"} %u\n",
+      STOCK_SYMBOLS[i], (unsigned)symbols[i].failures);
+}
+
+static void write_parse_errors(int i) {
+  if (i == 0) header("parse_errors_total", "counter", "Responses that could not be parsed into a quote");
+  out(METRICS_PREFIX "parse_errors_total{symbol=\"%s\"} %u\n",
+      STOCK_SYMBOLS[i], (unsigned)symbols[i].parse_errors);
+}
+
+static void write_fetch_metrics(int) {
+  header("http_responses_total", "counter", "Quote responses by HTTP status (negative: connection error)");
+  for (int s = 0; s < STATUS_SLOTS && status_counts[s].count > 0; s++) {
+    out(METRICS_PREFIX "http_responses_total{code=\"%d\"} %u\n",
+        status_counts[s].code, (unsigned)status_counts[s].count);
+  }
+  if (status_other > 0) {
+    out(METRICS_PREFIX "http_responses_total{code=\"other\"} %u\n", (unsigned)status_other);
+  }
+
+#if QUOTE_SOURCE != QUOTE_SOURCE_AGGREGATOR
+  header("provider_latency_seconds", "gauge", "Rolling per-symbol request time of each quote provider");
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    out(METRICS_PREFIX "provider_latency_seconds{provider=\"%s\"} %.3f\n",
+        quote_provider(id).name, quote_provider_health(id).latency_ms / 1e3);
+  }
+  header("provider_error_ratio", "gauge", "Rolling share of symbols a quote provider gave no quote for");
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    out(METRICS_PREFIX "provider_error_ratio{provider=\"%s\"} %.3f\n",
+        quote_provider(id).name, quote_provider_health(id).error_rate);
+  }
+  header("provider_requests_total", "counter", "Requests sent to each quote provider");
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    out(METRICS_PREFIX "provider_requests_total{provider=\"%s\"} %u\n",
+        quote_provider(id).name, (unsigned)quote_provider_health(id).requests);
+  }
+  header("provider_selected", "gauge", "1 for the provider the current cycle uses");
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    out(METRICS_PREFIX "provider_selected{provider=\"%s\"} %d\n",
+        quote_provider(id).name, quote_provider_current() == id);
+  }
+#endif
+}
+
+static void write_render_metrics(int) {
+  header("render_duration_seconds", "histogram", "Time per drawing frame on the display");
+  uint32_t cumulative = 0;
+  for (int b = 0; b < RENDER_BUCKETS; b++) {
+    cumulative += render_buckets[b];
+    out(METRICS_PREFIX "render_duration_seconds_bucket{le=\"%s\"} %u\n",
+        RENDER_BOUND_LABELS[b], (unsigned)cumulative);
+  }
+  out(METRICS_PREFIX "render_duration_seconds_bucket{le=\"+Inf\"} %u\n", (unsigned)render_count);
+  out(METRICS_PREFIX "render_duration_seconds_sum %.3f\n", render_sum_us / 1e6);
+  out(METRICS_PREFIX "render_duration_seconds_count %u\n", (unsigned)render_count);
+  gauge("render_max_seconds", "Longest drawing frame since boot", render_max_us / 1e6);
+}
+
+static void write_system_metrics(int) {
+  gauge("uptime_seconds", "Time since boot", esp_timer_get_time() / 1e6);
+  gauge("heap_free_bytes", "Free heap", ESP.getFreeHeap());
+  gauge("heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+  gauge("heap_largest_block_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+  gauge("wifi_rssi_dbm", "WiFi signal strength", WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0);
+  gauge("wifi_connected", "1 while associated with the access point", WiFi.status() == WL_CONNECTED);
+
+  int jobs, results;
+  fetch_task_queue_depths(&jobs, &results);
+  header("queue_depth", "gauge", "Entries waiting in the fetch task queues");
+  out(METRICS_PREFIX "queue_depth{queue=\"jobs\"} %d\n", jobs);
+  out(METRICS_PREFIX "queue_depth{queue=\"results\"} %d\n", results);
+}
+
+static void write_loop_metrics(int) {
+  EventLoopStats loop;
+  event_loop_stats(&loop);
+  gauge("loop_max_block_seconds", "Longest single main loop handler run since boot", loop.max_block_us / 1e6);
+  gauge("loop_max_timer_late_seconds", "Worst main loop timer lateness since boot", loop.max_late_us / 1e6);
+
+#if POWER_SAVING
+  header("power_state_ratio", "gauge", "Share of time in each power state since boot");
+  for (int s = 0; s < POWER_NUM_STATES; s++) {
+    out(METRICS_PREFIX "power_state_ratio{state=\"%s\"} %.4f\n",
+        power_state_name((PowerState)s), power_duty_percent((PowerState)s) / 100.0f);
+  }
+  gauge("power_estimated_milliamps", "Estimated average supply current (backlight excluded)", power_average_ma());
+#endif
+
+  gauge("backlight_level", "Backlight level, 0-255 perceived", backlight_level());
+  gauge("ambient_light_ratio", "Filtered light sensor reading, 0 dark to 1 bright", backlight_ambient_percent() / 100.0f);
+
+  header("log_dropped_total", "counter", "Log lines dropped because the log ring was full");
+  out(METRICS_PREFIX "log_dropped_total %u\n", (unsigned)log_dropped());
+}
+
+static void write_health_metrics(int) {
+  const HealthTaskStack* stacks;
+  int num_stacks = health_task_stacks(&stacks);
+  header("task_stack_free_bytes", "gauge", "Least unused stack per task since boot");
+  for (int i = 0; i < num_stacks; i++) {
+    if (stacks[i].free_bytes < 0) continue;
+    out(METRICS_PREFIX "task_stack_free_bytes{task=\"%s\"} %d\n", stacks[i].name, stacks[i].free_bytes);
+  }
+  header("alloc_failures_total", "counter", "Failed heap allocations since boot");
+  out(METRICS_PREFIX "alloc_failures_total %u\n", (unsigned)health_alloc_failures());
+  header("crashes_total", "counter", "Panic and watchdog restarts, kept across restarts");
+  out(METRICS_PREFIX "crashes_total %u\n", (unsigned)health_crashes());
+  header("last_reset", "gauge", "Why the tracker last restarted");
+  out(METRICS_PREFIX "last_reset{reason=\"%s\"} 1\n", health_reset_reason());
+
+  header("scrapes_total", "counter", "Requests for this page");
+  out(METRICS_PREFIX "scrapes_total %u\n", (unsigned)scrapes);
+}
+
+// The page in order. Per-symbol steps run once for every symbol.
+struct PageStep {
+  void (*write)(int index);
+  bool per_symbol;
+};
+
+static const PageStep PAGE_STEPS[] = {
+  {write_fetch_latency, true},
+  {write_fetch_failures, true},
+  {write_parse_errors, true},
+  {write_fetch_metrics, false},
+  {write_render_metrics, false},
+  {write_system_metrics, false},
+  {write_loop_metrics, false},
+  {write_health_metrics, false},
+};
+#define PAGE_NUM_STEPS (int)(sizeof(PAGE_STEPS) / sizeof(PAGE_STEPS[0]))
+
+static int page_step = 0;
+static int page_index = 0;
+
+static void page_begin() {
+  page_step = 0;
+  page_index = 0;
+}
+
+static void page_advance() {
+  if (PAGE_STEPS[page_step].per_symbol && ++page_index < NUM_STOCKS) return;
+  page_step++;
+  page_index = 0;
+}
+
+// Refill the buffer with as many whole steps as fit. Returns false once the
+// page is complete.
+static bool page_fill() {
+  page_len = 0;
+  while (page_step < PAGE_NUM_STEPS) {
+    size_t before = page_len;
+    page_full = false;
+    PAGE_STEPS[page_step].write(page_index);
+
+    if (page_full) {
+      page_len = before; // Drop the partial step so the output stays parseable
+      if (before > 0) break; // It goes first in the next fill
+      LOGW("WARNING: Metrics step %d does not fit in %u bytes, raise METRICS_BUFFER_SIZE",
+           page_step, (unsigned)sizeof(page));
+    }
+    page_advance();
+  }
+  return page_len > 0;
+}
+
+// ---- Server ----------------------------------------------------------------
+
+enum ClientState {
+  CLIENT_NONE,
+  CLIENT_READING, // Waiting for the end of the request headers
+  CLIENT_SENDING  // Sending the response a chunk at a time
+};
+
+static WiFiServer server(METRICS_PORT);
+static WiFiClient client;
+static ClientState client_state = CLIENT_NONE;
+static unsigned long client_start = 0;
+
+static char request_line[64];
+static int request_len = 0;
+static bool request_line_done = false;
+static uint8_t blank_run = 0; // Consecutive line ends seen, 2 = end of headers
+
+static char response_header[128];
+static const char* body = nullptr; // Fixed body, or nullptr for the metrics page
+static size_t body_len = 0;
+static bool header_sent = false;
+static const char* segment = nullptr; // What is going out now: header, body or a page piece
+static size_t segment_len = 0;
+static size_t sent = 0;               // Of the segment
+
+static const char NOT_FOUND[] = "Not found, try /metrics or /coredump\n";
+static const char NO_CORE_DUMP[] = "No core dump in flash\n";
+
+void metrics_begin() {
+  server.begin();
+  server.setNoDelay(true);
+  LOGI("Metrics on http://%s:%d/metrics", WiFi.localIP().toString().c_str(), METRICS_PORT);
+}
+
+static void close_client() {
+  client.stop();
+  client_state = CLIENT_NONE;
+}
+
+static bool is_path(const char* path) {
+  size_t len = strlen(path);
+  return strncmp(request_line, path, len) == 0 &&
+         (request_line[len] == ' ' || request_line[len] == '?' || request_line[len] == '\0');
+}
+
+static void start_response() {
+  bool found = true;
+  const char* content_type = "text/plain; version=0.0.4; charset=utf-8";
+  const uint8_t* dump;
+  size_t dump_len;
+  if (is_path("GET /metrics")) {
+    scrapes++;
+    page_begin();
+    body = nullptr;
+  } else if (is_path("GET /coredump") && health_core_dump(&dump, &dump_len)) {
+    // Straight from flash, mapped; decode with espcoredump.py
+    body = (const char*)dump;
+    body_len = dump_len;
+    content_type = "application/octet-stream";
+  } else if (is_path("GET /coredump")) {
+    found = false;
+    body = NO_CORE_DUMP;
+    body_len = sizeof(NO_CORE_DUMP) - 1;
+  } else {
+    found = false;
+    body = NOT_FOUND;
+    body_len = sizeof(NOT_FOUND) - 1;
+  }
+
+  // The page's length is not known up front, it ends when the connection closes
+  char length[32] = "";
+  if (body) snprintf(length, sizeof(length), "Content-Length: %u\r\n", (unsigned)body_len);
+  segment_len = snprintf(response_header, sizeof(response_header),
+                         "HTTP/1.1 %s\r\nContent-Type: %s\r\n%sConnection: close\r\n\r\n",
+                         found ? "200 OK" : "404 Not Found", content_type, length);
+  segment = response_header;
+  header_sent = false;
+  sent = 0;
+  client_state = CLIENT_SENDING;
+}
+
+// Read what has arrived. Only the request line is kept; the headers are
+// read and dropped so closing the socket does not reset the connection.
+static void read_request() {
+  while (client.available() > 0) {
+    char c = client.read();
+    if (c == '\r') continue;
+
+    if (c == '\n') {
+      request_line_done = true;
+      if (++blank_run == 2) {
+        start_response();
+        return;
+      }
+      continue;
+    }
+    blank_run = 0;
+    if (!request_line_done && request_len < (int)sizeof(request_line) - 1) {
+      request_line[request_len++] = c;
+      request_line[request_len] = '\0';
+    }
+  }
+}
+
+// Move on to what follows the current segment. Returns false when the
+// response is complete.
+static bool next_segment() {
+  sent = 0;
+  if (body) {
+    if (header_sent) return false;
+    header_sent = true;
+    segment = body;
+    segment_len = body_len;
+    return true;
+  }
+  header_sent = true;
+  if (!page_fill()) return false;
+  segment = page;
+  segment_len = page_len;
+  return true;
+}
+
+// Send the next chunk. Bounded so one scrape never holds up the loop.
+static void send_chunk() {
+  size_t budget = METRICS_SEND_CHUNK;
+  while (budget > 0) {
+    if (sent >= segment_len && !next_segment()) {
+      client.flush();
+      close_client();
+      return;
+    }
+    size_t n = segment_len - sent;
+    if (n > budget) n = budget;
+    if (n == 0) continue; // Empty body
+
+    size_t written = client.write((const uint8_t*)segment + sent, n);
+    if (written == 0) {
+      close_client(); // Peer gone
+      return;
+    }
+    sent += written;
+    budget -= written;
+  }
+  client_start = millis(); // The timeout is for stalls; a core dump takes many chunks
+}
+
+void metrics_service() {
+  if (client_state == CLIENT_NONE) {
+    client = server.available();
+    if (!client) return;
+
+    client_state = CLIENT_READING;
+    client_start = millis();
+    request_len = 0;
+    request_line[0] = '\0';
+    request_line_done = false;
+    blank_run = 0;
+  }
+
+  if (!client.connected() || millis() - client_start > METRICS_CLIENT_TIMEOUT_MS) {
+    close_client();
+    return;
+  }
+
+  if (client_state == CLIENT_READING) {
+    read_request();
+  } else {
+    send_chunk();
+  }
+}
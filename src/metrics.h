@@ -0,0 +1,30 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "yahoo_api.h"
+
+// Prometheus metrics on http://<tracker>:METRICS_PORT/metrics.
+//
+// Everything is kept in fixed-size counters and the page is written a piece
+// at a time through a small static buffer, so a scrape allocates nothing and
+// costs a few milliseconds of the main loop. The server handles one
+// connection at a time and sends the page in chunks across passes of the
+// event loop.
+//
+// Counters are only updated from the main loop (fetch results are recorded
+// when they are applied), so no locking is needed.
+
+void metrics_begin();
+
+// Event loop handler: accept, read the request, send the page
+void metrics_service();
+
+// One symbol's result of a quote request. status is the whole request's; its
+// request-level counters are only taken from the first result (first_result).
+void metrics_record_fetch(int index, bool ok, const FetchStatus& status, bool first_result);
+
+// One drawing frame (outermost tft_begin_frame .. tft_end_frame)
+void metrics_record_render(uint32_t duration_us);
+
+#endif
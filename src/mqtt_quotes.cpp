@@ -0,0 +1,141 @@
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "mqtt_quotes.h"
+#include "logging.h"
+#include "../config.h"
+
+// The client and its buffer only exist in MQTT mode
+#if QUOTE_SOURCE == QUOTE_SOURCE_MQTT
+
+#define MQTT_TASK_STACK 4096
+#define MQTT_TASK_PRIORITY 1
+#define MQTT_TASK_CORE 0 // Next to the fetch task, away from the main loop
+#define MQTT_QUEUE_LENGTH (NUM_STOCKS + 4) // All retained quotes at once
+#define MQTT_RETRY_MS 10000     // Between connection attempts
+#define MQTT_LOOP_MS 50         // How often the socket is checked
+#define MQTT_PAYLOAD_MAX 48
+#define MQTT_TOPIC_MAX 48
+
+struct MqttUpdate {
+  int16_t index;
+  YahooQuote quote;
+};
+
+static QueueHandle_t update_queue = nullptr;
+static volatile bool connected = false;
+
+// Task only
+static WiFiClient net;
+static PubSubClient mqtt(net);
+static char client_id[24];
+static uint32_t dropped = 0;
+
+// "189.25,187.10,51234567", volume optional
+static bool parse_payload(const uint8_t* payload, unsigned int length, YahooQuote* quote) {
+  char text[MQTT_PAYLOAD_MAX];
+  if (length == 0 || length >= sizeof(text)) return false;
+  memcpy(text, payload, length);
+  text[length] = '\0';
+
+  char* end;
+  quote->price = strtof(text, &end);
+  if (*end != ',') return false;
+  quote->prev_close = strtof(end + 1, &end);
+  quote->volume = *end == ',' ? strtoul(end + 1, nullptr, 10) : 0;
+  quote->market_time = 0; // Not in the payload
+  return quote->price > 0 && quote->prev_close > 0;
+}
+
+static void on_message(char* topic, uint8_t* payload, unsigned int length) {
+  const char* symbol = topic + strlen(MQTT_TOPIC_PREFIX);
+  if (strncmp(topic, MQTT_TOPIC_PREFIX, strlen(MQTT_TOPIC_PREFIX)) != 0) return;
+
+  MqttUpdate u;
+  if (!parse_payload(payload, length, &u.quote)) {
+    LOGW("MQTT: bad payload on %s", topic);
+    return;
+  }
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (strcmp(STOCK_SYMBOLS[i], symbol) != 0) continue;
+    u.index = i;
+    // The next message for the symbol brings it up to date again
+    if (xQueueSend(update_queue, &u, 0) != pdTRUE) dropped++;
+  }
+}
+
+static bool connect_and_subscribe() {
+  bool ok = strlen(MQTT_USER) > 0 ? mqtt.connect(client_id, MQTT_USER, MQTT_PASSWORD)
+                                  : mqtt.connect(client_id);
+  if (!ok) {
+    LOGW("MQTT: connect to %s failed, state %d", MQTT_HOST, mqtt.state());
+    return false;
+  }
+
+  char topic[MQTT_TOPIC_MAX];
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    snprintf(topic, sizeof(topic), "%s%s", MQTT_TOPIC_PREFIX, STOCK_SYMBOLS[i]);
+    if (!mqtt.subscribe(topic, MQTT_QOS)) {
+      LOGW("MQTT: subscribe to %s failed", topic);
+      mqtt.disconnect();
+      return false;
+    }
+  }
+  LOGI("MQTT: subscribed to %d symbols under %s", NUM_STOCKS, MQTT_TOPIC_PREFIX);
+  return true;
+}
+
+static void mqtt_task(void*) {
+  uint32_t reported_dropped = 0;
+  for (;;) {
+    if (WiFi.status() != WL_CONNECTED) {
+      connected = false;
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (!mqtt.connected()) {
+      connected = false;
+      if (!connect_and_subscribe()) {
+        vTaskDelay(pdMS_TO_TICKS(MQTT_RETRY_MS));
+        continue;
+      }
+      connected = true;
+    }
+
+    // Reads messages (running on_message) and sends the keepalive ping
+    mqtt.loop();
+    if (dropped != reported_dropped) {
+      LOGW("MQTT: main loop behind, %u quotes dropped", (unsigned)(dropped - reported_dropped));
+      reported_dropped = dropped;
+    }
+    vTaskDelay(pdMS_TO_TICKS(MQTT_LOOP_MS));
+  }
+}
+
+void mqtt_quotes_begin() {
+  snprintf(client_id, sizeof(client_id), "stock-tracker-%06x", (unsigned)(ESP.getEfuseMac() >> 24) & 0xFFFFFF);
+  mqtt.setServer(MQTT_HOST, MQTT_PORT);
+  mqtt.setCallback(on_message);
+  mqtt.setKeepAlive(MQTT_KEEPALIVE_SECONDS);
+
+  update_queue = xQueueCreate(MQTT_QUEUE_LENGTH, sizeof(MqttUpdate));
+  xTaskCreatePinnedToCore(mqtt_task, "mqtt", MQTT_TASK_STACK, nullptr,
+                          MQTT_TASK_PRIORITY, nullptr, MQTT_TASK_CORE);
+}
+
+bool mqtt_quotes_connected() {
+  return connected;
+}
+
+bool mqtt_quotes_poll(int* index, YahooQuote* quote) {
+  MqttUpdate u;
+  if (!update_queue || xQueueReceive(update_queue, &u, 0) != pdTRUE) return false;
+  *index = u.index;
+  *quote = u.quote;
+  return true;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef MQTT_QUOTES_H
+#define MQTT_QUOTES_H
+
+#include "yahoo_api.h"
+
+// MQTT quote source (QUOTE_SOURCE_MQTT). A task on core 0 stays connected
+// to the broker, subscribes to MQTT_TOPIC_PREFIX + symbol for every
+// watchlist symbol and parses each message as it comes in. Retained
+// messages give the current quotes right after connecting; after that only
+// publishes arrive, so nothing is polled. The main loop takes the quotes
+// from a queue, so the quote store is still only written from there.
+
+void mqtt_quotes_begin();
+
+// True while connected and subscribed
+bool mqtt_quotes_connected();
+
+// Take the next received quote for STOCK_SYMBOLS[*index]. Never blocks.
+bool mqtt_quotes_poll(int* index, YahooQuote* quote);
+
+#endif
@@ -0,0 +1,92 @@
+#include "ota_patch.h"
+#include "logging.h"
+
+#define OP_NONE 0
+#define OP_LITERAL 0x01
+#define OP_ADD 0x02
+#define PATCH_CHUNK 256 // Base bytes read back per step
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t header_size(uint8_t op) {
+  return op == OP_ADD ? 8 : 4;
+}
+
+void ota_patch_begin(OtaPatch* patch, OtaReadBase read_base, OtaWriteOut write_out) {
+  memset(patch, 0, sizeof(*patch));
+  patch->read_base = read_base;
+  patch->write_out = write_out;
+}
+
+// Returns the bytes used from data
+static size_t payload(OtaPatch* patch, const uint8_t* data, size_t len) {
+  size_t n = len < patch->remaining ? len : patch->remaining;
+
+  if (patch->op == OP_LITERAL) {
+    if (!patch->write_out(data, n)) patch->failed = true;
+  } else {
+    uint8_t out[PATCH_CHUNK];
+    for (size_t done = 0; done < n && !patch->failed;) {
+      size_t count = n - done < sizeof(out) ? n - done : sizeof(out);
+      if (!patch->read_base(patch->base_offset, out, count)) {
+        patch->failed = true;
+        break;
+      }
+      for (size_t i = 0; i < count; i++) {
+        out[i] += data[done + i];
+      }
+      if (!patch->write_out(out, count)) patch->failed = true;
+      patch->base_offset += count;
+      done += count;
+    }
+  }
+
+  patch->remaining -= n;
+  if (patch->remaining == 0) patch->op = OP_NONE;
+  return n;
+}
+
+bool ota_patch_feed(OtaPatch* patch, const uint8_t* data, size_t len) {
+  while (len > 0 && !patch->failed) {
+    if (patch->op == OP_NONE) {
+      patch->op = *data++;
+      len--;
+      patch->header_len = 0;
+      if (patch->op != OP_LITERAL && patch->op != OP_ADD) {
+        LOGW("OTA: bad delta operation 0x%02x", patch->op);
+        patch->failed = true;
+        break;
+      }
+      continue;
+    }
+
+    // Operation header, possibly split across calls
+    size_t need = header_size(patch->op);
+    if (patch->header_len < need) {
+      while (len > 0 && patch->header_len < need) {
+        patch->header[patch->header_len++] = *data++;
+        len--;
+      }
+      if (patch->header_len < need) break;
+      if (patch->op == OP_ADD) {
+        patch->base_offset = get32(patch->header);
+        patch->remaining = get32(patch->header + 4);
+      } else {
+        patch->remaining = get32(patch->header);
+      }
+      if (patch->remaining == 0) patch->op = OP_NONE;
+      continue;
+    }
+
+    size_t used = payload(patch, data, len);
+    data += used;
+    len -= used;
+  }
+  return !patch->failed;
+}
+
+bool ota_patch_complete(const OtaPatch* patch) {
+  return !patch->failed && patch->op == OP_NONE;
+}
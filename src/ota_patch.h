@@ -0,0 +1,40 @@
+#ifndef OTA_PATCH_H
+#define OTA_PATCH_H
+
+#include <Arduino.h>
+
+// Applies a firmware delta made by ota/ota_image.py. The delta is a
+// sequence of operations (little-endian):
+//
+//   0x01 LITERAL  u32 length, then length bytes of the new image
+//   0x02 ADD      u32 base offset, u32 length, then length bytes that are
+//                 added (mod 256) to the base image from that offset
+//
+// ADD is bsdiff's trick: moved code matches the base except where a few
+// addresses changed, so the added bytes are mostly zero and compress to
+// almost nothing. Input can be fed in pieces of any size as it is
+// inflated; the base is read back and the output written in small chunks.
+
+typedef bool (*OtaReadBase)(uint32_t offset, uint8_t* buf, size_t len);
+typedef bool (*OtaWriteOut)(const uint8_t* buf, size_t len);
+
+struct OtaPatch {
+  OtaReadBase read_base;
+  OtaWriteOut write_out;
+  uint8_t op;
+  uint8_t header[8];
+  uint8_t header_len;
+  uint32_t base_offset;
+  uint32_t remaining; // Payload bytes left in the current operation
+  bool failed;
+};
+
+void ota_patch_begin(OtaPatch* patch, OtaReadBase read_base, OtaWriteOut write_out);
+
+// False on a malformed delta or a failed read or write
+bool ota_patch_feed(OtaPatch* patch, const uint8_t* data, size_t len);
+
+// True if the delta ended cleanly between operations
+bool ota_patch_complete(const OtaPatch* patch);
+
+#endif
@@ -0,0 +1,377 @@
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include <esp32/rom/miniz.h> // The ROM's inflater, nothing to link
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "ota_update.h"
+#include "ota_patch.h"
+#include "quote_store.h"
+#include "logging.h"
+#include "../config.h"
+
+// The updater only exists when OTA is enabled
+#if OTA_ENABLED
+
+#define OTA_NVS_NAMESPACE "ota"
+#define OTA_TASK_STACK 8192
+#define OTA_TASK_PRIORITY 1
+#define OTA_TASK_CORE 0
+#define OTA_TIMEOUT_MS 15000
+#define OTA_READ_CHUNK 1024
+#define OTA_SECTOR_SIZE 4096
+#define OTA_FIRST_CHECK_MS 30000 // Leave the boot fetch alone
+// Inflater state plus its window and the sector buffer, all freed after
+#define OTA_HEAP_NEEDED (sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE + OTA_SECTOR_SIZE + 8192)
+
+// Update file header, written by ota/ota_image.py
+#define OTA_MAGIC 0x544F5453 // "STOT"
+#define OTA_VERSION 1
+#define OTA_HEADER_SIZE 96
+#define OTA_KIND_FULL 0
+#define OTA_KIND_DELTA 1
+
+struct OtaHeader {
+  uint8_t kind;
+  uint32_t image_size;
+  uint32_t payload_size;
+  uint8_t image_sha[32];
+  uint8_t base_digest[32];
+};
+
+static bool trial = false;           // Main loop only
+static unsigned long last_check = 0; // Main loop only
+static uint8_t rejected[32];         // SHA-256 of an image that was rolled back
+static bool has_rejected = false;
+static volatile bool running = false;
+
+// Task only
+static const esp_partition_t* base_part;
+static const esp_partition_t* target;
+static uint8_t* sector;
+static size_t sector_fill;
+static uint32_t sector_offset;
+static uint32_t written;
+static uint32_t image_size;
+static uint16_t sectors_total;
+static uint16_t sectors_written;
+static mbedtls_sha256_context sha;
+static OtaPatch patch;
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool parse_header(const uint8_t* h, OtaHeader* out) {
+  if (get32(h) != OTA_MAGIC || h[4] != OTA_VERSION || (h[6] | (h[7] << 8)) != OTA_HEADER_SIZE) return false;
+  out->kind = h[5];
+  out->image_size = get32(h + 8);
+  out->payload_size = get32(h + 12);
+  memcpy(out->image_sha, h + 16, 32);
+  memcpy(out->base_digest, h + 48, 32);
+  return out->kind == OTA_KIND_FULL || out->kind == OTA_KIND_DELTA;
+}
+
+// Sectors that already hold the right bytes (a retried or repeated update,
+// an unchanged tail) are neither erased nor written
+static bool flush_sector() {
+  if (sector_fill == 0) return true;
+  static uint8_t current[256];
+  bool same = true;
+  for (size_t done = 0; done < sector_fill && same; done += sizeof(current)) {
+    size_t n = sector_fill - done < sizeof(current) ? sector_fill - done : sizeof(current);
+    same = esp_partition_read(target, sector_offset + done, current, n) == ESP_OK &&
+           memcmp(current, sector + done, n) == 0;
+  }
+
+  sectors_total++;
+  if (!same) {
+    if (esp_partition_erase_range(target, sector_offset, OTA_SECTOR_SIZE) != ESP_OK ||
+        esp_partition_write(target, sector_offset, sector, sector_fill) != ESP_OK) {
+      LOGW("OTA: flash write failed at 0x%x", (unsigned)sector_offset);
+      return false;
+    }
+    sectors_written++;
+  }
+  sector_offset += OTA_SECTOR_SIZE;
+  sector_fill = 0;
+  return true;
+}
+
+static bool write_image(const uint8_t* data, size_t len) {
+  if (written + len > image_size) {
+    LOGW("OTA: image longer than announced");
+    return false;
+  }
+  mbedtls_sha256_update(&sha, data, len);
+  written += len;
+  while (len > 0) {
+    size_t n = OTA_SECTOR_SIZE - sector_fill < len ? OTA_SECTOR_SIZE - sector_fill : len;
+    memcpy(sector + sector_fill, data, n);
+    sector_fill += n;
+    data += n;
+    len -= n;
+    if (sector_fill == OTA_SECTOR_SIZE && !flush_sector()) return false;
+  }
+  return true;
+}
+
+static bool read_base(uint32_t offset, uint8_t* buf, size_t len) {
+  return offset + len <= base_part->size && esp_partition_read(base_part, offset, buf, len) == ESP_OK;
+}
+
+static bool read_exact(WiFiClient* stream, uint8_t* buf, size_t len) {
+  return stream->readBytes(buf, len) == len;
+}
+
+// Inflate the payload off the socket into the image, directly or through
+// the delta
+static bool receive(WiFiClient* stream, const OtaHeader& h) {
+  tinfl_decompressor* inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  uint8_t* window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  sector = (uint8_t*)malloc(OTA_SECTOR_SIZE);
+  bool ok = inflator && window && sector;
+  if (!ok) LOGW("OTA: not enough memory");
+
+  if (ok) tinfl_init(inflator);
+  ota_patch_begin(&patch, read_base, write_image);
+  uint8_t in[OTA_READ_CHUNK];
+  size_t in_len = 0, in_pos = 0, window_pos = 0;
+  uint32_t payload_left = h.payload_size;
+
+  while (ok) {
+    if (in_pos == in_len && payload_left > 0) {
+      in_len = payload_left < sizeof(in) ? payload_left : sizeof(in);
+      if (!read_exact(stream, in, in_len)) {
+        LOGW("OTA: download stalled");
+        ok = false;
+        break;
+      }
+      payload_left -= in_len;
+      in_pos = 0;
+    }
+
+    size_t in_bytes = in_len - in_pos;
+    size_t out_bytes = TINFL_LZ_DICT_SIZE - window_pos;
+    mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32 |
+                      (payload_left > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    tinfl_status status = tinfl_decompress(inflator, in + in_pos, &in_bytes, window,
+                                           window + window_pos, &out_bytes, flags);
+    in_pos += in_bytes;
+
+    if (out_bytes > 0) {
+      const uint8_t* out = window + window_pos;
+      ok = h.kind == OTA_KIND_DELTA ? ota_patch_feed(&patch, out, out_bytes) : write_image(out, out_bytes);
+      window_pos = (window_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+    if (status == TINFL_STATUS_DONE) break;
+    if (status < TINFL_STATUS_DONE ||
+        (status == TINFL_STATUS_NEEDS_MORE_INPUT && payload_left == 0 && in_pos == in_len)) {
+      LOGW("OTA: payload does not inflate (%d)", (int)status);
+      ok = false;
+    }
+  }
+
+  if (ok && h.kind == OTA_KIND_DELTA && !ota_patch_complete(&patch)) {
+    LOGW("OTA: delta ends mid-operation");
+    ok = false;
+  }
+  ok = ok && flush_sector();
+
+  free(inflator);
+  free(window);
+  free(sector);
+  sector = nullptr;
+  return ok;
+}
+
+static void save_trial(const OtaHeader& h) {
+  Preferences prefs;
+  prefs.begin(OTA_NVS_NAMESPACE, false);
+  prefs.putBool("trial", true);
+  prefs.putUChar("boots", 0);
+  prefs.putString("from", base_part->label);
+  prefs.putBytes("sha", h.image_sha, sizeof(h.image_sha));
+  prefs.end();
+}
+
+static void hex(const uint8_t* digest, char* out) {
+  for (int i = 0; i < 32; i++) sprintf(out + 2 * i, "%02x", digest[i]);
+}
+
+static bool update() {
+  base_part = esp_ota_get_running_partition();
+  target = esp_ota_get_next_update_partition(nullptr);
+  uint8_t digest[32];
+  if (!target || esp_partition_get_sha256(base_part, digest) != ESP_OK) {
+    LOGW("OTA: no partition to update into");
+    return false;
+  }
+
+  char url[sizeof(OTA_URL) + 80];
+  char digest_hex[65];
+  hex(digest, digest_hex);
+  snprintf(url, sizeof(url), "%s?current=%s", OTA_URL, digest_hex);
+
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.begin(url);
+  http.setTimeout(OTA_TIMEOUT_MS);
+  int code = http.GET();
+  if (code == HTTP_CODE_NO_CONTENT) {
+    LOGI("OTA: firmware is up to date");
+    http.end();
+    return false;
+  }
+  if (code != HTTP_CODE_OK) {
+    LOGW("OTA: update check failed: %d", code);
+    http.end();
+    return false;
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  stream->setTimeout(OTA_TIMEOUT_MS);
+  uint8_t raw[OTA_HEADER_SIZE];
+  OtaHeader h;
+  if (!read_exact(stream, raw, sizeof(raw)) || !parse_header(raw, &h)) {
+    LOGW("OTA: not an update file");
+    http.end();
+    return false;
+  }
+  if (has_rejected && memcmp(h.image_sha, rejected, 32) == 0) {
+    LOGI("OTA: offered the firmware that was rolled back, skipping");
+    http.end();
+    return false;
+  }
+  if (h.kind == OTA_KIND_DELTA && memcmp(h.base_digest, digest, 32) != 0) {
+    LOGW("OTA: delta is for different firmware");
+    http.end();
+    return false;
+  }
+  if (h.image_size > target->size) {
+    LOGW("OTA: image of %u bytes does not fit %s", (unsigned)h.image_size, target->label);
+    http.end();
+    return false;
+  }
+
+  LOGI("OTA: %s update, %u bytes for a %u byte image, into %s",
+       h.kind == OTA_KIND_DELTA ? "delta" : "full", (unsigned)(h.payload_size + OTA_HEADER_SIZE),
+       (unsigned)h.image_size, target->label);
+  unsigned long start = millis();
+  image_size = h.image_size;
+  written = 0;
+  sector_fill = 0;
+  sector_offset = 0;
+  sectors_total = sectors_written = 0;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+
+  bool ok = receive(stream, h);
+  http.end();
+
+  uint8_t sum[32];
+  mbedtls_sha256_finish(&sha, sum);
+  mbedtls_sha256_free(&sha);
+  if (ok && (written != h.image_size || memcmp(sum, h.image_sha, 32) != 0)) {
+    LOGW("OTA: image does not match its SHA-256");
+    ok = false;
+  }
+  // Checks the image structure and its own appended hash as well
+  if (ok && esp_ota_set_boot_partition(target) != ESP_OK) {
+    LOGW("OTA: image failed verification");
+    ok = false;
+  }
+  if (!ok) return false;
+
+  LOGI("OTA: done in %lu ms, %u of %u flash sectors rewritten", millis() - start,
+       sectors_written, sectors_total);
+  save_trial(h);
+  return true;
+}
+
+static void ota_task(void*) {
+  if (update()) {
+    LOGI("OTA: restarting into the new firmware");
+    log_flush(500);
+    ESP.restart();
+  }
+  running = false;
+  vTaskDelete(nullptr);
+}
+
+void ota_begin() {
+  Preferences prefs;
+  if (!prefs.begin(OTA_NVS_NAMESPACE, false)) return;
+  if (prefs.getBool("trial", false)) {
+    uint8_t boots = prefs.getUChar("boots", 0) + 1;
+    prefs.putUChar("boots", boots);
+    if (boots <= OTA_TRIAL_BOOTS) {
+      trial = true;
+      LOGI("OTA: new firmware on trial, boot %d of %d", boots, OTA_TRIAL_BOOTS);
+    } else {
+      String from = prefs.getString("from", "");
+      prefs.putBool("trial", false);
+      // Not to be installed again, until the server has something newer
+      prefs.getBytes("sha", rejected, sizeof(rejected));
+      prefs.putBytes("rejected", rejected, sizeof(rejected));
+      const esp_partition_t* previous =
+          esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, from.c_str());
+      if (previous && esp_ota_set_boot_partition(previous) == ESP_OK) {
+        LOGW("OTA: new firmware never confirmed, rolling back to %s", previous->label);
+        prefs.end();
+        log_flush(500);
+        ESP.restart();
+      }
+      LOGW("OTA: rollback failed, keeping this firmware");
+    }
+  }
+  has_rejected = prefs.getBytes("rejected", rejected, sizeof(rejected)) == sizeof(rejected);
+  prefs.end();
+}
+
+static void confirm() {
+  trial = false;
+  Preferences prefs;
+  prefs.begin(OTA_NVS_NAMESPACE, false);
+  prefs.putBool("trial", false);
+  prefs.end();
+  // Only does something with a bootloader built with rollback support
+  esp_ota_mark_app_valid_cancel_rollback();
+  LOGI("OTA: new firmware confirmed");
+}
+
+void ota_service() {
+  if (trial) {
+    // Quotes restored from the boot snapshot do not count, one has to be fetched
+    if (millis() > OTA_CONFIRM_SECONDS * 1000UL && quote_store_fresh_count() > 0) {
+      confirm();
+    } else if (millis() > OTA_TRIAL_MINUTES * 60000UL) {
+      // Runs but never gets a quote: count it as a failed boot, so it is
+      // rolled back after OTA_TRIAL_BOOTS of these rather than kept for good
+      LOGW("OTA: no quote fetched in %d minutes on trial, restarting", OTA_TRIAL_MINUTES);
+      log_flush(500);
+      ESP.restart();
+    }
+    return; // No further updates until this one has proved itself
+  }
+  if (running || WiFi.status() != WL_CONNECTED || millis() < OTA_FIRST_CHECK_MS) return;
+  if (last_check != 0 && millis() - last_check < OTA_CHECK_MINUTES * 60000UL) return;
+  last_check = millis();
+
+  if (ESP.getMaxAllocHeap() < TINFL_LZ_DICT_SIZE || ESP.getFreeHeap() < OTA_HEAP_NEEDED) {
+    LOGW("OTA: not enough memory for an update check");
+    return;
+  }
+  running = true;
+  xTaskCreatePinnedToCore(ota_task, "ota", OTA_TASK_STACK, nullptr,
+                          OTA_TASK_PRIORITY, nullptr, OTA_TASK_CORE);
+}
+
+bool ota_in_progress() {
+  return running;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+// Over-the-air updates from the local update server (ota/ota_server.py).
+//
+// Every OTA_CHECK_MINUTES the tracker asks OTA_URL for an update, sending
+// the digest of the firmware it runs. The server answers with a
+// zlib-compressed delta against exactly that firmware when it has it, or
+// the whole compressed image. A task inflates the answer as it downloads,
+// patches it against the running partition (see ota_patch.h) and writes
+// the result into the other OTA slot, skipping flash sectors that already
+// hold the right bytes. The image is checked against its SHA-256 and by
+// ESP-IDF's image verification before the tracker boots into it.
+//
+// The new firmware then runs on trial: if it has not fetched a quote and run
+// for OTA_CONFIRM_SECONDS within OTA_TRIAL_BOOTS boots (a crash loop, a WiFi
+// stack that never connects), the tracker goes back to the old one. A boot
+// that runs but gets no quote restarts after OTA_TRIAL_MINUTES, so it counts.
+
+// At boot, before anything that might crash: trial bookkeeping and rollback
+void ota_begin();
+
+// Event loop handler: confirms a trial firmware, starts update checks
+void ota_service();
+
+// True while an update is downloading
+bool ota_in_progress();
+
+#endif
@@ -0,0 +1,207 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_sleep.h>
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#include <driver/gpio.h>
+#include "power.h"
+#include "touch.h"
+#include "logging.h"
+#include "../config.h"
+
+// Rough ESP32-WROOM supply current per state with WiFi associated, from the
+// datasheet and typical measurements. Only used for the logged estimate.
+static const float STATE_MA[POWER_NUM_STATES] = {
+  150.0f, // Active: 240 MHz, radio receiving continuously
+  40.0f,  // Idle: 80 MHz, modem sleep between beacons
+  2.0f,   // Light sleep, waking for beacons
+};
+static const char* STATE_NAMES[POWER_NUM_STATES] = {"active", "idle", "sleep"};
+
+static PowerState current = POWER_ACTIVE;
+static unsigned long boost_until = 0;
+
+// Time spent in each state. Kept in microseconds; 64 bits so it does not
+// wrap after an hour and a bit.
+static uint64_t state_us[POWER_NUM_STATES];
+static uint32_t state_since_us = 0;
+static unsigned long last_report_ms = 0;
+
+#if POWER_LIGHT_SLEEP
+#define SLEEP_TOUCH_CHECK_MS 50 // Pen checks while light sleep is allowed, bounds the tap delay
+
+// With automatic light sleep the power management framework owns the CPU
+// clock, so these locks take the place of setCpuFrequencyMhz(): one holds
+// full speed, the other keeps the chip awake outside POWER_SLEEP
+static esp_pm_lock_handle_t full_speed_lock = nullptr;
+static esp_pm_lock_handle_t awake_lock = nullptr;
+static bool auto_sleep = false;
+#endif
+
+static void account() {
+  uint32_t now = micros();
+  state_us[current] += now - state_since_us;
+  state_since_us = now;
+}
+
+static void enter(PowerState state) {
+  if (state == current) return;
+  PowerState previous = current;
+  account();
+  current = state;
+
+#if POWER_LIGHT_SLEEP
+  if (auto_sleep) {
+    if (state == POWER_ACTIVE) esp_pm_lock_acquire(full_speed_lock);
+    if (previous == POWER_ACTIVE) esp_pm_lock_release(full_speed_lock);
+    if (state == POWER_SLEEP) esp_pm_lock_release(awake_lock);
+    if (previous == POWER_SLEEP) esp_pm_lock_acquire(awake_lock);
+    esp_wifi_set_ps(state == POWER_ACTIVE ? WIFI_PS_NONE : POWER_IDLE_MODEM_SLEEP);
+    return;
+  }
+#else
+  (void)previous;
+#endif
+
+  if (state == POWER_ACTIVE) {
+    setCpuFrequencyMhz(POWER_ACTIVE_MHZ);
+    esp_wifi_set_ps(WIFI_PS_NONE);
+  } else if (state == POWER_IDLE) {
+    // 80 MHz keeps the APB (and so the SPI and UART clocks) unchanged
+    setCpuFrequencyMhz(POWER_IDLE_MHZ);
+    esp_wifi_set_ps(POWER_IDLE_MODEM_SLEEP);
+  }
+}
+
+#if POWER_LIGHT_SLEEP
+// Automatic light sleep: FreeRTOS idles tickless, and the chip light-sleeps
+// whenever every task is blocked and no lock holds it awake. Unlike
+// esp_light_sleep_start(), this keeps the WiFi association: the driver
+// wakes the chip for the access point's beacons.
+static void light_sleep_begin() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t config = {POWER_ACTIVE_MHZ, POWER_IDLE_MHZ, true};
+#else
+  esp_pm_config_esp32_t config = {POWER_ACTIVE_MHZ, POWER_IDLE_MHZ, true};
+#endif
+  if (esp_pm_configure(&config) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "active", &full_speed_lock) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "awake", &awake_lock) != ESP_OK) {
+    LOGW("WARNING: Light sleep needs CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE, "
+         "using modem sleep only");
+    return;
+  }
+  // Starts out active and awake
+  esp_pm_lock_acquire(full_speed_lock);
+  esp_pm_lock_acquire(awake_lock);
+#if TOUCH_ENABLED
+  gpio_wakeup_enable((gpio_num_t)TOUCH_IRQ_PIN, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+#endif
+  auto_sleep = true;
+}
+
+// Let the chip sleep until the next timer is due or the screen is touched.
+// The main loop blocks meanwhile; the fetch and log tasks wake it as needed.
+static void light_sleep(uint32_t sleep_ms) {
+  if (sleep_ms > POWER_LIGHT_SLEEP_MAX_MS) sleep_ms = POWER_LIGHT_SLEEP_MAX_MS;
+
+  Serial.flush(); // The UART stops while asleep
+  enter(POWER_SLEEP);
+
+  unsigned long start = millis();
+  while (millis() - start < sleep_ms) {
+#if TOUCH_ENABLED
+    delay(SLEEP_TOUCH_CHECK_MS);
+    // The pen interrupt is an edge, which is missed while asleep
+    if (digitalRead(TOUCH_IRQ_PIN) == LOW) {
+      touch_wake();
+      boost_until = millis() + POWER_BOOST_MS;
+      break;
+    }
+#else
+    delay(sleep_ms);
+#endif
+  }
+
+  enter(POWER_IDLE);
+}
+#endif
+
+static void report() {
+  account();
+  LOGI("Power: %.0f%% active, %.0f%% idle, %.0f%% sleep, ~%.0f mA average (%u MHz now)",
+       power_duty_percent(POWER_ACTIVE), power_duty_percent(POWER_IDLE),
+       power_duty_percent(POWER_SLEEP), power_average_ma(),
+       (unsigned)getCpuFrequencyMhz());
+}
+
+void power_begin() {
+  for (int i = 0; i < POWER_NUM_STATES; i++) {
+    state_us[i] = 0;
+  }
+  current = POWER_ACTIVE;
+  state_since_us = micros();
+  last_report_ms = millis();
+#if POWER_LIGHT_SLEEP
+  light_sleep_begin();
+#endif
+  LOGI("Power saving on (idle at %d MHz%s)", POWER_IDLE_MHZ,
+       POWER_LIGHT_SLEEP ? ", light sleep between timers if available" : "");
+}
+
+void power_boost() {
+  boost_until = millis() + POWER_BOOST_MS;
+  enter(POWER_ACTIVE);
+}
+
+void power_update(bool busy, bool can_sleep, uint32_t next_due_ms) {
+  if (millis() - last_report_ms >= POWER_REPORT_SECONDS * 1000UL) {
+    last_report_ms = millis();
+    report();
+  }
+
+  // Stay up while anything is in flight or the WiFi link is being
+  // (re)established, modem sleep would only slow it down
+  if (busy || (int32_t)(boost_until - millis()) > 0 || WiFi.status() != WL_CONNECTED) {
+    enter(POWER_ACTIVE);
+    return;
+  }
+  enter(POWER_IDLE);
+
+#if POWER_LIGHT_SLEEP
+  if (auto_sleep && can_sleep && next_due_ms >= POWER_LIGHT_SLEEP_MIN_MS) {
+    light_sleep(next_due_ms);
+  }
+#else
+  (void)can_sleep;
+  (void)next_due_ms;
+#endif
+}
+
+float power_duty_percent(PowerState state) {
+  account();
+  uint64_t total = 0;
+  for (int i = 0; i < POWER_NUM_STATES; i++) {
+    total += state_us[i];
+  }
+  if (total == 0) return state == current ? 100.0f : 0.0f;
+  return 100.0f * (float)state_us[state] / (float)total;
+}
+
+float power_average_ma() {
+  float ma = 0;
+  for (int i = 0; i < POWER_NUM_STATES; i++) {
+    ma += STATE_MA[i] * power_duty_percent((PowerState)i) / 100.0f;
+  }
+  return ma;
+}
+
+PowerState power_state() {
+  return current;
+}
+
+const char* power_state_name(PowerState state) {
+  return STATE_NAMES[state];
+}
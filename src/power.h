@@ -0,0 +1,43 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// Power manager. The tracker is idle for most of each update interval, so
+// between fetches the CPU drops to 80 MHz and the radio to modem sleep.
+// Both go back to full speed while fetching, drawing or handling a touch.
+// Optionally (POWER_LIGHT_SLEEP) the chip light-sleeps between timers while
+// nothing on screen is moving, through the IDF's automatic light sleep so
+// the WiFi association is kept. It needs power management and tickless idle
+// in the sdkconfig.
+//
+// Time in each state is tracked and logged with an estimate of the average
+// current, based on typical ESP32-WROOM figures (backlight not included).
+
+enum PowerState {
+  POWER_ACTIVE, // 240 MHz, radio always on
+  POWER_IDLE,   // 80 MHz, modem sleep
+  POWER_SLEEP,  // Light sleep allowed, the radio wakes for beacons
+  POWER_NUM_STATES
+};
+
+void power_begin();
+
+// Stay at full speed for a moment, e.g. after a tap or when a fetch starts
+void power_boost();
+
+// Pick the state for this pass of the main loop. busy: work is in flight
+// (fetches, a touch). can_sleep: the screen is static, so light sleep would
+// not be visible. next_due_ms: time until the next timer needs the CPU.
+void power_update(bool busy, bool can_sleep, uint32_t next_due_ms);
+
+PowerState power_state();
+const char* power_state_name(PowerState state);
+
+// Share of time spent in a state since boot, in percent
+float power_duty_percent(PowerState state);
+
+// Estimated average current since boot, in mA
+float power_average_ma();
+
+#endif
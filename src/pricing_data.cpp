@@ -0,0 +1,128 @@
+#include "pricing_data.h"
+
+#define WIRE_VARINT 0
+#define WIRE_FIXED64 1
+#define WIRE_LENGTH 2
+#define WIRE_FIXED32 5
+
+static bool read_varint(const uint8_t** p, const uint8_t* end, uint64_t* value) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*p >= end) return false;
+    uint8_t b = *(*p)++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *value = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int64_t zigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static float fixed32_float(const uint8_t* p) {
+  uint32_t bits = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+bool pricing_decode(const uint8_t* data, size_t len, PricingData* out) {
+  memset(out, 0, sizeof(*out));
+  const uint8_t* p = data;
+  const uint8_t* end = data + len;
+
+  while (p < end) {
+    uint64_t key;
+    if (!read_varint(&p, end, &key)) return false;
+    uint32_t field = (uint32_t)(key >> 3);
+    uint8_t wire = key & 7;
+
+    if (wire == WIRE_VARINT) {
+      uint64_t v;
+      if (!read_varint(&p, end, &v)) return false;
+      if (field == 3) out->time_ms = zigzag(v);
+      else if (field == 9) out->day_volume = zigzag(v);
+    } else if (wire == WIRE_FIXED32) {
+      if (end - p < 4) return false;
+      float f = fixed32_float(p);
+      p += 4;
+      if (field == 2) out->price = f;
+      else if (field == 8) out->change_percent = f;
+      else if (field == 12) out->change = f;
+      else if (field == 16) out->previous_close = f;
+    } else if (wire == WIRE_LENGTH) {
+      uint64_t n;
+      if (!read_varint(&p, end, &n) || n > (uint64_t)(end - p)) return false;
+      if (field == 1) {
+        size_t copy = n < PRICING_ID_LEN - 1 ? n : PRICING_ID_LEN - 1;
+        memcpy(out->id, p, copy);
+        out->id[copy] = '\0';
+      }
+      p += n;
+    } else if (wire == WIRE_FIXED64) {
+      if (end - p < 8) return false;
+      p += 8;
+    } else {
+      return false; // Groups are not used by PricingData
+    }
+  }
+  return out->id[0] != '\0';
+}
+
+static int base64_value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+' || c == '-') return 62;
+  if (c == '/' || c == '_') return 63;
+  return -1;
+}
+
+// Decode into the same buffer; the output is always shorter than the
+// input, so it never overtakes the read position. Returns the byte count,
+// or -1 for a character outside the alphabet.
+static int base64_decode_in_place(char* text, size_t len) {
+  uint8_t* out = (uint8_t*)text;
+  size_t o = 0;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < len; i++) {
+    char c = text[i];
+    if (c == '=') break;
+    int v = base64_value(c);
+    if (v < 0) return -1;
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out[o++] = (uint8_t)(acc >> bits);
+    }
+  }
+  return (int)o;
+}
+
+bool pricing_parse_message(char* text, size_t len, PricingData* out) {
+  char* b64 = text;
+  size_t b64_len = len;
+
+  // Newer streamer versions wrap the payload in a small JSON object
+  if (len > 0 && text[0] == '{') {
+    const char* key = "\"message\"";
+    char* start = strstr(text, key);
+    if (!start) return false; // Another message type, nothing to decode
+    start += strlen(key);
+    while (*start == ' ' || *start == ':') start++;
+    if (*start++ != '"') return false;
+    char* stop = strchr(start, '"');
+    if (!stop) return false;
+    b64 = start;
+    b64_len = stop - start;
+  }
+
+  int n = base64_decode_in_place(b64, b64_len);
+  return n > 0 && pricing_decode((const uint8_t*)b64, n, out);
+}
@@ -0,0 +1,35 @@
+#ifndef PRICING_DATA_H
+#define PRICING_DATA_H
+
+#include <Arduino.h>
+
+// Decoder for the messages of Yahoo's quote streamer. Each one is a
+// base64-encoded protobuf PricingData, either as the whole text message or
+// wrapped as {"type":"pricing","message":"<base64>"}. Only the fields the
+// tracker uses are read; the rest are skipped by wire type.
+//
+//   1 id             string     8 changePercent  float
+//   2 price          float      9 dayVolume      sint64
+//   3 time           sint64 ms 12 change         float
+//                              16 previousClose  float
+
+#define PRICING_ID_LEN 16
+
+struct PricingData {
+  char id[PRICING_ID_LEN];  // Symbol, truncated if longer
+  float price;
+  float change;
+  float change_percent;
+  float previous_close;     // 0 if the message has none
+  int64_t time_ms;
+  int64_t day_volume;
+};
+
+// Decode one protobuf message
+bool pricing_decode(const uint8_t* data, size_t len, PricingData* out);
+
+// Decode one streamer text message. Works in place: text is overwritten
+// with the decoded bytes.
+bool pricing_parse_message(char* text, size_t len, PricingData* out);
+
+#endif
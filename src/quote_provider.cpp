@@ -0,0 +1,144 @@
+#include "quote_provider.h"
+#include "stooq_api.h"
+#include "logging.h"
+#include "../config.h"
+
+#define HEALTH_ALPHA 0.2f        // Weight of the newest sample in the rolling numbers
+#define HEALTH_ERROR_WEIGHT 10.0f // A 10% error rate counts as double the latency
+#define HEALTH_MAX_BENCH_CYCLES 32
+#define HEALTH_NEVER_WORKED 1e9f
+#define HEALTH_IDLE_DECAY 0.9f    // Old errors fade each cycle a provider sits out
+
+static int fetch_yahoo_chart(const char* const* symbols, int count,
+                             YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  ok[0] = yahoo_fetch_quote(symbols[0], &quotes[0], status);
+  return ok[0] ? 1 : 0;
+}
+
+static const QuoteProvider providers[PROVIDER_COUNT] = {
+  {"yahoo_chart", PROVIDER_YAHOO_CHART_ENABLED, 1, FETCH_SPACING_MS, fetch_yahoo_chart},
+  {"yahoo_quote", PROVIDER_YAHOO_QUOTE_ENABLED, PROVIDER_BATCH_MAX, FETCH_SPACING_MS, yahoo_fetch_quotes},
+  {"stooq", PROVIDER_STOOQ_ENABLED, PROVIDER_BATCH_MAX, FETCH_SPACING_MS, stooq_fetch_quotes},
+};
+
+// Main loop only, apart from current
+static ProviderHealth health[PROVIDER_COUNT];
+static uint32_t cycle = 0;
+static volatile int current = PROVIDER_YAHOO_CHART;
+
+const QuoteProvider& quote_provider(int id) {
+  return providers[id];
+}
+
+const ProviderHealth& quote_provider_health(int id) {
+  return health[id];
+}
+
+int quote_provider_current() {
+  return current;
+}
+
+// Lower is better. Providers not tried yet come first, so every enabled
+// one has numbers after the first few cycles; one that has never returned
+// a quote comes last.
+static float score(int id) {
+  const ProviderHealth& h = health[id];
+  if (h.requests == 0) return 0;
+  if (h.latency_ms == 0) return HEALTH_NEVER_WORKED;
+  return h.latency_ms * (1 + HEALTH_ERROR_WEIGHT * h.error_rate);
+}
+
+// Best enabled provider that is not benched or in the exclude mask, -1 if none
+static int best_of(uint8_t exclude) {
+  int best = -1;
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    if (!providers[id].enabled || (exclude & (1 << id)) || health[id].benched_until > cycle) continue;
+    if (best < 0 || score(id) < score(best)) best = id;
+  }
+  return best;
+}
+
+static int pick() {
+  int best = best_of(0);
+  if (best >= 0) return best;
+
+  // All benched: the one that comes back first
+  int soonest = -1;
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    if (!providers[id].enabled) continue;
+    if (soonest < 0 || health[id].benched_until < health[soonest].benched_until) soonest = id;
+  }
+  return soonest >= 0 ? soonest : PROVIDER_YAHOO_CHART;
+}
+
+int quote_provider_fallback(uint8_t tried) {
+  return best_of(tried);
+}
+
+// The provider picked least recently, so a slower one that has recovered
+// gets measured again now and then
+static int probe() {
+  int oldest = -1;
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    if (!providers[id].enabled || health[id].benched_until > cycle) continue;
+    if (oldest < 0 || health[id].last_cycle < health[oldest].last_cycle) oldest = id;
+  }
+  return oldest;
+}
+
+static void use(int id, const char* why) {
+  if (id != current) {
+    LOGI("Quotes now from %s (%s)", providers[id].name, why);
+  }
+  current = id;
+  health[id].last_cycle = cycle;
+}
+
+void quote_provider_begin_cycle() {
+  cycle++;
+  // A provider that recovered gets tried again once its errors have faded,
+  // rather than only when the one in use fails
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    if (id != current && health[id].benched_until <= cycle) health[id].error_rate *= HEALTH_IDLE_DECAY;
+  }
+  int id = pick();
+  if (PROVIDER_PROBE_CYCLES > 0 && cycle % PROVIDER_PROBE_CYCLES == 0) {
+    int p = probe();
+    if (p >= 0 && p != id) {
+      use(p, "probe");
+      return;
+    }
+  }
+  use(id, "healthiest");
+}
+
+void quote_provider_record(int id, const FetchStatus& status) {
+  if (id < 0 || id >= PROVIDER_COUNT || status.batch == 0) return;
+  ProviderHealth& h = health[id];
+
+  // The first samples count fully, so a new provider is not judged by zeros
+  h.requests++;
+  float alpha = h.requests < 1 / HEALTH_ALPHA ? 1.0f / h.requests : HEALTH_ALPHA;
+  float missing = 1.0f - (float)status.received / status.batch;
+  h.error_rate += alpha * (missing - h.error_rate);
+  if (status.received > 0) {
+    float latency_ms = status.latency_us / 1000.0f / status.batch;
+    h.latency_ms = h.latency_ms == 0 ? latency_ms : h.latency_ms + HEALTH_ALPHA * (latency_ms - h.latency_ms);
+    h.failures_in_row = 0;
+    return;
+  }
+
+  h.failures++;
+  if (h.failures_in_row < 255) h.failures_in_row++;
+  if (h.failures_in_row % PROVIDER_FAILOVER_ERRORS != 0) return;
+
+  // Benched for 2, 4, 8 ... cycles while it keeps failing
+  int n = h.failures_in_row / PROVIDER_FAILOVER_ERRORS;
+  uint32_t bench = n >= 5 ? HEALTH_MAX_BENCH_CYCLES : 1u << n;
+  h.benched_until = cycle + bench;
+  LOGW("Provider %s failed %d times in a row, benched for %u cycles",
+       providers[id].name, h.failures_in_row, (unsigned)bench);
+
+  // The rest of this cycle goes elsewhere
+  if (id == current) use(pick(), "failover");
+}
@@ -0,0 +1,69 @@
+#ifndef QUOTE_PROVIDER_H
+#define QUOTE_PROVIDER_H
+
+#include "yahoo_api.h"
+
+// Quote providers and the router that picks one for each fetch cycle.
+//
+// Every provider fetches a batch of symbols in one call (the per-symbol
+// ones take batches of one) with the same signature as the aggregator
+// client. The router keeps a rolling latency and error rate for each
+// provider and sends each cycle to the healthiest one. A provider that
+// fails several times in a row is benched for a growing number of cycles,
+// and the cycle carries on with the next best straight away.
+//
+// The health numbers are only touched from the main loop (each request is
+// recorded when its first result is applied); the fetch task only reads
+// which provider is current.
+
+#define PROVIDER_BATCH_MAX 16
+
+enum ProviderId {
+  PROVIDER_YAHOO_CHART,  // v8 chart endpoint, one symbol per request
+  PROVIDER_YAHOO_QUOTE,  // v7 quote endpoint, a batch per request
+  PROVIDER_STOOQ,        // Stooq CSV, a batch per request
+  PROVIDER_COUNT
+};
+
+// Fill quotes[i] and ok[i] for count symbols (at most batch_max); status
+// describes the one request. Returns the number of quotes received. Blocks,
+// so it is only called from the fetch task.
+typedef int (*ProviderFetch)(const char* const* symbols, int count,
+                             YahooQuote* quotes, bool* ok, FetchStatus* status);
+
+struct QuoteProvider {
+  const char* name;
+  bool enabled;         // Set in config.h
+  uint8_t batch_max;
+  uint16_t spacing_ms;  // Pause after each request (rate limiting)
+  ProviderFetch fetch;
+};
+
+struct ProviderHealth {
+  float latency_ms;    // Rolling, per symbol, requests that got quotes only
+  float error_rate;    // Rolling share of symbols without a quote, 0..1
+  uint32_t requests;   // Since boot
+  uint32_t failures;   // Requests that got no quote at all
+  uint8_t failures_in_row;
+  uint32_t benched_until; // Cycle number
+  uint32_t last_cycle;    // Last cycle it was picked for
+};
+
+const QuoteProvider& quote_provider(int id);
+
+// Main loop: pick the provider for a new fetch cycle
+void quote_provider_begin_cycle();
+
+// Main loop: one finished request to provider id
+void quote_provider_record(int id, const FetchStatus& status);
+
+// Provider the fetch task should use for the next request
+int quote_provider_current();
+
+// Main loop: the best provider to retry a symbol with after the providers in
+// the tried mask (bit 1 << id) had no quote for it, -1 if there is none left
+int quote_provider_fallback(uint8_t tried);
+
+const ProviderHealth& quote_provider_health(int id);
+
+#endif
@@ -0,0 +1,192 @@
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "quote_push.h"
+#include "logging.h"
+#include "../config.h"
+#include "../include/quote_wire.h"
+
+#define PUSH_TASK_STACK 4096
+#define PUSH_TASK_PRIORITY 1
+#define PUSH_TASK_CORE 0 // Next to the fetch task, away from the main loop
+#define PUSH_QUEUE_LENGTH (NUM_STOCKS + 4) // A whole snapshot
+#define PUSH_CONNECT_TIMEOUT_MS 3000
+#define PUSH_RETRY_MS 10000      // Between connection attempts
+#define PUSH_IDLE_TIMEOUT_MS 45000 // Three missed heartbeats from the aggregator
+#define PUSH_FRAME_TIMEOUT_MS 5000 // Rest of a frame once its header is in
+#define PUSH_READ_POLL_MS 20
+
+struct PushUpdate {
+  int16_t index;
+  YahooQuote quote;
+};
+
+static QueueHandle_t update_queue = nullptr;
+static volatile bool live = false;
+// Symbols in the last snapshot. The aggregator leaves out what it does not
+// take (past its per-request limit, or invalid); those are still polled.
+static volatile bool accepted[NUM_STOCKS];
+
+// Task only
+static uint8_t frame[QUOTE_WIRE_FRAME_SIZE(NUM_STOCKS)];
+static uint32_t ids[NUM_STOCKS];
+
+static bool read_exact(WiFiClient& client, uint8_t* buf, size_t len, uint32_t timeout_ms) {
+  uint32_t start = millis();
+  size_t got = 0;
+  while (got < len) {
+    int n = client.available() ? client.read(buf + got, len - got) : 0;
+    if (n > 0) {
+      got += n;
+      continue;
+    }
+    if (!client.connected() || millis() - start > timeout_ms) return false;
+    vTaskDelay(pdMS_TO_TICKS(PUSH_READ_POLL_MS));
+  }
+  return true;
+}
+
+static void subscribe(WiFiClient& client) {
+  client.print("SUBSCRIBE symbols=");
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (i) client.print(",");
+    client.print(STOCK_SYMBOLS[i]);
+  }
+  client.print("\n");
+}
+
+// A snapshot lists every symbol the aggregator took, in order
+static void note_accepted(uint16_t records) {
+  int taken = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    bool found = false;
+    for (int r = 0; r < records && !found; r++) {
+      QuoteWireRecord rec;
+      quote_wire_get_record(frame, r, &rec);
+      found = rec.symbol_id == ids[i];
+    }
+    accepted[i] = found;
+    taken += found;
+  }
+  if (taken < NUM_STOCKS) {
+    LOGW("WARNING: Push: the aggregator took %d of %d symbols, polling the rest", taken, NUM_STOCKS);
+  }
+}
+
+// Hand the records of a checked frame to the main loop. Returns false if
+// the queue overflowed, then the state is only good after a snapshot.
+static bool deliver(uint16_t records) {
+  bool complete = true;
+  for (int r = 0; r < records; r++) {
+    QuoteWireRecord rec;
+    quote_wire_get_record(frame, r, &rec);
+    if (!(rec.flags & QUOTE_WIRE_VALID)) continue;
+
+    for (int i = 0; i < NUM_STOCKS; i++) {
+      if (ids[i] != rec.symbol_id) continue;
+      PushUpdate u;
+      u.index = i;
+      u.quote.price = quote_wire_value(rec.price, rec.decimals);
+      u.quote.prev_close = quote_wire_value(rec.prev_close, rec.decimals);
+      u.quote.volume = rec.volume;
+      u.quote.market_time = rec.market_time;
+      if (u.quote.price > 0 && u.quote.prev_close > 0 &&
+          xQueueSend(update_queue, &u, 0) != pdTRUE) {
+        complete = false;
+      }
+    }
+  }
+  return complete;
+}
+
+// Read frames until the connection drops or goes quiet
+static void receive(WiFiClient& client) {
+  bool synced = false;
+  uint32_t expected = 0;
+
+  for (;;) {
+    if (!read_exact(client, frame, QUOTE_WIRE_HEADER_SIZE, PUSH_IDLE_TIMEOUT_MS)) return;
+    uint16_t count = quote_wire_get16(frame + 4);
+    if (quote_wire_get16(frame) != QUOTE_WIRE_MAGIC || count > NUM_STOCKS) {
+      LOGW("Push: bad frame header, reconnecting");
+      return;
+    }
+    if (!read_exact(client, frame + QUOTE_WIRE_HEADER_SIZE, count * QUOTE_WIRE_RECORD_SIZE,
+                    PUSH_FRAME_TIMEOUT_MS)) {
+      return;
+    }
+
+    // A corrupt frame means the stream can not be trusted to stay in step
+    uint16_t records;
+    QuoteWireError error = quote_wire_check(frame, QUOTE_WIRE_FRAME_SIZE(count), &records);
+    if (error != QUOTE_WIRE_OK) {
+      LOGW("Push: frame rejected (error %d), reconnecting", (int)error);
+      return;
+    }
+
+    uint32_t seq = quote_wire_sequence(frame);
+    if (quote_wire_frame_flags(frame) & QUOTE_WIRE_SNAPSHOT) {
+      note_accepted(records);
+      synced = true;
+    } else if (synced && seq != expected) {
+      LOGI("Push: expected frame %u, got %u, resyncing", (unsigned)expected, (unsigned)seq);
+      synced = false;
+      client.print("RESYNC\n");
+    }
+    expected = seq + 1;
+
+    if (synced && !deliver(records)) {
+      LOGI("Push: main loop behind, resyncing");
+      synced = false;
+      client.print("RESYNC\n");
+    }
+    live = synced;
+  }
+}
+
+static void push_task(void*) {
+  WiFiClient client;
+  for (;;) {
+    if (WiFi.status() != WL_CONNECTED) {
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (client.connect(AGGREGATOR_HOST, AGGREGATOR_PUSH_PORT, PUSH_CONNECT_TIMEOUT_MS)) {
+      LOGI("Push: subscribed to the aggregator");
+      client.setNoDelay(true);
+      subscribe(client);
+      receive(client);
+      live = false;
+      client.stop();
+      LOGW("Push: connection lost, polling until it is back");
+    }
+    vTaskDelay(pdMS_TO_TICKS(PUSH_RETRY_MS));
+  }
+}
+
+void quote_push_begin() {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    ids[i] = quote_wire_symbol_id(STOCK_SYMBOLS[i]);
+  }
+  update_queue = xQueueCreate(PUSH_QUEUE_LENGTH, sizeof(PushUpdate));
+  xTaskCreatePinnedToCore(push_task, "push", PUSH_TASK_STACK, nullptr,
+                          PUSH_TASK_PRIORITY, nullptr, PUSH_TASK_CORE);
+}
+
+bool quote_push_live() {
+  return live;
+}
+
+bool quote_push_covers(int index) {
+  return live && accepted[index];
+}
+
+bool quote_push_poll(int* index, YahooQuote* quote) {
+  PushUpdate u;
+  if (!update_queue || xQueueReceive(update_queue, &u, 0) != pdTRUE) return false;
+  *index = u.index;
+  *quote = u.quote;
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef QUOTE_PUSH_H
+#define QUOTE_PUSH_H
+
+#include "yahoo_api.h"
+
+// Push subscription to the quote aggregator. A task on core 0 keeps one TCP
+// connection open, registers the watchlist once and receives binary frames
+// (include/quote_wire.h): a snapshot of every symbol, then only the quotes
+// that changed, as soon as the aggregator has them. Frames are numbered; on
+// a gap the task asks for a fresh snapshot and ignores deltas until it
+// arrives. The main loop takes the quotes from a queue, so the quote store
+// is still only written from there.
+
+void quote_push_begin();
+
+// True while the subscription is connected and in sync
+bool quote_push_live();
+
+// True while STOCK_SYMBOLS[index] is pushed, so it need not be polled. The
+// aggregator takes a limited number of symbols per subscription.
+bool quote_push_covers(int index);
+
+// Take the next pushed quote for STOCK_SYMBOLS[*index]. Never blocks.
+bool quote_push_poll(int* index, YahooQuote* quote);
+
+#endif
@@ -0,0 +1,222 @@
+#include <Preferences.h>
+#include <time.h>
+#include "quote_snapshot.h"
+#include "quote_store.h"
+#include "logging.h"
+#include "../config.h"
+
+#define SNAPSHOT_NVS_NAMESPACE "quotes"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_MAGIC 0x51534E50 // "QSNP"
+
+// NVS holds the entries as blobs of up to this many, keys "e0", "e1", ...,
+// so reading a snapshot from a longer watchlist needs no bigger buffer
+#define SNAPSHOT_CHUNK_ENTRIES 32
+#define SNAPSHOT_CHUNKS ((NUM_STOCKS + SNAPSHOT_CHUNK_ENTRIES - 1) / SNAPSHOT_CHUNK_ENTRIES)
+#define SNAPSHOT_MAX_CHUNKS 64 // Keys looked at when clearing old ones
+
+struct SnapshotEntry {
+  uint32_t symbol_hash; // Matches entries to symbols if the watchlist changes
+  int32_t price_cents;  // 0 = no quote
+  int32_t prev_close_cents;
+  uint32_t quote_time;  // Unix time, 0 if the clock was not set yet
+};
+
+struct RtcSnapshot {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t checksum; // Over entries, RTC memory is not cleared on reset
+  SnapshotEntry entries[NUM_STOCKS];
+};
+
+// Not zeroed at boot, so it still holds the last quotes after a reset
+static RTC_NOINIT_ATTR RtcSnapshot rtc_snapshot;
+
+// What is in NVS right now, to skip writes that would change nothing
+static SnapshotEntry saved[NUM_STOCKS];
+static bool saved_valid = false;
+static unsigned long last_write_ms = 0;
+static bool written_since_boot = false;
+
+static uint32_t restored_time = 0;
+
+// FNV-1a, used for both the symbol hashes and the RTC checksum
+static uint32_t fnv1a(const void* data, size_t len, uint32_t hash = 2166136261u) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t symbol_hash(const char* symbol) {
+  return fnv1a(symbol, strlen(symbol));
+}
+
+static void chunk_key(char* key, int chunk) {
+  snprintf(key, 8, "e%d", chunk);
+}
+
+static bool rtc_valid() {
+  return rtc_snapshot.magic == SNAPSHOT_MAGIC &&
+         rtc_snapshot.version == SNAPSHOT_VERSION &&
+         rtc_snapshot.checksum == fnv1a(rtc_snapshot.entries, sizeof(rtc_snapshot.entries));
+}
+
+// Read the NVS copy into saved[]. Entries are matched by symbol so edits to
+// the watchlist keep whatever quotes still apply.
+static int load_nvs() {
+  memset(saved, 0, sizeof(saved));
+  saved_valid = true;
+
+  Preferences prefs;
+  if (!prefs.begin(SNAPSHOT_NVS_NAMESPACE, true)) return 0;
+
+  int chunks = 0;
+  if (prefs.getUChar("ver", 0) == SNAPSHOT_VERSION) {
+    chunks = prefs.getUChar("chunks", 0);
+  } else if (prefs.isKey("ver")) {
+    LOGW("Quote snapshot in NVS is from an older build, ignoring it");
+  }
+
+  static SnapshotEntry stored[SNAPSHOT_CHUNK_ENTRIES];
+  int restored = 0;
+  for (int c = 0; c < chunks; c++) {
+    char key[8];
+    chunk_key(key, c);
+    size_t len = prefs.getBytesLength(key);
+    if (len == 0 || len % sizeof(SnapshotEntry) != 0 || len > sizeof(stored)) continue;
+    int count = prefs.getBytes(key, stored, len) / sizeof(SnapshotEntry);
+
+    for (int k = 0; k < count; k++) {
+      for (int i = 0; i < NUM_STOCKS; i++) {
+        if (saved[i].symbol_hash == 0 && stored[k].symbol_hash == symbol_hash(STOCK_SYMBOLS[i])) {
+          saved[i] = stored[k];
+          restored++;
+          break;
+        }
+      }
+    }
+  }
+  prefs.end();
+  return restored;
+}
+
+static void fill_entries(SnapshotEntry* entries) {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    const StockData& s = stocks[i];
+    SnapshotEntry& e = entries[i];
+    e.symbol_hash = symbol_hash(s.symbol);
+    e.price_cents = s.valid ? (int32_t)lroundf(s.price * 100) : 0;
+    e.prev_close_cents = s.valid ? (int32_t)lroundf((s.price - s.change) * 100) : 0;
+    e.quote_time = s.valid ? s.quote_time : 0;
+  }
+}
+
+int quote_snapshot_restore() {
+  int nvs_count = load_nvs();
+
+  // RTC memory only holds something after a reset without power loss, and is
+  // then at least as new as NVS
+  const SnapshotEntry* source = saved;
+  if (rtc_valid()) {
+    source = rtc_snapshot.entries;
+    LOGI("Restoring quotes from RTC memory");
+  } else if (nvs_count > 0) {
+    LOGI("Restoring %d quotes from NVS", nvs_count);
+  }
+
+  int restored = 0;
+  restored_time = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    const SnapshotEntry& e = source[i];
+    if (e.symbol_hash != symbol_hash(STOCK_SYMBOLS[i])) continue;
+    if (e.price_cents <= 0 || e.prev_close_cents <= 0) continue;
+
+    quote_store_restore(i, e.price_cents / 100.0f, e.prev_close_cents / 100.0f, e.quote_time);
+    if (e.quote_time > restored_time) restored_time = e.quote_time;
+    restored++;
+  }
+  return restored;
+}
+
+void quote_snapshot_save() {
+  static SnapshotEntry current[NUM_STOCKS];
+  fill_entries(current);
+
+  // RTC memory does not wear, keep it current
+  memcpy(rtc_snapshot.entries, current, sizeof(current));
+  rtc_snapshot.magic = SNAPSHOT_MAGIC;
+  rtc_snapshot.version = SNAPSHOT_VERSION;
+  rtc_snapshot.checksum = fnv1a(rtc_snapshot.entries, sizeof(rtc_snapshot.entries));
+
+  if (!saved_valid) load_nvs();
+
+  // Only prices count as a change; a newer quote time alone is not worth a
+  // flash write
+  bool changed = false;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (current[i].symbol_hash != saved[i].symbol_hash ||
+        current[i].price_cents != saved[i].price_cents ||
+        current[i].prev_close_cents != saved[i].prev_close_cents) {
+      changed = true;
+      break;
+    }
+  }
+  if (!changed) return;
+
+  // The first change after boot is written straight away, later ones are
+  // batched
+  if (written_since_boot && millis() - last_write_ms < SNAPSHOT_SAVE_MINUTES * 60000UL) return;
+
+  Preferences prefs;
+  if (!prefs.begin(SNAPSHOT_NVS_NAMESPACE, false)) {
+    LOGE("ERROR: Could not open NVS for the quote snapshot");
+    return;
+  }
+  size_t written = 0;
+  for (int c = 0; c < SNAPSHOT_CHUNKS; c++) {
+    char key[8];
+    chunk_key(key, c);
+    int first = c * SNAPSHOT_CHUNK_ENTRIES;
+    int count = NUM_STOCKS - first < SNAPSHOT_CHUNK_ENTRIES ? NUM_STOCKS - first : SNAPSHOT_CHUNK_ENTRIES;
+    written += prefs.putBytes(key, &current[first], count * sizeof(SnapshotEntry));
+  }
+  // Chunks left over from a longer watchlist
+  for (int c = SNAPSHOT_CHUNKS; c < SNAPSHOT_MAX_CHUNKS; c++) {
+    char key[8];
+    chunk_key(key, c);
+    if (!prefs.isKey(key)) break;
+    prefs.remove(key);
+  }
+  prefs.remove("entries"); // Single blob of SNAPSHOT_VERSION 1
+  prefs.putUChar("chunks", SNAPSHOT_CHUNKS);
+  prefs.putUChar("ver", SNAPSHOT_VERSION);
+  prefs.end();
+
+  if (written == sizeof(current)) {
+    memcpy(saved, current, sizeof(current));
+    last_write_ms = millis();
+    written_since_boot = true;
+    LOGI("Quote snapshot saved to NVS (%u bytes)", (unsigned)written);
+  } else {
+    LOGE("ERROR: Quote snapshot write failed");
+  }
+}
+
+uint32_t quote_snapshot_time() {
+  return restored_time;
+}
+
+void quote_snapshot_format_time(char* buf, size_t len) {
+  buf[0] = '\0';
+  if (restored_time == 0) return;
+
+  // The time zone is not configured yet this early, apply the offset by hand
+  time_t local = (time_t)restored_time + TIMEZONE_OFFSET * 3600;
+  struct tm t;
+  if (gmtime_r(&local, &t)) {
+    strftime(buf, len, "%b %d %H:%M", &t);
+  }
+}
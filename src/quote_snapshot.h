@@ -0,0 +1,31 @@
+#ifndef QUOTE_SNAPSHOT_H
+#define QUOTE_SNAPSHOT_H
+
+#include <Arduino.h>
+
+// Last-known quotes kept across resets so the table can be drawn at boot,
+// before WiFi is up. Each symbol is a 16 byte record (symbol hash, price and
+// previous close in cents, quote time).
+//
+// Two copies are kept. The RTC memory copy is refreshed after every fetch and
+// survives software resets and crashes. The NVS copy survives power cycles;
+// it is only rewritten when a price actually changed, and at most once every
+// SNAPSHOT_SAVE_MINUTES, to keep flash wear down. Both are matched to the
+// watchlist by symbol, so quotes survive symbols being added or removed.
+
+// Restore the newest valid snapshot into the quote store. Restored quotes
+// are marked stale until a fresh quote replaces them. Returns the number of
+// symbols restored.
+int quote_snapshot_restore();
+
+// Record the current quotes. Call after each fetch.
+void quote_snapshot_save();
+
+// Quote time of the newest restored quote (Unix time, 0 if unknown)
+uint32_t quote_snapshot_time();
+
+// Short local time of the newest restored quote for the status line, e.g.
+// "Mar 4 15:59". Works before NTP sync. Empty if the time is unknown.
+void quote_snapshot_format_time(char* buf, size_t len);
+
+#endif
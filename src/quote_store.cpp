@@ -0,0 +1,176 @@
+#include <time.h>
+#include "quote_store.h"
+#include "sparkline.h"
+#include "indicators.h"
+
+StockData stocks[NUM_STOCKS];
+
+void quote_store_init() {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    stocks[i].symbol = STOCK_SYMBOLS[i];
+    stocks[i].name = STOCK_NAMES[i];
+    stocks[i].price = 0.0;
+    stocks[i].change = 0.0;
+    stocks[i].change_percent = 0.0;
+    stocks[i].valid = false;
+    stocks[i].changed = false;
+    stocks[i].stale = false;
+    stocks[i].exchange_timed = false;
+    stocks[i].quote_time = 0;
+  }
+
+#if SPARKLINES_ENABLED
+  sparkline_init();
+#endif
+  indicators_init();
+}
+
+#if INDICATOR_COLUMN != INDICATOR_NONE
+// Value shown in the indicator column, NAN while it is warming up
+static float indicator_column_value(int index) {
+  float value;
+  return indicators_get(index, INDICATOR_COLUMN, &value) ? value : NAN;
+}
+#endif
+
+// Before NTP sync the clock is still near 1970
+static bool clock_set(time_t now) {
+  return now > 1600000000;
+}
+
+static bool too_old(const StockData& s, time_t now) {
+  return s.exchange_timed && clock_set(now) && now - (time_t)s.quote_time > QUOTE_MAX_AGE_SECONDS &&
+         quote_store_market_open();
+}
+
+bool quote_store_apply(int index, float price, float prev_close, uint32_t day_volume,
+                       uint32_t market_time) {
+  StockData& s = stocks[index];
+
+  float change = price - prev_close;
+  float change_percent = (change / prev_close) * 100;
+
+  // Check if data changed (always true on first time when valid=false)
+  bool data_changed = true;
+  if (s.valid && !s.stale) {
+    data_changed = (abs(s.price - price) > 0.01 ||
+                    abs(s.change_percent - change_percent) > 0.01);
+  }
+
+#if INDICATOR_COLUMN != INDICATOR_NONE
+  // The indicator moves even when the price repeats, so it counts as a change
+  float shown = indicator_column_value(index);
+  indicators_update(index, price, prev_close, day_volume);
+  float now = indicator_column_value(index);
+  if (isnan(shown) != isnan(now) || abs(shown - now) > 0.005) {
+    data_changed = true;
+  }
+#else
+  indicators_update(index, price, prev_close, day_volume);
+#endif
+
+  s.price = price;
+  s.change = change;
+  s.change_percent = change_percent;
+  s.valid = true;
+  s.changed = s.changed || data_changed;
+
+  time_t now = time(nullptr);
+  s.exchange_timed = market_time != 0;
+  s.quote_time = market_time ? market_time : clock_set(now) ? (uint32_t)now : 0;
+
+  // An old quote served again (e.g. by the aggregator while its upstream
+  // fails) is shown, but greyed out
+  bool stale = too_old(s, now);
+  if (stale != s.stale) s.changed = true;
+  s.stale = stale;
+
+#if SPARKLINES_ENABLED
+  // Every quote is a sample, changed or not. The samples are not evenly
+  // spaced: visible rows come every cycle, off-screen ones round-robin, and
+  // pushed or streamed quotes whenever they arrive. The line shows the last
+  // SPARKLINE_POINTS quotes in order, not a time axis.
+  sparkline_add(index, price);
+#endif
+
+  return data_changed;
+}
+
+void quote_store_restore(int index, float price, float prev_close, uint32_t quote_time) {
+  StockData& s = stocks[index];
+  s.price = price;
+  s.change = price - prev_close;
+  s.change_percent = (s.change / prev_close) * 100;
+  s.valid = true;
+  s.stale = true;
+  s.changed = true;
+  s.exchange_timed = false;
+  s.quote_time = quote_time;
+}
+
+void quote_store_mark_stale() {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].valid && !stocks[i].stale) {
+      stocks[i].stale = true;
+      stocks[i].changed = true; // Redraw in grey
+    }
+  }
+}
+
+int quote_store_expire() {
+  time_t now = time(nullptr);
+  int expired = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].valid && !stocks[i].stale && too_old(stocks[i], now)) {
+      stocks[i].stale = true;
+      stocks[i].changed = true; // Redraw in grey
+      expired++;
+    }
+  }
+  return expired;
+}
+
+bool quote_store_market_open() {
+  struct tm now;
+  if (!getLocalTime(&now, 0)) return false;
+  int minutes = now.tm_hour * 60 + now.tm_min;
+  bool weekend = now.tm_wday == 0 || now.tm_wday == 6;
+  return !weekend && minutes >= MARKET_OPEN_MINUTES && minutes < MARKET_CLOSE_MINUTES;
+}
+
+int quote_store_valid_count() {
+  int valid_count = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].valid) valid_count++;
+  }
+  return valid_count;
+}
+
+int quote_store_stale_count() {
+  int stale_count = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].stale) stale_count++;
+  }
+  return stale_count;
+}
+
+int quote_store_fresh_count() {
+  int fresh_count = 0;
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].valid && !stocks[i].stale) fresh_count++;
+  }
+  return fresh_count;
+}
+
+bool quote_store_any_changed() {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (stocks[i].changed) return true;
+  }
+  return false;
+}
+
+void quote_store_clear_changed() {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    stocks[i].changed = false;
+  }
+}
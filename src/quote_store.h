@@ -0,0 +1,58 @@
+#ifndef QUOTE_STORE_H
+#define QUOTE_STORE_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Stock data structure. Kept small because there is one per watchlist entry:
+// the symbol and name point straight into the tables in config.h.
+struct StockData {
+  const char* symbol;
+  const char* name;
+  float price;
+  float change;
+  float change_percent;
+  bool valid;
+  bool changed; // Track if data changed
+  bool stale;   // Restored from the boot snapshot, not refreshed yet, or too old
+  bool exchange_timed; // quote_time is the exchange's, not when it arrived
+  uint32_t quote_time; // Unix time of the quote, 0 if the clock was not set
+};
+
+extern StockData stocks[NUM_STOCKS];
+
+void quote_store_init();
+
+// Store a new quote for stocks[index] and feed it to the sparkline and the
+// indicators. day_volume is the session's cumulative volume (0 if unknown),
+// market_time the exchange's time of the quote (0 if unknown; the arrival
+// time is kept instead). A quote that is already QUOTE_MAX_AGE_SECONDS behind
+// the exchange clock is stored stale. Returns true if the displayed values
+// changed (always true for the first valid quote).
+bool quote_store_apply(int index, float price, float prev_close, uint32_t day_volume,
+                       uint32_t market_time);
+
+// Load a last-known quote at boot. It counts as valid but stays stale until
+// quote_store_apply() replaces it.
+void quote_store_restore(int index, float price, float prev_close, uint32_t quote_time);
+
+// Mark every valid quote stale, e.g. while offline
+void quote_store_mark_stale();
+
+// Mark stale the quotes whose exchange time has fallen QUOTE_MAX_AGE_SECONDS
+// behind while the market is open, e.g. a source repeating its last good
+// quote. Returns how many were marked.
+int quote_store_expire();
+
+// True during MARKET_OPEN_MINUTES .. MARKET_CLOSE_MINUTES on a weekday, local
+// time. False until NTP has set the clock.
+bool quote_store_market_open();
+
+int quote_store_valid_count();
+int quote_store_stale_count();
+// Valid and not stale: fetched since boot and still current
+int quote_store_fresh_count();
+bool quote_store_any_changed();
+void quote_store_clear_changed();
+
+#endif
@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include "sparkline.h"
+#include "../config.h"
+
+struct Sparkline {
+  int32_t oldest;                          // Oldest sample in cents
+  int32_t newest;                          // Newest sample in cents
+  int16_t deltas[SPARKLINE_POINTS - 1];    // Ring of sample-to-sample deltas
+  uint8_t delta_start;                     // Ring index of the oldest delta
+  uint8_t count;                           // Samples held (<= SPARKLINE_POINTS)
+  uint32_t total;                          // Samples ever added, sets the sweep column
+  uint32_t drawn;                          // Value of total at the last draw
+  int32_t scale_lo;                        // Range and colour the pixels on screen
+  int32_t scale_hi;                        // were drawn with
+  bool drawn_up;
+};
+
+static Sparkline lines[NUM_STOCKS];
+
+void sparkline_init() {
+  memset(lines, 0, sizeof(lines));
+}
+
+void sparkline_add(int index, float price) {
+  Sparkline& s = lines[index];
+  int32_t cents = (int32_t)lroundf(price * 100);
+
+  if (s.count == 0) {
+    s.oldest = s.newest = cents;
+    s.count = 1;
+    s.total++;
+    return;
+  }
+
+  // Moves beyond +-$327 between two samples are clamped. Newest is rebuilt
+  // from the stored delta so the ring always decodes to the same values.
+  int32_t delta = cents - s.newest;
+  if (delta > INT16_MAX) delta = INT16_MAX;
+  if (delta < INT16_MIN) delta = INT16_MIN;
+
+  if (s.count == SPARKLINE_POINTS) {
+    // Drop the oldest sample: the next one is oldest + first delta
+    s.oldest += s.deltas[s.delta_start];
+    s.delta_start = (s.delta_start + 1) % (SPARKLINE_POINTS - 1);
+    s.count--;
+  }
+
+  int slot = (s.delta_start + s.count - 1) % (SPARKLINE_POINTS - 1);
+  s.deltas[slot] = (int16_t)delta;
+  s.newest += delta;
+  s.count++;
+  s.total++;
+}
+
+static void value_range(const Sparkline& s, int32_t* lo, int32_t* hi) {
+  int32_t v = s.oldest;
+  *lo = *hi = v;
+  for (int k = 0; k < s.count - 1; k++) {
+    v += s.deltas[(s.delta_start + k) % (SPARKLINE_POINTS - 1)];
+    if (v < *lo) *lo = v;
+    if (v > *hi) *hi = v;
+  }
+}
+
+static int value_to_y(const Sparkline& s, int32_t v, int y) {
+  int32_t span = s.scale_hi - s.scale_lo;
+  if (span <= 0) return y + SPARKLINE_HEIGHT / 2;
+  return y + SPARKLINE_HEIGHT - 1 - (int)((int64_t)(v - s.scale_lo) * (SPARKLINE_HEIGHT - 1) / span);
+}
+
+static uint16_t line_color(const Sparkline& s) {
+  return (s.newest >= s.oldest) ? TFT_GREEN : TFT_RED;
+}
+
+// Draw the column for one sample: a vertical run from the previous value
+// to this one, so steep moves stay connected
+static void draw_column(TFT_eSPI& tft, const Sparkline& s, int x, int y,
+                        uint32_t sample_index, int32_t prev, int32_t v, uint16_t color) {
+  int col = x + sample_index % SPARKLINE_WIDTH;
+  int y0 = value_to_y(s, prev, y);
+  int y1 = value_to_y(s, v, y);
+  if (y0 > y1) { int t = y0; y0 = y1; y1 = t; }
+
+  tft.drawFastVLine(col, y, SPARKLINE_HEIGHT, TFT_BLACK);
+  tft.drawFastVLine(col, y0, y1 - y0 + 1, color);
+
+  // Sweep cursor: keep the next column clear
+  tft.drawFastVLine(x + (sample_index + 1) % SPARKLINE_WIDTH, y, SPARKLINE_HEIGHT, TFT_BLACK);
+}
+
+void sparkline_draw(TFT_eSPI& tft, int index, int x, int y) {
+  Sparkline& s = lines[index];
+
+  tft.fillRect(x, y, SPARKLINE_WIDTH, SPARKLINE_HEIGHT, TFT_BLACK);
+  s.drawn = s.total;
+  if (s.count == 0) return;
+
+  value_range(s, &s.scale_lo, &s.scale_hi);
+  s.drawn_up = s.newest >= s.oldest;
+  uint16_t color = line_color(s);
+
+  uint32_t sample_index = s.total - s.count;
+  int32_t prev = s.oldest;
+  int32_t v = s.oldest;
+  for (int k = 0; k < s.count; k++) {
+    if (k > 0) v += s.deltas[(s.delta_start + k - 1) % (SPARKLINE_POINTS - 1)];
+    draw_column(tft, s, x, y, sample_index + k, prev, v, color);
+    prev = v;
+  }
+}
+
+void sparkline_draw_latest(TFT_eSPI& tft, int index, int x, int y) {
+  Sparkline& s = lines[index];
+  uint32_t pending = s.total - s.drawn;
+  if (pending == 0) return;
+
+  // Only the single newest column can be drawn on its own. Several missed
+  // samples, a value off the current scale or a trend colour flip need the
+  // whole line.
+  bool in_range = s.newest >= s.scale_lo && s.newest <= s.scale_hi;
+  bool same_color = (s.newest >= s.oldest) == s.drawn_up;
+  if (pending > 1 || s.count < 2 || !in_range || !same_color) {
+    sparkline_draw(tft, index, x, y);
+    return;
+  }
+
+  int32_t prev = s.newest - s.deltas[(s.delta_start + s.count - 2) % (SPARKLINE_POINTS - 1)];
+  draw_column(tft, s, x, y, s.total - 1, prev, s.newest, line_color(s));
+  s.drawn = s.total;
+}
@@ -0,0 +1,30 @@
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+#include <TFT_eSPI.h>
+
+// Per-symbol intraday sparkline. Each symbol keeps the last SPARKLINE_POINTS
+// prices in a fixed-size ring of 16-bit deltas (in cents), so memory per
+// symbol is bounded (under 100 bytes with the default 33 points) however long
+// the tracker runs.
+//
+// The line is drawn "sweep" style: sample n goes in column n % width and the
+// column after it is kept blank as a cursor. A new sample therefore only
+// touches two columns and the rest of the pixels stay where they are.
+
+#define SPARKLINE_WIDTH (SPARKLINE_POINTS + 1) // One spare column for the cursor gap
+#define SPARKLINE_HEIGHT 14
+
+void sparkline_init();
+
+// Record a new price sample for stocks[index]
+void sparkline_add(int index, float price);
+
+// Draw the whole sparkline with its top left corner at x,y
+void sparkline_draw(TFT_eSPI& tft, int index, int x, int y);
+
+// Draw only the samples added since the last draw. Falls back to a full
+// redraw if the new value is outside the current scale.
+void sparkline_draw_latest(TFT_eSPI& tft, int index, int x, int y);
+
+#endif
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "esp32-hal-spi.h"
+#include "soc/spi_reg.h"
+#include "spi_calibration.h"
+#include "metrics.h"
+#include "logging.h"
+#include "../config.h"
+
+// Test pattern area (top left corner, overwritten by create_ui() afterwards)
+#define CAL_X 0
+#define CAL_Y 0
+#define CAL_W 120
+#define CAL_H 8
+#define CAL_PIXELS (CAL_W * CAL_H)
+
+// A clock only counts as stable if every pattern reads back intact in every
+// round: a clock that is only just working will flip a bit somewhere in ~11k
+// pixels. For margin, the fastest clock that passed the sweep then has to
+// pass a much longer soak, otherwise the next slower one is kept.
+#define CAL_ROUNDS 4
+#define CAL_SOAK_ROUNDS 32
+#define CAL_PATTERNS 3
+
+#define CAL_NVS_NAMESPACE "spi_cal"
+#define CAL_NVS_VERSION 3 // Bump to force a new sweep after a driver change
+#define CAL_NO_READBACK 0 // Saved clock: readback did not work, keep SPI_FREQUENCY
+
+// The ESP32 SPI clock is the 80 MHz APB clock divided by an integer, so these
+// are the only write clocks worth trying above the 20 MHz floor; there is
+// nothing between 40 and 80 MHz.
+static const uint32_t CAL_CANDIDATES[] = {20000000, 26666667, 40000000, 80000000};
+static const int NUM_CAL_CANDIDATES = sizeof(CAL_CANDIDATES) / sizeof(CAL_CANDIDATES[0]);
+
+static uint32_t write_hz = SPI_FREQUENCY;
+static uint32_t write_clock_div = 0; // 0 = leave TFT_eSPI's own clock alone
+static int frame_depth = 0;
+static uint32_t frame_start_us = 0; // Outermost frame, for the render time metric
+
+static void fill_pattern(uint16_t* buf, int pattern, uint32_t seed) {
+  uint32_t lfsr = 0xACE1u ^ (seed * 0x9E3779B9u);
+  for (int i = 0; i < CAL_PIXELS; i++) {
+    switch (pattern) {
+      case 0: // Every data line toggles on every bit
+        buf[i] = ((i + seed) & 1) ? 0xAAAA : 0x5555;
+        break;
+      case 1: // Walking one
+        buf[i] = 1 << ((i + seed) & 15);
+        break;
+      default: // Pseudo random
+        lfsr ^= lfsr << 13;
+        lfsr ^= lfsr >> 17;
+        lfsr ^= lfsr << 5;
+        buf[i] = lfsr & 0xFFFF;
+        break;
+    }
+  }
+}
+
+// Write the patterns at the given clock and read them back at the (slow,
+// fixed) SPI_READ_FREQUENCY. Returns the number of mismatched pixels.
+static int verify_clock(TFT_eSPI& tft, uint32_t hz, int rounds, uint16_t* out, uint16_t* in) {
+  uint32_t div = spiFrequencyToClockDiv(hz);
+  int errors = 0;
+
+  for (int round = 0; round < rounds; round++) {
+    for (int p = 0; p < CAL_PATTERNS; p++) {
+      fill_pattern(out, p, round);
+
+      tft.startWrite();
+      WRITE_PERI_REG(SPI_CLOCK_REG(SPI_PORT), div);
+      tft.pushImage(CAL_X, CAL_Y, CAL_W, CAL_H, out);
+      tft.endWrite();
+
+      memset(in, 0, CAL_PIXELS * sizeof(uint16_t));
+      tft.readRect(CAL_X, CAL_Y, CAL_W, CAL_H, in);
+
+      for (int i = 0; i < CAL_PIXELS; i++) {
+        if (in[i] != out[i]) errors++;
+      }
+      if (errors > 0) return errors;
+    }
+  }
+  return 0;
+}
+
+static void apply_frequency(uint32_t hz) {
+  write_hz = hz;
+  write_clock_div = spiFrequencyToClockDiv(hz);
+}
+
+static void save(uint32_t hz) {
+  Preferences prefs;
+  prefs.begin(CAL_NVS_NAMESPACE, false);
+  prefs.putUInt("hz", hz);
+  prefs.putUChar("ver", CAL_NVS_VERSION);
+  prefs.end();
+}
+
+uint32_t spi_calibration_run(TFT_eSPI& tft) {
+  LOGI("=== SPI clock calibration ===");
+  unsigned long start = millis();
+
+  uint16_t* out = (uint16_t*)malloc(CAL_PIXELS * sizeof(uint16_t));
+  uint16_t* in = (uint16_t*)malloc(CAL_PIXELS * sizeof(uint16_t));
+  if (!out || !in) {
+    LOGE("ERROR: No memory for calibration buffers");
+    free(out);
+    free(in);
+    return write_hz;
+  }
+
+  int fastest = -1; // Fastest candidate that passed
+  for (int i = 0; i < NUM_CAL_CANDIDATES; i++) {
+    int errors = verify_clock(tft, CAL_CANDIDATES[i], CAL_ROUNDS, out, in);
+    LOGI("  %u Hz: %s (%d bad pixels)",
+         (unsigned)CAL_CANDIDATES[i], errors == 0 ? "OK" : "FAIL", errors);
+    if (errors > 0) break; // Faster clocks will not do better
+    fastest = i;
+  }
+
+  // The margin: the fastest clock has to hold up for a long soak as well
+  int best = fastest;
+  if (fastest >= 0) {
+    int errors = verify_clock(tft, CAL_CANDIDATES[fastest], CAL_SOAK_ROUNDS, out, in);
+    LOGI("  %u Hz soak: %s (%d bad pixels)",
+         (unsigned)CAL_CANDIDATES[fastest], errors == 0 ? "OK" : "FAIL", errors);
+    if (errors > 0 && fastest > 0) best = fastest - 1;
+  }
+
+  free(out);
+  free(in);
+  tft.fillRect(CAL_X, CAL_Y, CAL_W, CAL_H, TFT_BLACK);
+
+  // Failing even the slowest clock means the readback path (MISO) is not
+  // usable, so there is nothing to calibrate against. Remembered, so the
+  // sweep does not run on every boot.
+  if (fastest < 0) {
+    LOGW("Readback failed at the slowest clock, keeping default");
+    save(CAL_NO_READBACK);
+    return write_hz;
+  }
+
+  // The build's own clock is known to work, never go below it once it passed
+  uint32_t hz = CAL_CANDIDATES[best];
+  if (hz < SPI_FREQUENCY && CAL_CANDIDATES[fastest] >= SPI_FREQUENCY) hz = SPI_FREQUENCY;
+
+  apply_frequency(hz);
+  save(hz);
+
+  LOGI("Calibrated SPI write clock: %u Hz, %u Hz passed the sweep (took %lu ms)",
+       (unsigned)hz, (unsigned)CAL_CANDIDATES[fastest], millis() - start);
+  return write_hz;
+}
+
+uint32_t spi_calibration_begin(TFT_eSPI& tft) {
+#if SPI_AUTO_CALIBRATE
+  uint32_t saved = 0;
+  bool have_saved = false;
+
+  Preferences prefs;
+  if (prefs.begin(CAL_NVS_NAMESPACE, true)) {
+    if (prefs.getUChar("ver", 0) == CAL_NVS_VERSION) {
+      saved = prefs.getUInt("hz", 0);
+      have_saved = true;
+    }
+    prefs.end();
+  }
+
+  if (have_saved && saved == CAL_NO_READBACK && !SPI_CALIBRATE_FORCE) {
+    LOGI("No SPI readback at the last calibration, using %u Hz", (unsigned)write_hz);
+    return write_hz;
+  }
+
+  // Only trust values that are still in the candidate table, or the default
+  bool known = saved == SPI_FREQUENCY;
+  for (int i = 0; i < NUM_CAL_CANDIDATES; i++) {
+    if (CAL_CANDIDATES[i] == saved) known = true;
+  }
+
+  if (have_saved && known && !SPI_CALIBRATE_FORCE) {
+    apply_frequency(saved);
+    LOGI("Using saved SPI write clock: %u Hz", (unsigned)saved);
+    return write_hz;
+  }
+
+  return spi_calibration_run(tft);
+#else
+  return write_hz;
+#endif
+}
+
+uint32_t spi_write_frequency() {
+  return write_hz;
+}
+
+void tft_begin_frame(TFT_eSPI& tft) {
+  if (frame_depth++ > 0) return;
+
+  frame_start_us = micros();
+  tft.startWrite();
+  if (write_clock_div) {
+    WRITE_PERI_REG(SPI_CLOCK_REG(SPI_PORT), write_clock_div);
+  }
+}
+
+void tft_end_frame(TFT_eSPI& tft) {
+  if (frame_depth == 0 || --frame_depth > 0) return;
+
+  tft.endWrite();
+#if METRICS_ENABLED
+  metrics_record_render(micros() - frame_start_us);
+#endif
+}
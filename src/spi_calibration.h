@@ -0,0 +1,24 @@
+#ifndef SPI_CALIBRATION_H
+#define SPI_CALIBRATION_H
+
+#include <TFT_eSPI.h>
+
+// Load the calibrated SPI write clock from NVS, or run the sweep if there is
+// no saved value yet. Returns the clock that will be used, in Hz.
+uint32_t spi_calibration_begin(TFT_eSPI& tft);
+
+// Sweep the candidate clocks, verify each one by reading a test pattern back
+// from the panel and store the fastest clock that also passes a soak. Draws over the top of the
+// screen, so call it before the UI is drawn.
+uint32_t spi_calibration_run(TFT_eSPI& tft);
+
+// Currently selected SPI write clock in Hz
+uint32_t spi_write_frequency();
+
+// Bracket a batch of drawing calls so they are sent at the calibrated clock.
+// TFT_eSPI re-applies SPI_FREQUENCY at the start of every transaction, so the
+// override only lasts until tft_end_frame().
+void tft_begin_frame(TFT_eSPI& tft);
+void tft_end_frame(TFT_eSPI& tft);
+
+#endif
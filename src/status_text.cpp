@@ -0,0 +1,37 @@
+#include <TFT_eSPI.h>
+#include "status_text.h"
+#include "quote_store.h"
+#include "quote_snapshot.h"
+#include "connectivity.h"
+#include "mqtt_quotes.h"
+#include "../config.h"
+
+uint16_t status_text(char* buf, size_t len) {
+  int valid_count = quote_store_valid_count();
+  int stale_count = quote_store_stale_count();
+  ConnState conn = connectivity_state();
+  if (conn == CONN_OFFLINE || conn == CONN_CONNECTING) {
+    snprintf(buf, len, "Offline - reconnecting");
+    return TFT_RED;
+  }
+#if QUOTE_SOURCE == QUOTE_SOURCE_MQTT
+  if (!mqtt_quotes_connected()) {
+    snprintf(buf, len, "Broker offline - reconnecting");
+    return TFT_RED;
+  }
+#endif
+  if (valid_count == 0) {
+    snprintf(buf, len, "Connecting...");
+  } else if (stale_count == valid_count) {
+    // Nothing fetched yet, everything on screen is from the boot snapshot
+    char when[20];
+    quote_snapshot_format_time(when, sizeof(when));
+    snprintf(buf, len, "Cached %s", when);
+    return TFT_DARKGREY;
+  } else if (stale_count > 0) {
+    snprintf(buf, len, "Live (%d stocks, %d old)", valid_count, stale_count);
+  } else {
+    snprintf(buf, len, "Live (%d stocks)", valid_count);
+  }
+  return TFT_CYAN;
+}
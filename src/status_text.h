@@ -0,0 +1,11 @@
+#ifndef STATUS_TEXT_H
+#define STATUS_TEXT_H
+
+#include <Arduino.h>
+
+// The status line text ("Live (12 stocks)", "Offline - reconnecting", ...),
+// shared by the table and ticker-tape layouts. Writes the text into buf and
+// returns the colour to draw it in.
+uint16_t status_text(char* buf, size_t len);
+
+#endif
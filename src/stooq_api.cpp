@@ -0,0 +1,145 @@
+#include "stooq_api.h"
+#include "csv_stream.h"
+#include "logging.h"
+#include "../config.h"
+
+#define STOOQ_TIMEOUT_MS 10000
+#define STOOQ_SYMBOL_MAX 16
+#define STOOQ_READ_CHUNK 128
+
+// Columns are found by name in the header row, so their order can change
+enum StooqColumn { COL_SYMBOL, COL_CLOSE, COL_PREV, COL_VOLUME, COL_COUNT };
+
+static void stooq_symbol(const char* symbol, char* out, size_t cap) {
+  size_t n = 0;
+  for (; symbol[n] && n < cap - 1; n++) {
+    out[n] = tolower((unsigned char)symbol[n]);
+  }
+  out[n] = '\0';
+  // Indices (^SPX) and symbols with a market already keep their name
+  if (symbol[0] != '^' && !strchr(out, '.')) {
+    strncat(out, STOOQ_SUFFIX, cap - n - 1);
+  }
+}
+
+static int header_column(const char* name) {
+  if (strcasecmp(name, "Symbol") == 0) return COL_SYMBOL;
+  if (strcasecmp(name, "Close") == 0) return COL_CLOSE;
+  if (strncasecmp(name, "Prev", 4) == 0) return COL_PREV;
+  if (strcasecmp(name, "Volume") == 0) return COL_VOLUME;
+  return -1;
+}
+
+int stooq_parse(Client& body, int length, const char* const* symbols, int count,
+                YahooQuote* quotes, bool* ok) {
+  static CsvParser csv; // Fetch task only
+  csv_begin(&csv);
+
+  int8_t column_of[CSV_FIELD_MAX]; // Which StooqColumn each CSV column holds
+  memset(column_of, -1, sizeof(column_of));
+  char row[COL_COUNT][CSV_FIELD_MAX];
+  memset(row, 0, sizeof(row));
+
+  char stooq[STOOQ_SYMBOL_MAX];
+  int received = 0;
+  bool header_ok = false;
+  unsigned long last_data = millis();
+  uint8_t buf[STOOQ_READ_CHUNK];
+
+  bool ended = false; // The whole body is in
+  for (;;) {
+    int n = 0;
+    if (length != 0) {
+      size_t want = length > 0 && length < (int)sizeof(buf) ? length : sizeof(buf);
+      n = body.available() ? body.read(buf, want) : 0;
+    }
+    if (n <= 0) {
+      n = 0;
+      // Without a length the body ends when the server closes; a body cut
+      // short or timed out may end mid-row and is not finished
+      ended = length == 0 || (length < 0 && !body.connected());
+      if (!ended && body.connected() && millis() - last_data <= STOOQ_TIMEOUT_MS) {
+        delay(1);
+        continue;
+      }
+    } else {
+      last_data = millis();
+      if (length > 0) length -= n;
+    }
+
+    // After the last byte, csv_finish() completes a row without a line end
+    for (int i = 0; i < n || (ended && i == n); i++) {
+      CsvEvent e = i < n ? csv_feed(&csv, (char)buf[i]) : csv_finish(&csv);
+      if (e == CSV_NONE) continue;
+
+      if (csv.row == 0) {
+        if (csv.column < CSV_FIELD_MAX) column_of[csv.column] = header_column(csv.field);
+        if (e == CSV_ROW) {
+          header_ok = true;
+          for (int c = 0; c < COL_COUNT; c++) {
+            if (c != COL_VOLUME && !memchr(column_of, c, sizeof(column_of))) header_ok = false;
+          }
+          if (!header_ok) LOGW("Stooq: unexpected CSV header");
+        }
+        continue;
+      }
+      if (!header_ok) continue;
+
+      int c = csv.column < CSV_FIELD_MAX ? column_of[csv.column] : -1;
+      if (c >= 0) strcpy(row[c], csv.field);
+      if (e != CSV_ROW) continue;
+
+      // "N/D" for a symbol Stooq does not know
+      for (int s = 0; s < count; s++) {
+        stooq_symbol(symbols[s], stooq, sizeof(stooq));
+        if (ok[s] || strcasecmp(stooq, row[COL_SYMBOL]) != 0) continue;
+        quotes[s].price = atof(row[COL_CLOSE]);
+        quotes[s].prev_close = atof(row[COL_PREV]);
+        quotes[s].volume = strtoul(row[COL_VOLUME], nullptr, 10);
+        ok[s] = quotes[s].price > 0 && quotes[s].prev_close > 0;
+        if (ok[s]) received++;
+        break;
+      }
+      memset(row, 0, sizeof(row));
+    }
+    if (n == 0) break;
+  }
+  return received;
+}
+
+int stooq_fetch_quotes(const char* const* symbols, int count,
+                       YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  String url = STOOQ_URL;
+  char stooq[STOOQ_SYMBOL_MAX];
+  for (int i = 0; i < count; i++) {
+    stooq_symbol(symbols[i], stooq, sizeof(stooq));
+    if (i) url += ',';
+    url += stooq;
+    ok[i] = false;
+  }
+  LOGI("Fetching %d quotes from Stooq", count);
+
+  uint32_t start = micros();
+  HTTPClient http;
+  http.useHTTP10(true); // Plain body, read as it arrives
+  http.begin(url);
+  http.setTimeout(STOOQ_TIMEOUT_MS);
+
+  int received = 0;
+  int httpCode = http.GET();
+  status->http_code = httpCode;
+  status->parse_error = false;
+
+  if (httpCode == HTTP_CODE_OK) {
+    received = stooq_parse(*http.getStreamPtr(), http.getSize(), symbols, count, quotes, ok);
+    status->parse_error = received < count;
+  } else {
+    LOGW("Stooq request failed: %d", httpCode);
+  }
+
+  http.end();
+  status->latency_us = micros() - start;
+  LOGI("Stooq: %d of %d quotes in %u ms", received, count,
+       (unsigned)(status->latency_us / 1000));
+  return received;
+}
@@ -0,0 +1,20 @@
+#ifndef STOOQ_API_H
+#define STOOQ_API_H
+
+#include "yahoo_api.h"
+
+// Client for Stooq's CSV quotes, a fallback for when Yahoo is slow or
+// failing. A batch of symbols is one request; the body is read through the
+// streaming CSV parser as it arrives. US symbols get Stooq's ".us" market
+// suffix (STOOQ_SUFFIX) unless they already have one.
+
+// Same contract as aggregator_fetch_quotes. Blocks.
+int stooq_fetch_quotes(const char* const* symbols, int count,
+                       YahooQuote* quotes, bool* ok, FetchStatus* status);
+
+// Parse a response body of length bytes (-1 if unknown, then up to the
+// close). Split out so fixtures can be fed from any connection.
+int stooq_parse(Client& body, int length, const char* const* symbols, int count,
+                YahooQuote* quotes, bool* ok);
+
+#endif
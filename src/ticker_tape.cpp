@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include "ticker_tape.h"
+#include "spi_calibration.h"
+#include "quote_store.h"
+#include "status_text.h"
+#include "sparkline.h"
+#include "logging.h"
+#include "../config.h"
+
+// ILI9341 vertical scrolling commands
+#define ILI9341_VSCRDEF 0x33
+#define ILI9341_VSCRSADD 0x37
+
+// Fixed areas: title + column header on top, status line at the bottom.
+// Everything in between scrolls. In rotation 0 the panel's scroll direction
+// is the screen's vertical axis, so memory lines map 1:1 to screen Y.
+#define TICKER_TOP_FIXED 55
+#define TICKER_BOTTOM_FIXED 40
+#define TICKER_SCROLL_HEIGHT (320 - TICKER_TOP_FIXED - TICKER_BOTTOM_FIXED)
+#define TICKER_WIDTH 240
+
+static TFT_eSprite* row_sprite = nullptr;
+static uint16_t scroll_start = TICKER_TOP_FIXED; // Memory line shown at the top of the scroll area
+static uint32_t content_line = 0;                // Next line of the endless tape to draw
+static unsigned long last_step = 0;
+
+// Which stock each memory line of the scroll area currently holds, so taps
+// can be mapped back to a row
+static int16_t line_owner[TICKER_SCROLL_HEIGHT];
+
+static void write_scroll_definition(TFT_eSPI& tft, uint16_t top, uint16_t height, uint16_t bottom) {
+  tft.writecommand(ILI9341_VSCRDEF);
+  tft.writedata(top >> 8);
+  tft.writedata(top & 0xFF);
+  tft.writedata(height >> 8);
+  tft.writedata(height & 0xFF);
+  tft.writedata(bottom >> 8);
+  tft.writedata(bottom & 0xFF);
+}
+
+static void write_scroll_start(TFT_eSPI& tft, uint16_t line) {
+  tft.writecommand(ILI9341_VSCRSADD);
+  tft.writedata(line >> 8);
+  tft.writedata(line & 0xFF);
+}
+
+// Render a whole row into RAM once; it is then sent to the panel a line at a time
+static void render_row(int i) {
+  row_sprite->fillSprite(TFT_BLACK);
+  row_sprite->setTextSize(1);
+
+  row_sprite->setCursor(10, 8);
+  row_sprite->setTextColor(TFT_WHITE);
+  row_sprite->print(stocks[i].symbol);
+
+  if (stocks[i].valid) {
+    // Quotes from the boot snapshot are greyed out until refreshed
+    bool stale = stocks[i].stale;
+    row_sprite->setCursor(80, 8);
+    if (stale) row_sprite->setTextColor(TFT_DARKGREY);
+    row_sprite->printf("$%.2f", stocks[i].price);
+
+    row_sprite->setCursor(150, 8);
+    row_sprite->setTextColor(stale ? TFT_DARKGREY : (stocks[i].change >= 0) ? TFT_GREEN : TFT_RED);
+    row_sprite->printf("%+.2f%%", stocks[i].change_percent);
+  } else {
+    row_sprite->setCursor(80, 8);
+    row_sprite->setTextColor(TFT_YELLOW);
+    row_sprite->print("Loading...");
+  }
+
+#if SPARKLINES_ENABLED
+  sparkline_draw(*row_sprite, i, 230 - SPARKLINE_WIDTH, (TICKER_ROW_HEIGHT - SPARKLINE_HEIGHT) / 2);
+#endif
+
+  // Thin separator on the last line of each row
+  row_sprite->drawFastHLine(10, TICKER_ROW_HEIGHT - 1, 220, TFT_NAVY);
+}
+
+void ticker_create_ui(TFT_eSPI& tft) {
+  if (!row_sprite) {
+    row_sprite = new TFT_eSprite(&tft);
+    row_sprite->setColorDepth(16);
+    if (!row_sprite->createSprite(TICKER_WIDTH, TICKER_ROW_HEIGHT)) {
+      LOGE("ERROR: No memory for ticker row buffer");
+    }
+  }
+
+  tft_begin_frame(tft);
+  tft.fillScreen(TFT_BLACK);
+
+  // Title
+  tft.setCursor(10, 5);
+  tft.setTextColor(TFT_CYAN);
+  tft.setTextSize(2);
+  tft.print("STOCK TRACKER");
+
+  // Column header
+  tft.drawLine(10, 30, 230, 30, TFT_BLUE);
+  tft.setCursor(10, 35);
+  tft.setTextSize(1);
+  tft.print("Symbol");
+  tft.setCursor(80, 35);
+  tft.print("Price");
+  tft.setCursor(150, 35);
+  tft.print("Change");
+  tft.drawLine(10, 50, 230, 50, TFT_BLUE);
+
+  scroll_start = TICKER_TOP_FIXED;
+  content_line = 0;
+  for (int i = 0; i < TICKER_SCROLL_HEIGHT; i++) {
+    line_owner[i] = -1;
+  }
+  write_scroll_definition(tft, TICKER_TOP_FIXED, TICKER_SCROLL_HEIGHT, TICKER_BOTTOM_FIXED);
+  write_scroll_start(tft, scroll_start);
+  tft_end_frame(tft);
+
+  ticker_draw_status(tft);
+}
+
+void ticker_tick(TFT_eSPI& tft) {
+  if (!row_sprite || !row_sprite->created()) return;
+  if (millis() - last_step < TICKER_STEP_MS) return;
+  last_step = millis();
+
+  int row = (content_line / TICKER_ROW_HEIGHT) % NUM_STOCKS;
+  int line = content_line % TICKER_ROW_HEIGHT;
+  if (line == 0) {
+    render_row(row);
+  }
+
+  // The line at the top of the scroll area is about to wrap round to the
+  // bottom, so overwrite it with the new content and then move the start
+  uint16_t* pixels = (uint16_t*)row_sprite->getPointer() + line * TICKER_WIDTH;
+
+  tft_begin_frame(tft);
+  bool swap = tft.getSwapBytes();
+  tft.setSwapBytes(false); // Sprite pixels are already in panel byte order
+  tft.pushImage(0, scroll_start, TICKER_WIDTH, 1, pixels);
+  tft.setSwapBytes(swap);
+  line_owner[scroll_start - TICKER_TOP_FIXED] = row;
+
+  scroll_start++;
+  if (scroll_start >= TICKER_TOP_FIXED + TICKER_SCROLL_HEIGHT) {
+    scroll_start = TICKER_TOP_FIXED;
+  }
+  write_scroll_start(tft, scroll_start);
+  tft_end_frame(tft);
+
+  content_line++;
+}
+
+int ticker_row_at(int y) {
+  if (y < TICKER_TOP_FIXED || y >= TICKER_TOP_FIXED + TICKER_SCROLL_HEIGHT) return -1;
+
+  // Screen line k of the scroll area shows memory line (start + k) wrapped
+  int k = y - TICKER_TOP_FIXED;
+  int line = (scroll_start - TICKER_TOP_FIXED + k) % TICKER_SCROLL_HEIGHT;
+  return line_owner[line];
+}
+
+void ticker_draw_status(TFT_eSPI& tft) {
+  tft_begin_frame(tft);
+  tft.fillRect(10, 320 - TICKER_BOTTOM_FIXED, 220, TICKER_BOTTOM_FIXED, TFT_BLACK);
+  char status[40];
+  tft.setCursor(10, 300);
+  tft.setTextColor(status_text(status, sizeof(status)));
+  tft.setTextSize(1);
+  tft.print(status);
+  tft_end_frame(tft);
+}
+
+void ticker_stop(TFT_eSPI& tft) {
+  tft_begin_frame(tft);
+  write_scroll_definition(tft, 0, 320, 0);
+  write_scroll_start(tft, 0);
+  tft_end_frame(tft);
+}
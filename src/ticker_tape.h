@@ -0,0 +1,25 @@
+#ifndef TICKER_TAPE_H
+#define TICKER_TAPE_H
+
+#include <TFT_eSPI.h>
+
+// Ticker-tape layout: the whole watchlist rolls up the screen continuously.
+// Uses the ILI9341 hardware vertical scroll (VSCRDEF/VSCRSADD) so each step
+// only sends the single newly exposed line of pixels.
+
+// Draw the fixed header/status areas and set up the scroll region
+void ticker_create_ui(TFT_eSPI& tft);
+
+// Call as often as possible; advances one line every TICKER_STEP_MS
+void ticker_tick(TFT_eSPI& tft);
+
+// Redraw the fixed status line at the bottom
+void ticker_draw_status(TFT_eSPI& tft);
+
+// Stock index of the row currently shown at screen Y, or -1
+int ticker_row_at(int y);
+
+// Reset the panel to an unscrolled full screen (before drawing other screens)
+void ticker_stop(TFT_eSPI& tft);
+
+#endif
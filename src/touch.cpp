@@ -0,0 +1,202 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "touch.h"
+#include "logging.h"
+#include "../config.h"
+
+// CYD touch wiring (separate from the display bus, IRQ pin in touch.h)
+#define TOUCH_MOSI_PIN 32
+#define TOUCH_MISO_PIN 39
+#define TOUCH_CLK_PIN 25
+#define TOUCH_CS_PIN 33
+
+#define TOUCH_SPI_FREQUENCY 2000000
+
+// XPT2046 commands: 12-bit differential conversions. The final power-down
+// command leaves PD1:PD0 = 00, which keeps the pen interrupt enabled.
+#define XPT_CMD_X 0xD0
+#define XPT_CMD_Y 0x90
+#define XPT_CMD_Z1 0xB0
+#define XPT_CMD_Z2 0xC0
+#define XPT_CMD_POWER_DOWN 0x80
+
+#define TOUCH_SAMPLES 3
+#define TOUCH_POLL_MS 5 // Sampling rate while the pen is down
+
+enum TouchState {
+  TOUCH_IDLE,     // Waiting for the pen interrupt
+  TOUCH_PRESSING, // Pen down, waiting for TOUCH_DEBOUNCE_MS of stable contact
+  TOUCH_HELD      // Tap reported, waiting for release
+};
+
+// The display uses the VSPI peripheral, so touch gets HSPI
+static SPIClass touch_spi(HSPI);
+
+static volatile bool irq_pending = false;
+static volatile uint32_t irq_time_us = 0;
+
+static TouchState state = TOUCH_IDLE;
+static unsigned long press_start = 0;
+static unsigned long release_start = 0;
+static unsigned long last_sample = 0;
+static int16_t press_x = 0;
+static int16_t press_y = 0;
+
+static bool tap_ready = false;
+static TouchEvent tap_event;
+
+static void IRAM_ATTR touch_isr() {
+  if (!irq_pending) {
+    irq_time_us = micros();
+    irq_pending = true;
+  }
+}
+
+static uint16_t read_channel(uint8_t command) {
+  touch_spi.transfer(command);
+  return touch_spi.transfer16(0) >> 3; // 12-bit result, left aligned
+}
+
+static int16_t median3(int16_t a, int16_t b, int16_t c) {
+  if (a > b) { int16_t t = a; a = b; b = t; }
+  if (b > c) { b = c; }
+  return (a > b) ? a : b;
+}
+
+static int16_t map_axis(int raw, int raw_min, int raw_max, int size) {
+  long v = (long)(raw - raw_min) * size / (raw_max - raw_min);
+  if (v < 0) v = 0;
+  if (v >= size) v = size - 1;
+  return (int16_t)v;
+}
+
+// Read a filtered sample. Returns false if the pen is not firmly down.
+static bool read_touch(int16_t* x, int16_t* y) {
+  int16_t xs[TOUCH_SAMPLES];
+  int16_t ys[TOUCH_SAMPLES];
+
+  // The IRQ line toggles during conversions, so keep the ISR out of it
+  detachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN));
+
+  touch_spi.beginTransaction(SPISettings(TOUCH_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+  digitalWrite(TOUCH_CS_PIN, LOW);
+
+  int z1 = read_channel(XPT_CMD_Z1);
+  int z2 = read_channel(XPT_CMD_Z2);
+  int z = z1 + 4095 - z2;
+
+  read_channel(XPT_CMD_X); // First conversion after a channel switch is noisy
+  for (int i = 0; i < TOUCH_SAMPLES; i++) {
+    xs[i] = read_channel(XPT_CMD_X);
+    ys[i] = read_channel(XPT_CMD_Y);
+  }
+  read_channel(XPT_CMD_POWER_DOWN);
+
+  digitalWrite(TOUCH_CS_PIN, HIGH);
+  touch_spi.endTransaction();
+
+  irq_pending = false;
+  attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN), touch_isr, FALLING);
+
+  if (z < TOUCH_PRESSURE_THRESHOLD) return false;
+
+  int16_t raw_x = median3(xs[0], xs[1], xs[2]);
+  int16_t raw_y = median3(ys[0], ys[1], ys[2]);
+
+#if TOUCH_SWAP_XY
+  int16_t t = raw_x; raw_x = raw_y; raw_y = t;
+#endif
+
+  *x = map_axis(raw_x, TOUCH_RAW_X_MIN, TOUCH_RAW_X_MAX, 240);
+  *y = map_axis(raw_y, TOUCH_RAW_Y_MIN, TOUCH_RAW_Y_MAX, 320);
+#if TOUCH_INVERT_X
+  *x = 239 - *x;
+#endif
+#if TOUCH_INVERT_Y
+  *y = 319 - *y;
+#endif
+  return true;
+}
+
+void touch_begin() {
+  pinMode(TOUCH_CS_PIN, OUTPUT);
+  digitalWrite(TOUCH_CS_PIN, HIGH);
+  pinMode(TOUCH_IRQ_PIN, INPUT); // GPIO36 is input only, the board has a pull-up
+
+  touch_spi.begin(TOUCH_CLK_PIN, TOUCH_MISO_PIN, TOUCH_MOSI_PIN, TOUCH_CS_PIN);
+
+  // Put the controller in power-down with the pen interrupt enabled
+  touch_spi.beginTransaction(SPISettings(TOUCH_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+  digitalWrite(TOUCH_CS_PIN, LOW);
+  read_channel(XPT_CMD_POWER_DOWN);
+  digitalWrite(TOUCH_CS_PIN, HIGH);
+  touch_spi.endTransaction();
+
+  attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ_PIN), touch_isr, FALLING);
+  LOGI("Touch controller ready");
+}
+
+void touch_poll() {
+  if (state == TOUCH_IDLE && !irq_pending) return;
+  if (millis() - last_sample < TOUCH_POLL_MS) return;
+  last_sample = millis();
+
+  uint32_t irq_us = irq_time_us;
+  int16_t x, y;
+  bool down = read_touch(&x, &y);
+
+  switch (state) {
+    case TOUCH_IDLE:
+      if (down) {
+        state = TOUCH_PRESSING;
+        press_start = millis();
+        press_x = x;
+        press_y = y;
+        tap_event.irq_us = irq_us;
+      }
+      break;
+
+    case TOUCH_PRESSING:
+      if (!down) {
+        state = TOUCH_IDLE; // Bounce or noise, not a real press
+      } else if (abs(x - press_x) > TOUCH_MOVE_TOLERANCE || abs(y - press_y) > TOUCH_MOVE_TOLERANCE) {
+        press_start = millis(); // Still settling, restart the debounce window
+        press_x = x;
+        press_y = y;
+      } else if (millis() - press_start >= TOUCH_DEBOUNCE_MS) {
+        // Report on press rather than release to keep tap latency low
+        tap_event.x = press_x;
+        tap_event.y = press_y;
+        tap_ready = true;
+        state = TOUCH_HELD;
+        release_start = 0;
+      }
+      break;
+
+    case TOUCH_HELD:
+      if (down) {
+        release_start = 0;
+      } else if (release_start == 0) {
+        release_start = millis();
+      } else if (millis() - release_start >= TOUCH_DEBOUNCE_MS) {
+        state = TOUCH_IDLE;
+      }
+      break;
+  }
+}
+
+bool touch_get_tap(TouchEvent* event) {
+  if (!tap_ready) return false;
+  *event = tap_event;
+  tap_ready = false;
+  return true;
+}
+
+bool touch_active() {
+  return state != TOUCH_IDLE || irq_pending;
+}
+
+void touch_wake() {
+  irq_time_us = micros();
+  irq_pending = true;
+}
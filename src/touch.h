@@ -0,0 +1,35 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
+#include <Arduino.h>
+
+// XPT2046 resistive touch controller on the CYD's second SPI bus.
+// The pen interrupt wakes the driver; samples are taken and debounced in
+// touch_poll(), which turns a confirmed press into a single tap event.
+
+// Pen interrupt line, low while touched. Also used to wake from light sleep.
+#define TOUCH_IRQ_PIN 36
+
+struct TouchEvent {
+  int16_t x;       // Screen coordinates (rotation 0)
+  int16_t y;
+  uint32_t irq_us; // micros() when the pen interrupt fired, for latency tracking
+};
+
+void touch_begin();
+
+// Sample the controller if the pen interrupt fired or a press is in progress.
+// Cheap when the screen is not being touched.
+void touch_poll();
+
+// Pop the next tap, if any
+bool touch_get_tap(TouchEvent* event);
+
+// True while a press is being debounced or held
+bool touch_active();
+
+// The pen went down while the chip was in light sleep, so the edge
+// interrupt was missed. Start sampling as if it had fired.
+void touch_wake();
+
+#endif
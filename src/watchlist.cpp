@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include "watchlist.h"
+#include "../config.h"
+
+static int first_visible = 0;
+static int offscreen_cursor = 0; // Next off-screen stock to refresh
+static unsigned long last_scroll = 0;
+static unsigned long queued_ms[NUM_STOCKS]; // When each stock was last put in a fetch order
+
+static int max_first() {
+  int last_page = NUM_STOCKS - WATCHLIST_VISIBLE_ROWS;
+  return last_page > 0 ? last_page : 0;
+}
+
+int watchlist_first_visible() {
+  return first_visible;
+}
+
+int watchlist_visible_count() {
+  int remaining = NUM_STOCKS - first_visible;
+  return remaining < WATCHLIST_VISIBLE_ROWS ? remaining : WATCHLIST_VISIBLE_ROWS;
+}
+
+bool watchlist_is_visible(int stock_index) {
+  return stock_index >= first_visible &&
+         stock_index < first_visible + watchlist_visible_count();
+}
+
+int watchlist_row_y(int stock_index) {
+  if (!watchlist_is_visible(stock_index)) return -1;
+  return WATCHLIST_FIRST_ROW_Y + (stock_index - first_visible) * WATCHLIST_ROW_HEIGHT;
+}
+
+int watchlist_row_at(int y) {
+  if (y < WATCHLIST_FIRST_ROW_Y) return -1;
+
+  int row = (y - WATCHLIST_FIRST_ROW_Y) / WATCHLIST_ROW_HEIGHT;
+  if (row >= watchlist_visible_count()) return -1;
+  return first_visible + row;
+}
+
+bool watchlist_scroll_to(int first) {
+  if (first < 0) first = 0;
+  if (first > max_first()) first = max_first();
+  if (first == first_visible) return false;
+
+  first_visible = first;
+  last_scroll = millis();
+  return true;
+}
+
+bool watchlist_page(int direction) {
+  int first = first_visible + direction * WATCHLIST_VISIBLE_ROWS;
+
+  // Wrap around at either end so paging can cycle through the whole list
+  if (first > max_first()) {
+    first = (first_visible == max_first()) ? 0 : max_first();
+  } else if (first < 0) {
+    first = (first_visible == 0) ? max_first() : 0;
+  }
+  return watchlist_scroll_to(first);
+}
+
+bool watchlist_auto_scroll_tick() {
+#if WATCHLIST_AUTO_SCROLL_SECONDS > 0
+  if (NUM_STOCKS <= WATCHLIST_VISIBLE_ROWS) return false;
+
+  if (millis() - last_scroll >= WATCHLIST_AUTO_SCROLL_SECONDS * 1000UL) {
+    last_scroll = millis();
+    return watchlist_page(1);
+  }
+#endif
+  return false;
+}
+
+int watchlist_fetch_order(int* order, int max_count) {
+  int count = 0;
+
+  for (int i = first_visible; i < first_visible + watchlist_visible_count() && count < max_count; i++) {
+    order[count++] = i;
+    queued_ms[i] = millis();
+  }
+
+  // Low priority: a few off-screen symbols per cycle, so a long list is still
+  // refreshed eventually without stretching every cycle
+  int offscreen = NUM_STOCKS - watchlist_visible_count();
+  int budget = offscreen < WATCHLIST_OFFSCREEN_FETCHES ? offscreen : WATCHLIST_OFFSCREEN_FETCHES;
+  while (budget > 0 && count < max_count) {
+    int i = offscreen_cursor;
+    offscreen_cursor = (offscreen_cursor + 1) % NUM_STOCKS;
+    if (watchlist_is_visible(i)) continue;
+
+    order[count++] = i;
+    queued_ms[i] = millis();
+    budget--;
+  }
+
+  return count;
+}
+
+int watchlist_page_fetch_order(int* order, int max_count) {
+  int count = 0;
+  for (int i = first_visible; i < first_visible + watchlist_visible_count() && count < max_count; i++) {
+    if (queued_ms[i] != 0 && millis() - queued_ms[i] < UPDATE_INTERVAL_SECONDS * 1000UL) continue;
+    order[count++] = i;
+    queued_ms[i] = millis();
+  }
+  return count;
+}
@@ -0,0 +1,37 @@
+#ifndef WATCHLIST_H
+#define WATCHLIST_H
+
+// Virtualized watchlist: the full list lives in the quote store, but only
+// WATCHLIST_VISIBLE_ROWS consecutive entries are laid out on screen.
+
+#define WATCHLIST_ROW_HEIGHT 20
+#define WATCHLIST_FIRST_ROW_Y 60
+
+int watchlist_first_visible();
+int watchlist_visible_count();
+bool watchlist_is_visible(int stock_index);
+
+// Screen Y of a visible row, or -1 if the stock is scrolled out of view
+int watchlist_row_y(int stock_index);
+
+// Stock index of the visible row at screen Y, or -1 if there is none
+int watchlist_row_at(int y);
+
+// Move the window. Both return true if the visible rows changed.
+bool watchlist_scroll_to(int first);
+bool watchlist_page(int direction);
+
+// Advance to the next page every WATCHLIST_AUTO_SCROLL_SECONDS.
+// Returns true if the window moved and the rows need redrawing.
+bool watchlist_auto_scroll_tick();
+
+// Fill order[] with the stocks to fetch this cycle: every visible row first,
+// then the next few off-screen symbols in round-robin order. Returns the count.
+int watchlist_fetch_order(int* order, int max_count);
+
+// After the window moved: the visible rows not fetched within the last
+// update interval, so a page that scrolls in does not show quotes from
+// several cycles ago. Returns the count.
+int watchlist_page_fetch_order(int* order, int max_count);
+
+#endif
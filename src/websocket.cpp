@@ -0,0 +1,203 @@
+#include <esp_system.h>
+#include "websocket.h"
+#include "logging.h"
+
+#define WS_HANDSHAKE_TIMEOUT_MS 5000
+#define WS_FRAME_TIMEOUT_MS 5000  // Rest of a frame once its first byte is in
+#define WS_READ_POLL_MS 20
+#define WS_HEADER_LINE_MAX 160
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT 0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+static Client* client = nullptr;
+
+static bool read_exact(uint8_t* buf, size_t len, uint32_t timeout_ms) {
+  uint32_t start = millis();
+  size_t got = 0;
+  while (got < len) {
+    int n = client->available() ? client->read(buf + got, len - got) : 0;
+    if (n > 0) {
+      got += n;
+      continue;
+    }
+    if (!client->connected() || millis() - start > timeout_ms) return false;
+    delay(WS_READ_POLL_MS);
+  }
+  return true;
+}
+
+// Read and drop len bytes
+static bool skip(uint64_t len) {
+  uint8_t scratch[64];
+  while (len > 0) {
+    size_t n = len > sizeof(scratch) ? sizeof(scratch) : (size_t)len;
+    if (!read_exact(scratch, n, WS_FRAME_TIMEOUT_MS)) return false;
+    len -= n;
+  }
+  return true;
+}
+
+static bool read_line(char* line, size_t cap) {
+  size_t n = 0;
+  for (;;) {
+    uint8_t c;
+    if (!read_exact(&c, 1, WS_HANDSHAKE_TIMEOUT_MS)) return false;
+    if (c == '\n') break;
+    if (c != '\r' && n < cap - 1) line[n++] = (char)c;
+  }
+  line[n] = '\0';
+  return true;
+}
+
+static void base64_encode(const uint8_t* in, size_t len, char* out) {
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t o = 0;
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t v = in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+    out[o++] = table[(v >> 18) & 63];
+    out[o++] = table[(v >> 12) & 63];
+    out[o++] = i + 1 < len ? table[(v >> 6) & 63] : '=';
+    out[o++] = i + 2 < len ? table[v & 63] : '=';
+  }
+  out[o] = '\0';
+}
+
+bool ws_open(Client& net, const char* host, const char* path) {
+  client = &net;
+
+  uint8_t nonce[16];
+  for (int i = 0; i < 16; i += 4) {
+    uint32_t r = esp_random();
+    memcpy(nonce + i, &r, 4);
+  }
+  char key[25];
+  base64_encode(nonce, sizeof(nonce), key);
+
+  client->printf("GET %s HTTP/1.1\r\n"
+                 "Host: %s\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Key: %s\r\n"
+                 "Sec-WebSocket-Version: 13\r\n"
+                 "Origin: https://finance.yahoo.com\r\n"
+                 "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36\r\n"
+                 "\r\n", path, host, key);
+
+  // The server's accept key is not checked, a 101 is taken at its word
+  char line[WS_HEADER_LINE_MAX];
+  if (!read_line(line, sizeof(line))) return false;
+  bool upgraded = strncmp(line, "HTTP/1.1 101", 12) == 0;
+  if (!upgraded) LOGW("WebSocket: upgrade refused: %s", line);
+  while (line[0] != '\0') {
+    if (!read_line(line, sizeof(line))) return false;
+  }
+  return upgraded;
+}
+
+static bool send_frame(uint8_t opcode, const uint8_t* payload, size_t len) {
+  uint8_t header[8];
+  size_t n = 0;
+  header[n++] = 0x80 | opcode;
+  if (len < 126) {
+    header[n++] = 0x80 | (uint8_t)len;
+  } else {
+    header[n++] = 0x80 | 126;
+    header[n++] = (uint8_t)(len >> 8);
+    header[n++] = (uint8_t)len;
+  }
+  uint32_t r = esp_random();
+  uint8_t* mask = header + n;
+  memcpy(mask, &r, 4);
+  n += 4;
+  if (client->write(header, n) != n) return false;
+
+  uint8_t chunk[64];
+  for (size_t done = 0; done < len;) {
+    size_t count = len - done > sizeof(chunk) ? sizeof(chunk) : len - done;
+    for (size_t i = 0; i < count; i++) {
+      chunk[i] = payload[done + i] ^ mask[(done + i) & 3];
+    }
+    if (client->write(chunk, count) != count) return false;
+    done += count;
+  }
+  return true;
+}
+
+bool ws_send_text(const char* text) {
+  size_t len = strlen(text);
+  return len <= 0xFFFF && send_frame(WS_OP_TEXT, (const uint8_t*)text, len);
+}
+
+WsResult ws_receive(char* buf, size_t cap, size_t* len, uint32_t timeout_ms) {
+  size_t used = 0;
+  bool oversize = false;
+
+  for (;;) {
+    // Only the first byte of a message waits the full timeout
+    uint8_t head[2];
+    if (!read_exact(head, 1, used ? WS_FRAME_TIMEOUT_MS : timeout_ms)) {
+      return client->connected() && used == 0 ? WS_TIMEOUT : WS_CLOSED;
+    }
+    if (!read_exact(head + 1, 1, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+
+    bool fin = head[0] & 0x80;
+    uint8_t opcode = head[0] & 0x0F;
+    bool masked = head[1] & 0x80;
+    uint64_t length = head[1] & 0x7F;
+    uint8_t ext[8];
+    if (length == 126) {
+      if (!read_exact(ext, 2, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+      length = (ext[0] << 8) | ext[1];
+    } else if (length == 127) {
+      if (!read_exact(ext, 8, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+      length = 0;
+      for (int i = 0; i < 8; i++) length = (length << 8) | ext[i];
+    }
+    uint8_t mask[4] = {0, 0, 0, 0};
+    if (masked && !read_exact(mask, 4, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+
+    if (opcode >= WS_OP_CLOSE) {
+      // Control frames may come between the fragments of a message
+      uint8_t payload[125];
+      if (length > sizeof(payload) || !read_exact(payload, length, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+      for (size_t i = 0; i < length; i++) payload[i] ^= mask[i & 3];
+      if (opcode == WS_OP_CLOSE) return WS_CLOSED;
+      if (opcode == WS_OP_PING && !send_frame(WS_OP_PONG, payload, length)) return WS_CLOSED;
+      continue;
+    }
+    if (opcode != WS_OP_TEXT && opcode != WS_OP_BINARY && opcode != WS_OP_CONTINUATION) return WS_CLOSED;
+
+    if (oversize || used + length > cap - 1) {
+      oversize = true;
+      if (!skip(length)) return WS_CLOSED;
+    } else {
+      if (!read_exact((uint8_t*)buf + used, length, WS_FRAME_TIMEOUT_MS)) return WS_CLOSED;
+      for (size_t i = 0; i < length; i++) buf[used + i] ^= mask[i & 3];
+      used += length;
+    }
+
+    if (fin) {
+      if (oversize) {
+        LOGW("WebSocket: message too long, skipped");
+        used = 0;
+        oversize = false;
+        continue;
+      }
+      buf[used] = '\0';
+      *len = used;
+      return WS_MESSAGE;
+    }
+  }
+}
+
+void ws_close() {
+  if (!client) return;
+  if (client->connected()) send_frame(WS_OP_CLOSE, nullptr, 0);
+  client->stop();
+  client = nullptr;
+}
@@ -0,0 +1,31 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Minimal WebSocket client (RFC 6455) for the quote stream: one connection
+// at a time, text messages only, no extensions. Nothing is allocated; the
+// caller passes the buffer messages are assembled in. Pings are answered
+// and fragmented messages joined inside ws_receive().
+
+enum WsResult {
+  WS_MESSAGE,  // A whole message is in the buffer
+  WS_TIMEOUT,  // Nothing arrived in time, the connection is still open
+  WS_CLOSED    // Closed by the server, dropped, or a protocol error
+};
+
+// Upgrade an already connected client. Blocks for the handshake.
+bool ws_open(Client& net, const char* host, const char* path);
+
+// Send one text message (masked, as clients must)
+bool ws_send_text(const char* text);
+
+// Wait up to timeout_ms for the next message. Messages longer than cap - 1
+// bytes are skipped. The message is NUL-terminated.
+WsResult ws_receive(char* buf, size_t cap, size_t* len, uint32_t timeout_ms);
+
+// Send a close frame and stop the client
+void ws_close();
+
+#endif
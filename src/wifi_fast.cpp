@@ -0,0 +1,116 @@
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
+#include "wifi_fast.h"
+#include "logging.h"
+#include "../config.h"
+
+#define FAST_NVS_NAMESPACE "wifi_fast"
+#define FAST_POLL_MS 10
+
+struct FastConnectCache {
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;       // Last DHCP lease, 0 = none
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+static bool load_cache(FastConnectCache* c) {
+  Preferences prefs;
+  if (!prefs.begin(FAST_NVS_NAMESPACE, true)) return false;
+  bool ok = prefs.getBytes("cache", c, sizeof(*c)) == sizeof(*c);
+  prefs.end();
+  return ok && c->channel > 0;
+}
+
+static void forget_cache() {
+  Preferences prefs;
+  if (prefs.begin(FAST_NVS_NAMESPACE, false)) {
+    prefs.remove("cache");
+    prefs.end();
+  }
+}
+
+bool wifi_fast_connect() {
+  FastConnectCache c;
+  if (!load_cache(&c)) {
+    LOGI("Fast connect: nothing cached yet");
+    return false;
+  }
+
+  // WiFiManager saved the credentials in the driver's own config
+  WiFi.mode(WIFI_STA);
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK || conf.sta.ssid[0] == '\0') {
+    LOGI("Fast connect: no saved credentials");
+    return false;
+  }
+
+  char ssid[33];
+  char password[65];
+  memcpy(ssid, conf.sta.ssid, 32);
+  ssid[32] = '\0';
+  memcpy(password, conf.sta.password, 64);
+  password[64] = '\0';
+
+  bool reused_lease = false;
+#if WIFI_STATIC_IP
+  WiFi.config(IPAddress(WIFI_STATIC_ADDRESS), IPAddress(WIFI_STATIC_GATEWAY),
+              IPAddress(WIFI_STATIC_SUBNET), IPAddress(WIFI_STATIC_DNS));
+#elif WIFI_REUSE_LEASE
+  if (c.ip != 0) {
+    WiFi.config(IPAddress(c.ip), IPAddress(c.gateway), IPAddress(c.subnet), IPAddress(c.dns));
+    reused_lease = true;
+  }
+#endif
+
+  LOGI("Fast connect to %s on channel %d%s...", ssid, c.channel,
+       reused_lease ? " with cached lease" : "");
+  unsigned long start = millis();
+  WiFi.begin(ssid, password, c.channel, c.bssid);
+
+  while (WiFi.status() != WL_CONNECTED) {
+    if (millis() - start > WIFI_FAST_CONNECT_TIMEOUT_MS) {
+      LOGW("Fast connect timed out");
+      WiFi.disconnect();
+      if (reused_lease) {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // Back to DHCP
+      }
+      // The access point probably moved; WiFiManager will find it and the
+      // new details get cached then
+      forget_cache();
+      return false;
+    }
+    delay(FAST_POLL_MS);
+  }
+
+  LOGI("Fast connect took %lu ms", millis() - start);
+  return true;
+}
+
+void wifi_fast_remember() {
+  if (WiFi.status() != WL_CONNECTED) return;
+
+  FastConnectCache c;
+  memset(&c, 0, sizeof(c));
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) return;
+  memcpy(c.bssid, bssid, sizeof(c.bssid));
+  c.channel = WiFi.channel();
+  c.ip = (uint32_t)WiFi.localIP();
+  c.gateway = (uint32_t)WiFi.gatewayIP();
+  c.subnet = (uint32_t)WiFi.subnetMask();
+  c.dns = (uint32_t)WiFi.dnsIP();
+
+  FastConnectCache old;
+  if (load_cache(&old) && memcmp(&old, &c, sizeof(c)) == 0) return;
+
+  Preferences prefs;
+  if (!prefs.begin(FAST_NVS_NAMESPACE, false)) return;
+  prefs.putBytes("cache", &c, sizeof(c));
+  prefs.end();
+  LOGI("Cached WiFi details: channel %d, IP %s", c.channel, WiFi.localIP().toString().c_str());
+}
@@ -0,0 +1,23 @@
+#ifndef WIFI_FAST_H
+#define WIFI_FAST_H
+
+#include <Arduino.h>
+
+// Fast reconnect for the usual case of a device that boots on the same
+// network every time. The access point (BSSID), its channel and the last
+// DHCP lease are cached in NVS, so the connect skips the channel scan and,
+// with WIFI_REUSE_LEASE, the DHCP exchange (the address then becomes a
+// static one that is never renewed). WIFI_STATIC_IP replaces the
+// cached lease with a fixed address. Credentials are the ones WiFiManager
+// already saved.
+
+// Try a direct connect with the cached details. Returns false (with WiFi
+// left idle) if nothing is cached or it did not connect in time; the caller
+// then falls back to WiFiManager.
+bool wifi_fast_connect();
+
+// Cache the details of the current connection. Only writes NVS when they
+// changed. Call once connected, whichever way.
+void wifi_fast_remember();
+
+#endif
@@ -0,0 +1,129 @@
+#include <ArduinoJson.h>
+#include "yahoo_api.h"
+#include "logging.h"
+#include "../config.h"
+
+#define YAHOO_QUOTE_DOC_SIZE 4096 // Filtered: four fields per symbol
+
+void yahoo_begin(HTTPClient& http, const String& url) {
+  http.begin(url);
+  http.setTimeout(15000); // Increased timeout to 15 seconds
+  http.addHeader("User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36");
+  http.addHeader("Accept", "application/json");
+  http.addHeader("Connection", "close");
+}
+
+bool yahoo_fetch_quote(const char* symbol, YahooQuote* quote, FetchStatus* status) {
+  // Using Yahoo Finance API (free, no API key needed)
+  String url = String(YAHOO_CHART_URL) + symbol;
+
+  LOGD("Fetching %s...", symbol);
+  LOGD("URL: %s", url.c_str());
+
+  uint32_t start = micros();
+  HTTPClient http;
+  yahoo_begin(http, url);
+
+  bool ok = false;
+  int httpCode = http.GET();
+  LOGD("HTTP Response Code: %d", httpCode);
+  status->http_code = httpCode;
+  status->parse_error = false;
+
+  if (httpCode == HTTP_CODE_OK) {
+    String payload = http.getString();
+    LOGD("Payload length: %d", payload.length());
+
+    DynamicJsonDocument doc(40 * 1024); // Increased to 40KB for large Yahoo responses
+    DeserializationError error = deserializeJson(doc, payload);
+
+    if (error) {
+      LOGW("JSON parse error: %s", error.c_str());
+      status->parse_error = true;
+    } else if (doc["chart"]["result"][0]["meta"]) {
+      JsonObject meta = doc["chart"]["result"][0]["meta"];
+
+      quote->price = meta["regularMarketPrice"];
+      quote->prev_close = meta["previousClose"];
+      quote->volume = meta["regularMarketVolume"];
+      quote->market_time = meta["regularMarketTime"] | 0;
+
+      LOGD("Raw data - Current: %.2f, Previous: %.2f", quote->price, quote->prev_close);
+
+      if (quote->price > 0 && quote->prev_close > 0) {
+        ok = true;
+      } else {
+        LOGE("ERROR: Invalid price data for %s", symbol);
+        status->parse_error = true;
+      }
+    } else {
+      LOGE("ERROR: No chart data found");
+      status->parse_error = true;
+    }
+  } else {
+    LOGW("HTTP GET failed: %d", httpCode);
+  }
+
+  http.end();
+  status->latency_us = micros() - start;
+  return ok;
+}
+
+int yahoo_fetch_quotes(const char* const* symbols, int count,
+                       YahooQuote* quotes, bool* ok, FetchStatus* status) {
+  String url = YAHOO_QUOTE_URL;
+  for (int i = 0; i < count; i++) {
+    if (i) url += ',';
+    url += symbols[i];
+    ok[i] = false;
+  }
+  LOGI("Fetching %d quotes from Yahoo", count);
+
+  uint32_t start = micros();
+  HTTPClient http;
+  http.useHTTP10(true); // No chunked encoding, so the body can be parsed straight from the stream
+  yahoo_begin(http, url);
+
+  int received = 0;
+  int httpCode = http.GET();
+  status->http_code = httpCode;
+  status->parse_error = false;
+
+  if (httpCode == HTTP_CODE_OK) {
+    // Only these fields are kept, the other ~80 per symbol are skipped as
+    // they stream past
+    StaticJsonDocument<192> filter;
+    filter["quoteResponse"]["result"][0]["symbol"] = true; // [0] stands for every element
+    filter["quoteResponse"]["result"][0]["regularMarketPrice"] = true;
+    filter["quoteResponse"]["result"][0]["regularMarketPreviousClose"] = true;
+    filter["quoteResponse"]["result"][0]["regularMarketVolume"] = true;
+    filter["quoteResponse"]["result"][0]["regularMarketTime"] = true;
+
+    DynamicJsonDocument doc(YAHOO_QUOTE_DOC_SIZE);
+    DeserializationError error = deserializeJson(doc, *http.getStreamPtr(), DeserializationOption::Filter(filter));
+    if (error) {
+      LOGW("JSON parse error: %s", error.c_str());
+    }
+
+    for (JsonObject r : doc["quoteResponse"]["result"].as<JsonArray>()) {
+      const char* symbol = r["symbol"] | "";
+      for (int i = 0; i < count; i++) {
+        if (ok[i] || strcasecmp(symbols[i], symbol) != 0) continue;
+        quotes[i].price = r["regularMarketPrice"];
+        quotes[i].prev_close = r["regularMarketPreviousClose"];
+        quotes[i].volume = r["regularMarketVolume"];
+        quotes[i].market_time = r["regularMarketTime"] | 0;
+        ok[i] = quotes[i].price > 0 && quotes[i].prev_close > 0;
+        if (ok[i]) received++;
+        break;
+      }
+    }
+    status->parse_error = received < count;
+  } else {
+    LOGW("HTTP GET failed: %d", httpCode);
+  }
+
+  http.end();
+  status->latency_us = micros() - start;
+  return received;
+}
@@ -0,0 +1,34 @@
+#ifndef YAHOO_API_H
+#define YAHOO_API_H
+
+#include <HTTPClient.h>
+
+struct YahooQuote {
+  float price;
+  float prev_close;
+  uint32_t volume; // Day's cumulative volume, 0 if missing
+  uint32_t market_time; // Unix time the exchange priced it, 0 if the source does not say
+};
+
+// How a request went, for the metrics page
+struct FetchStatus {
+  int16_t http_code;   // HTTP status, negative for connection errors (HTTPClient codes)
+  bool parse_error;    // A response arrived but had no usable quote
+  uint32_t latency_us; // Whole request including the TLS handshake
+  uint8_t batch;       // Symbols asked for in the request
+  uint8_t received;    // Quotes that came back
+};
+
+// Start a request to the Yahoo Finance API with the headers it expects
+void yahoo_begin(HTTPClient& http, const String& url);
+
+// Fetch the current quote for one symbol. Blocks for the whole request, so
+// it is only called from the fetch task.
+bool yahoo_fetch_quote(const char* symbol, YahooQuote* quote, FetchStatus* status);
+
+// Fetch quotes for count symbols in one request to the v7 quote endpoint.
+// Same contract as aggregator_fetch_quotes. Blocks.
+int yahoo_fetch_quotes(const char* const* symbols, int count,
+                       YahooQuote* quotes, bool* ok, FetchStatus* status);
+
+#endif
@@ -0,0 +1,151 @@
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "yahoo_stream.h"
+#include "websocket.h"
+#include "pricing_data.h"
+#include "logging.h"
+#include "../config.h"
+
+// The task and its buffers only exist in streaming mode
+#if QUOTE_SOURCE == QUOTE_SOURCE_STREAM
+
+#define STREAM_TASK_STACK 8192 // TLS
+#define STREAM_TASK_PRIORITY 1
+#define STREAM_TASK_CORE 0     // Next to the fetch task, away from the main loop
+#define STREAM_QUEUE_LENGTH (NUM_STOCKS + 4)
+#define STREAM_CONNECT_TIMEOUT_MS 5000
+#define STREAM_RETRY_MS 10000
+#define STREAM_RECEIVE_TIMEOUT_MS 30000
+// Nothing streams outside market hours. After this long without a message
+// the connection is renewed, in case it died without a close.
+#define STREAM_SILENT_RECONNECT_MS (10 * 60 * 1000UL)
+#define STREAM_MESSAGE_MAX 1024
+#define STREAM_SUBSCRIBE_MAX 512
+
+struct StreamUpdate {
+  int16_t index;
+  YahooQuote quote;
+};
+
+static QueueHandle_t update_queue = nullptr;
+static volatile bool live = false;
+
+// Task only
+#if STREAM_TLS
+static WiFiClientSecure net;
+#else
+static WiFiClient net;
+#endif
+static char message[STREAM_MESSAGE_MAX];
+
+static bool send_subscribe() {
+  char text[STREAM_SUBSCRIBE_MAX];
+  int len = snprintf(text, sizeof(text), "{\"subscribe\":[");
+  for (int i = 0; i < NUM_STOCKS && len < (int)sizeof(text); i++) {
+    len += snprintf(text + len, sizeof(text) - len, "%s\"%s\"", i ? "," : "", STOCK_SYMBOLS[i]);
+  }
+  if (len + 3 > (int)sizeof(text)) return false;
+  strcpy(text + len, "]}");
+  return ws_send_text(text);
+}
+
+// Last previous close worked out per symbol. Stream task only.
+static float known_prev_close[NUM_STOCKS];
+
+// The streamer sends the change rather than always the previous close.
+// Protobuf leaves out zero fields, so a message without either says
+// nothing: the last known previous close stands, 0 if there is none yet.
+static float previous_close(const PricingData& d, int index) {
+  float prev_close = 0;
+  if (d.previous_close > 0) {
+    prev_close = d.previous_close;
+  } else if (d.change != 0) {
+    prev_close = d.price - d.change;
+  } else if (d.change_percent != 0 && d.change_percent > -100) {
+    prev_close = d.price / (1 + d.change_percent / 100);
+  }
+  if (prev_close > 0) known_prev_close[index] = prev_close;
+  return known_prev_close[index];
+}
+
+static void deliver(const PricingData& d) {
+  for (int i = 0; i < NUM_STOCKS; i++) {
+    if (strcmp(STOCK_SYMBOLS[i], d.id) != 0) continue;
+    StreamUpdate u;
+    u.index = i;
+    u.quote.price = d.price;
+    u.quote.prev_close = previous_close(d, i); // 0 drops the update below
+    u.quote.volume = d.day_volume < 0 ? 0 : d.day_volume > UINT32_MAX ? UINT32_MAX : (uint32_t)d.day_volume;
+    u.quote.market_time = d.time_ms > 0 ? (uint32_t)(d.time_ms / 1000) : 0;
+    // A newer trade for the symbol follows soon
+    if (u.quote.price > 0 && u.quote.prev_close > 0) xQueueSend(update_queue, &u, 0);
+  }
+}
+
+static void receive() {
+  unsigned long last_message = millis();
+  for (;;) {
+    size_t len;
+    WsResult r = ws_receive(message, sizeof(message), &len, STREAM_RECEIVE_TIMEOUT_MS);
+    if (r == WS_CLOSED) return;
+    if (r == WS_TIMEOUT) {
+      if (millis() - last_message > STREAM_SILENT_RECONNECT_MS) return;
+      continue;
+    }
+
+    last_message = millis();
+    PricingData d;
+    if (pricing_parse_message(message, len, &d)) {
+      deliver(d);
+    }
+  }
+}
+
+static void stream_task(void*) {
+#if STREAM_TLS
+  net.setInsecure(); // Same trust as the chart requests: none pinned
+#endif
+  for (;;) {
+    if (WiFi.status() != WL_CONNECTED) {
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (net.connect(STREAM_HOST, STREAM_PORT, STREAM_CONNECT_TIMEOUT_MS) &&
+        ws_open(net, STREAM_HOST, STREAM_PATH) && send_subscribe()) {
+      LOGI("Stream: subscribed to %d symbols at %s", NUM_STOCKS, STREAM_HOST);
+      live = true;
+      receive();
+      live = false;
+      LOGW("Stream: connection lost, polling until it is back");
+    } else {
+      LOGW("Stream: could not connect to %s", STREAM_HOST);
+    }
+    ws_close();
+    net.stop();
+    vTaskDelay(pdMS_TO_TICKS(STREAM_RETRY_MS));
+  }
+}
+
+void yahoo_stream_begin() {
+  update_queue = xQueueCreate(STREAM_QUEUE_LENGTH, sizeof(StreamUpdate));
+  xTaskCreatePinnedToCore(stream_task, "stream", STREAM_TASK_STACK, nullptr,
+                          STREAM_TASK_PRIORITY, nullptr, STREAM_TASK_CORE);
+}
+
+bool yahoo_stream_live() {
+  return live;
+}
+
+bool yahoo_stream_poll(int* index, YahooQuote* quote) {
+  StreamUpdate u;
+  if (!update_queue || xQueueReceive(update_queue, &u, 0) != pdTRUE) return false;
+  *index = u.index;
+  *quote = u.quote;
+  return true;
+}
+
+#endif
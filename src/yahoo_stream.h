@@ -0,0 +1,21 @@
+#ifndef YAHOO_STREAM_H
+#define YAHOO_STREAM_H
+
+#include "yahoo_api.h"
+
+// Real-time quotes from Yahoo's streamer (QUOTE_SOURCE_STREAM). A task on
+// core 0 holds a WebSocket open to STREAM_HOST, subscribes to the
+// watchlist and decodes each PricingData message as trades come in. The
+// main loop takes the quotes from a queue, so the quote store is still
+// only written from there. stream_replay/ replays recorded messages for
+// testing without Yahoo.
+
+void yahoo_stream_begin();
+
+// True while the stream is connected and subscribed. Polling can pause.
+bool yahoo_stream_live();
+
+// Take the next streamed quote for STOCK_SYMBOLS[*index]. Never blocks.
+bool yahoo_stream_poll(int* index, YahooQuote* quote);
+
+#endif
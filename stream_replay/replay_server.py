@@ -0,0 +1,256 @@
+"""Stand-in for Yahoo's quote streamer, for testing QUOTE_SOURCE_STREAM
+without the real one (set STREAM_HOST to this machine, STREAM_PORT 8765 and
+STREAM_TLS 0).
+
+Accepts WebSocket connections, prints each subscribe message and replays a
+recording to every client in a loop. A recording has one message per line:
+
+    <delay in ms> <text message exactly as the streamer sent it>
+
+Modes:
+
+    python3 replay_server.py [--port 8765] [recording]
+    python3 replay_server.py --generate recording.txt [count] [symbols...]
+    python3 replay_server.py --record recording.txt [seconds] [symbols...]
+
+--generate synthesizes PricingData messages in the streamer's JSON envelope.
+--record connects to the real streamer and saves what it sends.
+"""
+
+import base64
+import hashlib
+import json
+import os
+import random
+import socket
+import ssl
+import struct
+import sys
+import threading
+import time
+
+GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC11B85"
+STREAMER = ("streamer.finance.yahoo.com", 443, "/?version=2")
+DEFAULT_SYMBOLS = ["AAPL", "GOOGL", "NVDA", "TSLA", "META", "AMZN", "MSFT", "AMD"]
+
+OP_TEXT = 0x1
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+
+def read_exact(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("closed")
+        data += chunk
+    return data
+
+
+def send_frame(sock, opcode, payload, mask=False):
+    head = bytes([0x80 | opcode])
+    n = len(payload)
+    bit = 0x80 if mask else 0
+    if n < 126:
+        head += bytes([bit | n])
+    elif n < 65536:
+        head += bytes([bit | 126]) + struct.pack(">H", n)
+    else:
+        head += bytes([bit | 127]) + struct.pack(">Q", n)
+    if mask:
+        key = os.urandom(4)
+        payload = bytes(b ^ key[i & 3] for i, b in enumerate(payload))
+        head += key
+    sock.sendall(head + payload)
+
+
+def read_frame(sock):
+    b0, b1 = read_exact(sock, 2)
+    n = b1 & 0x7F
+    if n == 126:
+        n = struct.unpack(">H", read_exact(sock, 2))[0]
+    elif n == 127:
+        n = struct.unpack(">Q", read_exact(sock, 8))[0]
+    key = read_exact(sock, 4) if b1 & 0x80 else b"\0\0\0\0"
+    payload = bytes(b ^ key[i & 3] for i, b in enumerate(read_exact(sock, n)))
+    return b0 & 0x0F, payload
+
+
+def read_headers(sock):
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise ConnectionError("closed during the handshake")
+        data += chunk
+    lines = data.split(b"\r\n\r\n")[0].decode("latin-1").split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+    return lines[0], headers
+
+
+# --- Protobuf, just enough for PricingData ---
+
+def varint(v):
+    out = b""
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out += bytes([b | 0x80])
+        else:
+            return out + bytes([b])
+
+
+def zigzag(v):
+    return (v << 1) ^ (v >> 63)
+
+
+def pricing_data(symbol, price, previous_close, time_ms, volume):
+    change = price - previous_close
+    fields = [
+        varint(1 << 3 | 2) + varint(len(symbol)) + symbol.encode(),
+        varint(2 << 3 | 5) + struct.pack("<f", price),
+        varint(3 << 3 | 0) + varint(zigzag(time_ms)),
+        varint(8 << 3 | 5) + struct.pack("<f", change / previous_close * 100),
+        varint(9 << 3 | 0) + varint(zigzag(volume)),
+        varint(12 << 3 | 5) + struct.pack("<f", change),
+    ]
+    return b"".join(fields)
+
+
+def generate(path, count, symbols):
+    rng = random.Random(1)
+    state = {}
+    for s in symbols:
+        base = 20 + sum(map(ord, s)) % 400
+        state[s] = [float(base), float(base), rng.randint(1, 5) * 10 ** 6]
+    now = int(time.time() * 1000)
+    with open(path, "w") as f:
+        for _ in range(count):
+            s = rng.choice(symbols)
+            p = state[s]
+            p[0] = round(max(1.0, p[0] * (1 + rng.uniform(-0.002, 0.002))), 2)
+            p[2] += rng.randint(100, 5000)
+            delay = rng.randint(50, 800)
+            now += delay
+            message = base64.b64encode(pricing_data(s, p[0], p[1], now, p[2])).decode()
+            f.write("%d %s\n" % (delay, json.dumps({"type": "pricing", "message": message}, separators=(",", ":"))))
+    print("wrote %d messages for %d symbols to %s" % (count, len(symbols), path))
+
+
+def record(path, seconds, symbols):
+    host, port, resource = STREAMER
+    sock = ssl.create_default_context().wrap_socket(
+        socket.create_connection((host, port), timeout=30), server_hostname=host)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\n"
+                  "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+                  "Sec-WebSocket-Version: 13\r\nOrigin: https://finance.yahoo.com\r\n\r\n"
+                  % (resource, host, key)).encode())
+    status, _ = read_headers(sock)
+    if " 101 " not in status + " ":
+        sys.exit("upgrade refused: " + status)
+    send_frame(sock, OP_TEXT, json.dumps({"subscribe": symbols}).encode(), mask=True)
+
+    count = 0
+    end = time.time() + seconds
+    last = time.time()
+    with open(path, "w") as f:
+        while time.time() < end:
+            opcode, payload = read_frame(sock)
+            if opcode == OP_CLOSE:
+                break
+            if opcode == OP_PING:
+                send_frame(sock, OP_PONG, payload, mask=True)
+                continue
+            now = time.time()
+            f.write("%d %s\n" % ((now - last) * 1000, payload.decode()))
+            last = now
+            count += 1
+    print("recorded %d messages to %s" % (count, path))
+
+
+# --- Server ---
+
+def load(path):
+    messages = []
+    with open(path) as f:
+        for line in f:
+            delay, _, text = line.rstrip("\n").partition(" ")
+            if text:
+                messages.append((int(delay), text.encode()))
+    return messages
+
+
+def serve_client(conn, addr, messages):
+    try:
+        _, headers = read_headers(conn)
+        accept = base64.b64encode(hashlib.sha1(
+            (headers.get("sec-websocket-key", "") + GUID).encode()).digest()).decode()
+        conn.sendall(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                      "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n" % accept).encode())
+
+        closed = threading.Event()
+
+        def reader():
+            try:
+                while True:
+                    opcode, payload = read_frame(conn)
+                    if opcode == OP_CLOSE:
+                        break
+                    if opcode == OP_TEXT:
+                        print("%s: %s" % (addr[0], payload.decode(errors="replace")))
+            except (ConnectionError, OSError):
+                pass
+            closed.set()
+
+        threading.Thread(target=reader, daemon=True).start()
+        while not closed.is_set():
+            for delay, text in messages:
+                if closed.wait(delay / 1000):
+                    break
+                send_frame(conn, OP_TEXT, text)
+        print("%s: disconnected" % addr[0])
+    except (ConnectionError, OSError) as e:
+        print("%s: %s" % (addr[0], e))
+    finally:
+        conn.close()
+
+
+def serve(port, path):
+    messages = load(path)
+    if not messages:
+        sys.exit("nothing to replay in " + path)
+    server = socket.create_server(("", port))
+    print("replaying %d messages from %s on port %d" % (len(messages), path, port))
+    while True:
+        conn, addr = server.accept()
+        print("%s: connected" % addr[0])
+        threading.Thread(target=serve_client, args=(conn, addr, messages), daemon=True).start()
+
+
+def main():
+    args = sys.argv[1:]
+    here = os.path.dirname(os.path.abspath(__file__))
+    if args and args[0] in ("--generate", "--record"):
+        if len(args) < 2:
+            sys.exit(__doc__)
+        number = int(args[2]) if len(args) > 2 else (500 if args[0] == "--generate" else 60)
+        symbols = args[3:] or DEFAULT_SYMBOLS
+        (generate if args[0] == "--generate" else record)(args[1], number, symbols)
+        return
+
+    port = 8765
+    if args[:1] == ["--port"]:
+        port = int(args[1])
+        args = args[2:]
+    serve(port, args[0] if args else os.path.join(here, "recording.txt"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,121 @@
+"""Checks that the TFT_eSPI fonts loaded in platformio.ini are the ones the
+firmware draws with.
+
+Every LOAD_FONTn flag links that font's tables whether or not it is used,
+and SMOOTH_FONT brings the file system code along for .vlw fonts. This
+scans src/ for the fonts the code selects and fails the build if one of
+them is not loaded (TFT_eSPI would silently draw nothing), and lists the
+loaded ones nothing uses so they can be taken out.
+
+Runs before every build (extra_scripts in platformio.ini), or by hand:
+
+    python3 tools/font_check.py [--glyphs]
+
+--glyphs also lists the characters of the text drawn from string literals.
+"""
+
+import os
+import re
+import sys
+
+# Flag -> font number(s) and the flash it costs, from TFT_eSPI's User_Setup.h
+FONTS = {
+    "LOAD_GLCD": (1, 1820),
+    "LOAD_FONT2": (2, 3534),
+    "LOAD_FONT4": (4, 5848),
+    "LOAD_FONT6": (6, 2666),
+    "LOAD_FONT7": (7, 2438),
+    "LOAD_FONT8": (8, 3256),
+}
+GFXFF = "LOAD_GFXFF"  # The free fonts themselves are only linked when used
+SMOOTH = "SMOOTH_FONT"
+SMOOTH_COST = 20000   # Smooth font renderer and file system code
+
+TEXT_CALLS = r"(?:print|println|printf|drawString|drawCentreString|drawRightString|drawNumber|drawFloat|drawChar)"
+SET_FONT = re.compile(r"\bsetTextFont\s*\(\s*(\d+)\s*\)")
+FONT_ARG = re.compile(r"\b(?:drawString|drawCentreString|drawRightString|drawNumber|drawFloat|drawChar)\s*\([^;]*,\s*(\d+)\s*\)\s*;")
+FREE_FONT = re.compile(r"\b(?:setFreeFont|setFont)\s*\(|\bGFXfont\b")
+LOAD_FONT = re.compile(r"\bloadFont\s*\(")
+DISPLAY = r"\b(?:tft|\w*[sS]prite)\s*(?:\.|->)"  # Not Serial, clients, ...
+DRAW_TEXT = re.compile(DISPLAY + TEXT_CALLS + r"\s*\(")
+LITERAL = re.compile(DISPLAY + TEXT_CALLS + r"\s*\(\s*\"((?:[^\"\\]|\\.)*)\"")
+COMMENT = re.compile(r"//[^\n]*|/\*.*?\*/", re.S)
+
+
+def sources(src_dir):
+    for root, _, files in os.walk(src_dir):
+        for name in sorted(files):
+            if name.endswith((".cpp", ".c", ".h", ".ino")):
+                path = os.path.join(root, name)
+                with open(path, encoding="utf-8", errors="replace") as f:
+                    yield path, COMMENT.sub("", f.read())
+
+
+def scan(src_dir):
+    """Flags the code needs, with where each is first needed, and the
+    characters of literal text."""
+    needed = {}
+    glyphs = set()
+    for path, text in sources(src_dir):
+        name = os.path.relpath(path, os.path.dirname(src_dir))
+        for number in SET_FONT.findall(text) + FONT_ARG.findall(text):
+            flag = next((f for f, (n, _) in FONTS.items() if n == int(number)), None)
+            if flag:
+                needed.setdefault(flag, name)
+        # Text drawn before any setTextFont() uses font 1
+        if DRAW_TEXT.search(text):
+            needed.setdefault("LOAD_GLCD", name)
+        if FREE_FONT.search(text):
+            needed.setdefault(GFXFF, name)
+        if LOAD_FONT.search(text):
+            needed.setdefault(SMOOTH, name)
+        for literal in LITERAL.findall(text):
+            glyphs.update(re.sub(r"%[-+ 0#]*\d*(?:\.\d+)?l*[diuxXfsc]|\\n", "", literal))
+    return needed, glyphs
+
+
+def loaded_flags(build_flags):
+    flags = set()
+    for flag in " ".join(build_flags).split():
+        if flag.startswith("-D"):
+            name = flag[2:].split("=")[0]
+            if name in FONTS or name in (GFXFF, SMOOTH):
+                flags.add(name)
+    return flags
+
+
+def check(project_dir, build_flags):
+    """Prints the findings; False if a font the code uses is not loaded."""
+    needed, _ = scan(os.path.join(project_dir, "src"))
+    loaded = loaded_flags(build_flags)
+    ok = True
+    for flag, where in sorted(needed.items()):
+        if flag not in loaded:
+            print("font_check: %s uses a font that needs -D%s=1 in platformio.ini" % (where, flag))
+            ok = False
+    unused = sorted(loaded - set(needed))
+    if unused:
+        cost = sum(FONTS[f][1] for f in unused if f in FONTS) + (SMOOTH_COST if SMOOTH in unused else 0)
+        print("font_check: loaded but unused: %s (about %d bytes of flash)" % (", ".join(unused), cost))
+    return ok
+
+
+def main():
+    project_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    with open(os.path.join(project_dir, "platformio.ini")) as f:
+        ini = f.read()
+    build_flags = re.findall(r"^\s*(-D\S+)", ini, re.M)
+    ok = check(project_dir, build_flags)
+    needed, glyphs = scan(os.path.join(project_dir, "src"))
+    print("fonts used: " + ", ".join("%s (%s)" % (f, w) for f, w in sorted(needed.items())))
+    if "--glyphs" in sys.argv:
+        print("%d characters in literal text: %s" % (len(glyphs), "".join(sorted(glyphs))))
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
+else:
+    Import("env")  # noqa: F821 - run by PlatformIO
+    if not check(env["PROJECT_DIR"], env.GetProjectOption("build_flags", [])):  # noqa: F821
+        env.Exit(1)  # noqa: F821
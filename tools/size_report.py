@@ -0,0 +1,181 @@
+"""Firmware size per component, from the linker map.
+
+After every build (extra_scripts in platformio.ini) this prints what each
+part of the firmware adds to the image: our sources one by one, each
+library, each ESP-IDF component and the toolchain libraries. Code and
+read-only data are what the image, and so flashing and OTA downloads,
+carry; bss only takes RAM. The report is saved next to the firmware and
+the next build shows what changed against it.
+
+By hand:
+
+    python3 tools/size_report.py [options] firmware.map
+      --top N           also list the N largest sections (functions, tables)
+      --component NAME  only the sections of one component, e.g. TFT_eSPI
+      --save FILE       save the totals as JSON
+      --compare FILE    show the change against saved totals
+"""
+
+import json
+import os
+import re
+import sys
+
+OUTPUT = re.compile(r"^(\.\S+)")
+INPUT = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+))?$")
+CONTINUED = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+)$")
+ARCHIVE = re.compile(r"lib([^/\\]+)\.a\((.+)\)$")
+
+COLUMNS = ("code", "rodata", "data", "bss")
+
+
+def kind(output_section):
+    """Column for an output section, ESP32 (.flash.text, .dram0.bss, ...)
+    or plain (.text, .bss, ...)."""
+    name = output_section.lower()
+    if "bss" in name or "noinit" in name:
+        return "bss"
+    if "rodata" in name or "appdesc" in name:
+        return "rodata"
+    if "text" in name or "vectors" in name or "literal" in name:
+        return "code"
+    if "data" in name:
+        return "data"
+    return None  # Debug info and the like
+
+
+def component(path):
+    path = path.strip()
+    match = ARCHIVE.search(path)
+    if match:
+        return match.group(1)
+    parts = re.split(r"[/\\]", path)
+    if "src" in parts:
+        return "/".join(parts[parts.index("src"):]).replace(".o", "")
+    return os.path.basename(path)
+
+
+def sections(map_path):
+    """(column, component, section name, size) for everything that lands
+    in the image or in RAM."""
+    with open(map_path, encoding="utf-8", errors="replace") as f:
+        lines = f.read().split("\n")
+    try:
+        lines = lines[lines.index("Linker script and memory map") + 1:]
+    except ValueError:
+        pass
+
+    output = None
+    pending = None  # Input section whose address is on the next line
+    for line in lines:
+        if pending:
+            match = CONTINUED.match(line)
+            if match:
+                size, path = int(match.group(2), 16), match.group(3)
+                if size and kind(output):
+                    yield kind(output), component(path), pending, size
+            pending = None
+            continue
+        match = OUTPUT.match(line)
+        if match:
+            output = match.group(1)
+            continue
+        match = INPUT.match(line)
+        if match and output:
+            if match.group(2) is None:
+                pending = match.group(1)
+                continue
+            size, path = int(match.group(3), 16), match.group(4)
+            if size and kind(output) and not path.startswith("*"):
+                yield kind(output), component(path), match.group(1), size
+
+
+def totals(entries):
+    result = {}
+    for column, name, _, size in entries:
+        row = result.setdefault(name, dict.fromkeys(COLUMNS, 0))
+        row[column] += size
+    return result
+
+
+def image_bytes(row):
+    return row["code"] + row["rodata"] + row["data"]
+
+
+def print_report(result, previous=None):
+    print("%-28s %9s %9s %9s %9s %9s" % (("component",) + COLUMNS + ("image",)) +
+          ("  %9s" % "change" if previous is not None else ""))
+    names = sorted(result, key=lambda n: -image_bytes(result[n]))
+    for name in names:
+        row = result[name]
+        line = "%-28s %9d %9d %9d %9d %9d" % ((name[:28],) + tuple(row[c] for c in COLUMNS) + (image_bytes(row),))
+        if previous is not None:
+            change = image_bytes(row) - image_bytes(previous.get(name, dict.fromkeys(COLUMNS, 0)))
+            line += "  %+9d" % change if change else ""
+        print(line)
+    if previous is not None:
+        for name in sorted(set(previous) - set(result)):
+            print("%-28s %9s %9s %9s %9s %9s  %+9d" % (name[:28], "-", "-", "-", "-", "-", -image_bytes(previous[name])))
+    total = {c: sum(r[c] for r in result.values()) for c in COLUMNS}
+    line = "%-28s %9d %9d %9d %9d %9d" % (("total",) + tuple(total[c] for c in COLUMNS) + (image_bytes(total),))
+    if previous is not None:
+        before = sum(image_bytes(r) for r in previous.values())
+        line += "  %+9d" % (image_bytes(total) - before)
+    print(line)
+
+
+def print_top(entries, count):
+    print("\n%-9s %-7s %-22s %s" % ("size", "kind", "component", "section"))
+    for column, name, section, size in sorted(entries, key=lambda e: -e[3])[:count]:
+        print("%-9d %-7s %-22s %s" % (size, column, name[:22], section))
+
+
+def load(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+def save(path, result):
+    with open(path, "w") as f:
+        json.dump(result, f, indent=1, sort_keys=True)
+
+
+def main():
+    args = sys.argv[1:]
+    options = {}
+    while len(args) > 1 and args[0].startswith("--"):
+        options[args[0]] = args[1]
+        args = args[2:]
+    if len(args) != 1:
+        sys.exit(__doc__)
+    entries = list(sections(args[0]))
+    if "--component" in options:
+        entries = [e for e in entries if e[1] == options["--component"]]
+    result = totals(entries)
+    previous = load(options["--compare"]) if "--compare" in options else None
+    if previous is not None and "--component" in options:
+        previous = {n: r for n, r in previous.items() if n == options["--component"]}
+    print_report(result, previous)
+    if "--top" in options:
+        print_top(entries, int(options["--top"]))
+    if "--save" in options:
+        save(options["--save"], result)
+
+
+if __name__ == "__main__":
+    main()
+else:
+    Import("env")  # noqa: F821 - run by PlatformIO
+    map_path = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")  # noqa: F821
+    report_path = os.path.join(env.subst("$BUILD_DIR"), "size_report.json")  # noqa: F821
+    env.Append(LINKFLAGS=["-Wl,-Map," + map_path])  # noqa: F821
+
+    def after_link(source, target, env):
+        result = totals(sections(map_path))
+        print_report(result, load(report_path))
+        save(report_path, result)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", after_link)  # noqa: F821